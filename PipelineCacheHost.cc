@@ -0,0 +1,280 @@
+#include "PipelineCacheHost.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+
+namespace vkutils{const char* vk_result_str(VkResult);}
+
+namespace{
+
+constexpr uint32_t kCacheFileMagic = 0x4350564B; // 'KVPC'
+constexpr uint32_t kCacheFileVersion = 1;
+
+// Files are written outside the registry lock, so concurrent saves need their own temporary files
+std::atomic<uint64_t> sNextTempFile(0);
+
+// Prefixed to the driver's blob so entries can be validated against the full
+// driver version, which the Vulkan pipeline cache header does not carry.
+struct PipelineCacheFileHeader
+{
+    uint32_t mMagic;
+    uint32_t mFileVersion;
+    uint32_t mVendorID;
+    uint32_t mDeviceID;
+    uint32_t mDriverVersion;
+    uint8_t mPipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t mDataSize;
+    uint64_t mDataHash;
+};
+
+// Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE, as defined by the Vulkan spec.
+struct VulkanPipelineCacheHeader
+{
+    uint32_t mHeaderSize;
+    uint32_t mHeaderVersion;
+    uint32_t mVendorID;
+    uint32_t mDeviceID;
+    uint8_t mPipelineCacheUUID[VK_UUID_SIZE];
+};
+
+uint64_t fnv1a_64(const uint8_t* aData, size_t aSize){
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for(size_t i = 0; i < aSize; ++i){
+        hash = (hash ^ aData[i]) * 0x100000001B3ULL;
+    }
+    return(hash);
+}
+
+bool header_matches_device(const PipelineCacheFileHeader& aHeader, const VkPhysicalDeviceProperties& aProps){
+    return(
+        aHeader.mMagic == kCacheFileMagic &&
+        aHeader.mFileVersion == kCacheFileVersion &&
+        aHeader.mVendorID == aProps.vendorID &&
+        aHeader.mDeviceID == aProps.deviceID &&
+        aHeader.mDriverVersion == aProps.driverVersion &&
+        std::memcmp(aHeader.mPipelineCacheUUID, aProps.pipelineCacheUUID, VK_UUID_SIZE) == 0
+    );
+}
+
+bool blob_matches_device(const std::vector<uint8_t>& aBlob, const VkPhysicalDeviceProperties& aProps){
+    if(aBlob.size() < sizeof(VulkanPipelineCacheHeader)) return(false);
+    VulkanPipelineCacheHeader header;
+    std::memcpy(&header, aBlob.data(), sizeof(header));
+    return(
+        header.mHeaderSize >= sizeof(VulkanPipelineCacheHeader) &&
+        header.mHeaderVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.mVendorID == aProps.vendorID &&
+        header.mDeviceID == aProps.deviceID &&
+        std::memcmp(header.mPipelineCacheUUID, aProps.pipelineCacheUUID, VK_UUID_SIZE) == 0
+    );
+}
+
+// Returns an empty vector if the file is missing, unreadable, truncated, or was written for another device/driver.
+std::vector<uint8_t> read_cache_file(const std::string& aPath, const VkPhysicalDeviceProperties& aProps){
+    std::ifstream cacheFile(aPath, std::ios::in | std::ios::binary | std::ios::ate);
+    if(!cacheFile.is_open()) return(std::vector<uint8_t>());
+    const std::streamoff fileSize = cacheFile.tellg();
+    cacheFile.seekg(0);
+
+    PipelineCacheFileHeader header;
+    if(!cacheFile.read(reinterpret_cast<char*>(&header), sizeof(header)) || !header_matches_device(header, aProps)){
+        std::cerr << "Warning: Discarding incompatible pipeline cache '" << aPath << "'" << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    // The recorded size must account for the rest of the file exactly, so a corrupt header can't request a huge blob
+    if(fileSize < 0 || header.mDataSize != static_cast<uint64_t>(fileSize) - sizeof(header)){
+        std::cerr << "Warning: Discarding corrupt pipeline cache '" << aPath << "'" << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    std::vector<uint8_t> blob(static_cast<size_t>(header.mDataSize));
+    if(!cacheFile.read(reinterpret_cast<char*>(blob.data()), blob.size()) || fnv1a_64(blob.data(), blob.size()) != header.mDataHash){
+        std::cerr << "Warning: Discarding corrupt pipeline cache '" << aPath << "'" << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    if(!blob_matches_device(blob, aProps)){
+        std::cerr << "Warning: Discarding incompatible pipeline cache '" << aPath << "'" << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    return(blob);
+}
+
+} // end anonymous namespace
+
+PipelineCacheHost::~PipelineCacheHost(){
+    // Devices are usually destroyed by the time statics are, so their caches can't be touched here
+    if(!_mCaches.empty()){
+        std::cerr << "Warning: " << _mCaches.size() << " pipeline cache(s) were never released and have been leaked" << std::endl;
+    }
+}
+
+VkPipelineCache PipelineCacheHost::_getCache(const VulkanDeviceHandlePair& aDevicePair){
+    if(!aDevicePair.isValid()) return(VK_NULL_HANDLE);
+
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        auto finder = _mCaches.find(aDevicePair);
+        if(finder != _mCaches.end()) return(finder->second);
+        directory = _mDirectory;
+    }
+
+    // Loaded and created outside the lock, so other devices' lookups don't wait on the disk
+    VkPipelineCache cache = _createCache(aDevicePair, directory);
+    if(cache == VK_NULL_HANDLE) return(VK_NULL_HANDLE);
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    auto inserted = _mCaches.insert({aDevicePair, cache});
+    if(!inserted.second){
+        // Another thread created the device's cache first
+        vkDestroyPipelineCache(aDevicePair.device, cache, nullptr);
+    }
+    return(inserted.first->second);
+}
+
+VkPipelineCache PipelineCacheHost::_createCache(const VulkanDeviceHandlePair& aDevicePair, const std::string& aDirectory){
+    std::vector<uint8_t> initialData;
+    if(!aDirectory.empty()){
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(aDevicePair.physicalDevice, &properties);
+        initialData = read_cache_file(_cacheFilePath(aDirectory, properties), properties);
+    }
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    {
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = 0;
+        createInfo.initialDataSize = initialData.size();
+        createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+    }
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    VkResult result = vkCreatePipelineCache(aDevicePair.device, &createInfo, nullptr, &cache);
+    if(result != VK_SUCCESS && !initialData.empty()){
+        // Driver rejected the blob despite the header matching. Start from scratch.
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(aDevicePair.device, &createInfo, nullptr, &cache);
+    }
+    if(result != VK_SUCCESS){
+        std::cerr << "Warning: Failed to create pipeline cache (" << vkutils::vk_result_str(result) << ")" << std::endl;
+        return(VK_NULL_HANDLE);
+    }
+    return(cache);
+}
+
+bool PipelineCacheHost::_saveCache(const VulkanDeviceHandlePair& aDevicePair){
+    CacheSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        auto finder = _mCaches.find(aDevicePair);
+        if(finder == _mCaches.end() || !_snapshotLocked(finder->first, finder->second, snapshot)) return(false);
+    }
+    return(_writeCacheFile(snapshot));
+}
+
+void PipelineCacheHost::_saveAllCaches(){
+    std::vector<CacheSnapshot> snapshots;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        for(const auto& entry : _mCaches){
+            CacheSnapshot snapshot;
+            if(_snapshotLocked(entry.first, entry.second, snapshot)) snapshots.push_back(std::move(snapshot));
+        }
+    }
+    for(const CacheSnapshot& snapshot : snapshots){
+        _writeCacheFile(snapshot);
+    }
+}
+
+void PipelineCacheHost::_destroyCache(const VulkanDeviceHandlePair& aDevicePair, bool aSave){
+    CacheSnapshot snapshot;
+    bool save = false;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        auto finder = _mCaches.find(aDevicePair);
+        if(finder == _mCaches.end()) return;
+        save = aSave && _snapshotLocked(finder->first, finder->second, snapshot);
+        vkDestroyPipelineCache(finder->first.device, finder->second, nullptr);
+        _mCaches.erase(finder);
+    }
+    if(save) _writeCacheFile(snapshot);
+}
+
+bool PipelineCacheHost::_cacheExists(const VulkanDeviceHandlePair& aDevicePair){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_mCaches.find(aDevicePair) != _mCaches.end());
+}
+
+bool PipelineCacheHost::_snapshotLocked(const VulkanDeviceHandlePair& aDevicePair, VkPipelineCache aCache, CacheSnapshot& aSnapshotOut) const{
+    if(_mDirectory.empty()) return(false);
+
+    size_t dataSize = 0;
+    if(vkGetPipelineCacheData(aDevicePair.device, aCache, &dataSize, nullptr) != VK_SUCCESS) return(false);
+    aSnapshotOut.mBlob.resize(dataSize);
+    if(vkGetPipelineCacheData(aDevicePair.device, aCache, &dataSize, aSnapshotOut.mBlob.data()) != VK_SUCCESS) return(false);
+    aSnapshotOut.mBlob.resize(dataSize);
+
+    vkGetPhysicalDeviceProperties(aDevicePair.physicalDevice, &aSnapshotOut.mProperties);
+    aSnapshotOut.mPath = _cacheFilePath(_mDirectory, aSnapshotOut.mProperties);
+    return(true);
+}
+
+bool PipelineCacheHost::_writeCacheFile(const CacheSnapshot& aSnapshot){
+    const VkPhysicalDeviceProperties& properties = aSnapshot.mProperties;
+    const std::vector<uint8_t>& blob = aSnapshot.mBlob;
+
+    PipelineCacheFileHeader header = {};
+    {
+        header.mMagic = kCacheFileMagic;
+        header.mFileVersion = kCacheFileVersion;
+        header.mVendorID = properties.vendorID;
+        header.mDeviceID = properties.deviceID;
+        header.mDriverVersion = properties.driverVersion;
+        std::memcpy(header.mPipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.mDataSize = blob.size();
+        header.mDataHash = fnv1a_64(blob.data(), blob.size());
+    }
+
+    // Write next to the destination and rename over it so readers never observe a partial file
+    const std::string& path = aSnapshot.mPath;
+    const std::string tempPath = path + ".tmp" + std::to_string(sNextTempFile++);
+    {
+        std::ofstream cacheFile(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!cacheFile.is_open()){
+            perror(tempPath.c_str());
+            return(false);
+        }
+        cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        cacheFile.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+        cacheFile.flush();
+        if(!cacheFile){
+            std::remove(tempPath.c_str());
+            return(false);
+        }
+    }
+
+    #ifdef _WIN32
+    std::remove(path.c_str());
+    #endif
+    if(std::rename(tempPath.c_str(), path.c_str()) != 0){
+        perror(path.c_str());
+        std::remove(tempPath.c_str());
+        return(false);
+    }
+    return(true);
+}
+
+std::string PipelineCacheHost::_cacheFilePath(const std::string& aDirectory, const VkPhysicalDeviceProperties& aProperties){
+    char fileName[64];
+    std::snprintf(fileName, sizeof(fileName), "pipeline_cache_%08x_%08x.bin", aProperties.vendorID, aProperties.deviceID);
+    if(aDirectory.back() == '/' || aDirectory.back() == '\\') return(aDirectory + fileName);
+    return(aDirectory + "/" + fileName);
+}
@@ -0,0 +1,106 @@
+#ifndef KJY_PIPELINE_CACHE_HOST_H_
+#define KJY_PIPELINE_CACHE_HOST_H_
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <vulkan/vulkan.h>
+#include "VulkanDevices.h"
+
+/// Process-wide owner of one VkPipelineCache per device pair.
+///
+/// Caches are created lazily on first request. When a cache directory has been set the
+/// initial contents are loaded from disk, and the cache is written back when it is saved
+/// or released. Blobs written by a different driver, device, or driver version are
+/// rejected and the cache starts out empty instead. Files are read and written outside
+/// the registry lock, so getCache() callers never wait on another cache's disk I/O.
+///
+/// Every device's cache must be released with release() or destroyCache() before the
+/// device is destroyed. Caches still registered at process exit are leaked, since their
+/// devices are usually gone by then.
+class PipelineCacheHost
+{
+ public:
+
+    ~PipelineCacheHost();
+
+    static PipelineCacheHost& getInstance(){
+        static PipelineCacheHost instance;
+        return(instance);
+    }
+
+    /// Sets the directory cache blobs are loaded from and saved to. An empty string
+    /// (the default) disables persistence, leaving caches in-memory only.
+    static void setCacheDirectory(const std::string& aDirectory){
+        std::lock_guard<std::mutex> lock(PipelineCacheHost::getInstance()._mMutex);
+        PipelineCacheHost::getInstance()._mDirectory = aDirectory;
+    }
+
+    static std::string getCacheDirectory(){
+        std::lock_guard<std::mutex> lock(PipelineCacheHost::getInstance()._mMutex);
+        return(PipelineCacheHost::getInstance()._mDirectory);
+    }
+
+    static bool cacheExists(const VulkanDeviceHandlePair& aDevicePair){
+        return(PipelineCacheHost::getInstance()._cacheExists(aDevicePair));
+    }
+
+    /// Returns the pipeline cache for the device pair, creating (and loading) it if needed.
+    /// Returns VK_NULL_HANDLE if the device pair is invalid or cache creation fails.
+    static VkPipelineCache getCache(const VulkanDeviceHandlePair& aDevicePair){
+        return(PipelineCacheHost::getInstance()._getCache(aDevicePair));
+    }
+
+    /// Atomically writes the current contents of the device's cache to disk.
+    /// \returns false if persistence is disabled, no cache exists, or writing failed.
+    static bool saveCache(const VulkanDeviceHandlePair& aDevicePair){
+        return(PipelineCacheHost::getInstance()._saveCache(aDevicePair));
+    }
+
+    static void saveAllCaches(){
+        PipelineCacheHost::getInstance()._saveAllCaches();
+    }
+
+    /// Saves and destroys the device's cache. Must be called before the logical device is destroyed.
+    static void release(const VulkanDeviceHandlePair& aDevicePair){
+        PipelineCacheHost::getInstance()._destroyCache(aDevicePair, true);
+    }
+
+    /// Destroys the device's cache, saving it first unless `aSave` is false.
+    /// Must be called before the logical device is destroyed.
+    static void destroyCache(const VulkanDeviceHandlePair& aDevicePair, bool aSave = true){
+        PipelineCacheHost::getInstance()._destroyCache(aDevicePair, aSave);
+    }
+
+    PipelineCacheHost(const PipelineCacheHost&) = delete;
+    PipelineCacheHost& operator=(const PipelineCacheHost&) = delete;
+
+ private:
+    PipelineCacheHost(){}
+
+    VkPipelineCache _getCache(const VulkanDeviceHandlePair& aDevicePair);
+    VkPipelineCache _createCache(const VulkanDeviceHandlePair& aDevicePair, const std::string& aDirectory);
+    bool _saveCache(const VulkanDeviceHandlePair& aDevicePair);
+    void _saveAllCaches();
+    void _destroyCache(const VulkanDeviceHandlePair& aDevicePair, bool aSave);
+    bool _cacheExists(const VulkanDeviceHandlePair& aDevicePair);
+
+    /// Contents of a cache copied out under the lock, to be written after it is released
+    struct CacheSnapshot
+    {
+        std::string mPath;
+        VkPhysicalDeviceProperties mProperties;
+        std::vector<uint8_t> mBlob;
+    };
+
+    /// \returns false if persistence is disabled or the cache data can't be read. Must hold _mMutex.
+    bool _snapshotLocked(const VulkanDeviceHandlePair& aDevicePair, VkPipelineCache aCache, CacheSnapshot& aSnapshotOut) const;
+    static bool _writeCacheFile(const CacheSnapshot& aSnapshot);
+    static std::string _cacheFilePath(const std::string& aDirectory, const VkPhysicalDeviceProperties& aProperties);
+
+    std::unordered_map<VulkanDeviceHandlePair, VkPipelineCache> _mCaches;
+    std::string _mDirectory;
+    std::mutex _mMutex;
+};
+
+#endif
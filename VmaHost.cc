@@ -1,27 +1,90 @@
 #include "VmaHost.h"
+#include "vkutils.h"
+
+namespace{
+struct LastAllocatorLookup
+{
+    uint64_t mGeneration = 0;
+    VulkanDeviceHandlePair mDevicePair;
+    VmaAllocator mAllocator = nullptr;
+};
+
+thread_local LastAllocatorLookup tLastLookup;
+}
+
+VmaHost::VmaHost() : _mSnapshot(std::make_shared<const base_map_t>()) {}
+
+VmaHost::~VmaHost(){
+    std::lock_guard<std::mutex> lock(_mPoolMutex);
+    for(const auto& entry : *_snapshot()){
+        _destroyPoolsLocked(entry.first, entry.second);
+        vmaDestroyAllocator(entry.second);
+    }
+}
+
+std::shared_ptr<const VmaHost::base_map_t> VmaHost::_snapshot() const {
+    std::lock_guard<std::mutex> lock(_mSnapshotMutex);
+    return(_mSnapshot);
+}
+
+void VmaHost::_publishLocked(std::shared_ptr<const base_map_t> aSnapshot){
+    {
+        std::lock_guard<std::mutex> lock(_mSnapshotMutex);
+        _mSnapshot.swap(aSnapshot);
+    }
+    _mGeneration.fetch_add(1, std::memory_order_release);
+}
 
 VmaAllocator VmaHost::_getAllocator(const VulkanDeviceHandlePair& aDevicePair){
-    base_map_t::const_iterator finder = this->find(aDevicePair);
-    if(finder == this->end()){
-        VmaAllocator allocator = _createNewAllocator(aDevicePair);
-        this->insert({aDevicePair, allocator});
-        return(allocator);
-    }else{
+    // Reading the generation before the snapshot means any later change invalidates what gets cached here
+    uint64_t generation = _mGeneration.load(std::memory_order_acquire);
+    if(tLastLookup.mGeneration == generation && tLastLookup.mDevicePair == aDevicePair){
+        return(tLastLookup.mAllocator);
+    }
+
+    std::shared_ptr<const base_map_t> snapshot = _snapshot();
+    base_map_t::const_iterator finder = snapshot->find(aDevicePair);
+    if(finder != snapshot->end()){
+        tLastLookup = LastAllocatorLookup{generation, aDevicePair, finder->second};
         return(finder->second);
     }
+
+    std::lock_guard<std::mutex> lock(_mWriteMutex);
+    // Another thread may have created it while this one waited for the lock
+    snapshot = _snapshot();
+    finder = snapshot->find(aDevicePair);
+    if(finder != snapshot->end()) return(finder->second);
+
+    VmaAllocator allocator = _createNewAllocator(aDevicePair);
+    std::shared_ptr<base_map_t> updated = std::make_shared<base_map_t>(*snapshot);
+    updated->insert({aDevicePair, allocator});
+    _publishLocked(std::move(updated));
+    return(allocator);
 }
 
 void VmaHost::_destroyAllocator(const VulkanDeviceHandlePair& aDevicePair){
-    base_map_t::const_iterator finder = this->find(aDevicePair);
-    if(finder != this->end()){
-        vmaDestroyAllocator(finder->second);
-        this->erase(finder);
+    VmaAllocator allocator = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_mWriteMutex);
+        std::shared_ptr<const base_map_t> snapshot = _snapshot();
+        base_map_t::const_iterator finder = snapshot->find(aDevicePair);
+        if(finder == snapshot->end()) return;
+        allocator = finder->second;
+
+        std::shared_ptr<base_map_t> updated = std::make_shared<base_map_t>(*snapshot);
+        updated->erase(aDevicePair);
+        _publishLocked(std::move(updated));
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mPoolMutex);
+        _destroyPoolsLocked(aDevicePair, allocator);
     }
+    vmaDestroyAllocator(allocator);
 }
 
 bool VmaHost::_allocatorExists(const VulkanDeviceHandlePair& aDevicePair){
-    base_map_t::const_iterator finder = this->find(aDevicePair);
-    return(finder != this->end());
+    std::shared_ptr<const base_map_t> snapshot = _snapshot();
+    return(snapshot->find(aDevicePair) != snapshot->end());
 }
 
 VmaAllocator VmaHost::_createNewAllocator(const VulkanDeviceHandlePair& aDevicePair){
@@ -40,4 +103,79 @@ VmaAllocator VmaHost::_createNewAllocator(const VulkanDeviceHandlePair& aDeviceP
     VmaAllocator allocator = nullptr;
     vmaCreateAllocator(&createInfo, &allocator);
     return(allocator);
-}
\ No newline at end of file
+}
+
+VmaPool VmaHost::_createPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName, const VmaPoolCreateInfo& aCreateInfo){
+    VmaAllocator allocator = _getAllocator(aDevicePair);
+
+    std::lock_guard<std::mutex> lock(_mPoolMutex);
+    std::unordered_map<std::string, VmaPool>& pools = _mPools[aDevicePair];
+    if(pools.find(aName) != pools.end()){
+        throw std::runtime_error("Attempted to create a second VMA pool named '" + aName + "'!");
+    }
+
+    VmaPool pool = nullptr;
+    VkResult result = vmaCreatePool(allocator, &aCreateInfo, &pool);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create VMA pool '" + aName + "'! (" + std::string(vkutils::vk_result_str(result)) + ")");
+    }
+    pools.insert({aName, pool});
+    return(pool);
+}
+
+VmaPool VmaHost::_getPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName){
+    std::lock_guard<std::mutex> lock(_mPoolMutex);
+    auto devicePools = _mPools.find(aDevicePair);
+    if(devicePools == _mPools.end()) return(nullptr);
+    auto finder = devicePools->second.find(aName);
+    return(finder != devicePools->second.end() ? finder->second : nullptr);
+}
+
+void VmaHost::_destroyPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName){
+    std::lock_guard<std::mutex> lock(_mPoolMutex);
+    auto devicePools = _mPools.find(aDevicePair);
+    if(devicePools == _mPools.end()) return;
+    auto finder = devicePools->second.find(aName);
+    if(finder == devicePools->second.end()) return;
+
+    vmaDestroyPool(_getAllocator(aDevicePair), finder->second);
+    devicePools->second.erase(finder);
+    if(devicePools->second.empty()) _mPools.erase(devicePools);
+}
+
+void VmaHost::_destroyPoolsLocked(const VulkanDeviceHandlePair& aDevicePair, VmaAllocator aAllocator){
+    auto devicePools = _mPools.find(aDevicePair);
+    if(devicePools == _mPools.end()) return;
+    for(const auto& entry : devicePools->second){
+        vmaDestroyPool(aAllocator, entry.second);
+    }
+    _mPools.erase(devicePools);
+}
+
+VmaPoolCreateInfo VmaHost::bufferPoolInfo(const VulkanDeviceHandlePair& aDevicePair, const VkBufferCreateInfo& aBufferInfo, VmaMemoryUsage aMemoryUsage, VkDeviceSize aBlockSize, VmaPoolCreateFlags aFlags){
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = aMemoryUsage;
+
+    VmaPoolCreateInfo poolInfo = {};
+    VkResult result = vmaFindMemoryTypeIndexForBufferInfo(getAllocator(aDevicePair), &aBufferInfo, &allocInfo, &poolInfo.memoryTypeIndex);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to find a memory type for VMA buffer pool! (" + std::string(vkutils::vk_result_str(result)) + ")");
+    }
+    poolInfo.flags = aFlags;
+    poolInfo.blockSize = aBlockSize;
+    return(poolInfo);
+}
+
+VmaPoolCreateInfo VmaHost::imagePoolInfo(const VulkanDeviceHandlePair& aDevicePair, const VkImageCreateInfo& aImageInfo, VmaMemoryUsage aMemoryUsage, VkDeviceSize aBlockSize, VmaPoolCreateFlags aFlags){
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = aMemoryUsage;
+
+    VmaPoolCreateInfo poolInfo = {};
+    VkResult result = vmaFindMemoryTypeIndexForImageInfo(getAllocator(aDevicePair), &aImageInfo, &allocInfo, &poolInfo.memoryTypeIndex);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to find a memory type for VMA image pool! (" + std::string(vkutils::vk_result_str(result)) + ")");
+    }
+    poolInfo.flags = aFlags;
+    poolInfo.blockSize = aBlockSize;
+    return(poolInfo);
+}
@@ -4,29 +4,30 @@
 #include <vk_mem_alloc.h>
 #include "VulkanDevices.h"
 #include <functional> 
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
 
-template<>
-struct std::hash<VulkanDeviceHandlePair>{
-    size_t operator()(const VulkanDeviceHandlePair& aDevicePair) const noexcept{
-        return(
-            std::hash<VkDevice>()(aDevicePair.device)
-            ^
-            std::hash<VkPhysicalDevice>()(aDevicePair.physicalDevice)
-        );
-    }
-};
-
-class VmaHost : public std::unordered_map<VulkanDeviceHandlePair, VmaAllocator>
+/// Process-wide registry of one VmaAllocator per device pair. Safe to use from any thread.
+///
+/// Lookups read an immutable snapshot of the registry, which is replaced wholesale (copy-on-write)
+/// when an allocator is created or destroyed. Copying the snapshot pointer takes a short lock, but
+/// each thread also caches the last allocator it looked up, validated against a generation counter,
+/// so repeated lookups for the same device take no lock at all.
+///
+/// Custom pools can be registered by name for each device pair. They are destroyed along with their
+/// allocator. Pools created directly with vmaCreatePool are not, and must be destroyed first.
+class VmaHost
 {
  public:
 
     using base_map_t = typename std::unordered_map<VulkanDeviceHandlePair, VmaAllocator>;
 
-    ~VmaHost(){
-        for(auto& entry : *this){
-            vmaDestroyAllocator(entry.second);
-        }
-    }
+    /// Name of the pool autoCreateDepthBuffer() allocates from when one is registered
+    static constexpr const char* kDepthBufferPool = "vkutils.depth";
+
+    ~VmaHost();
 
     static VmaHost& getInstance(){
         static VmaHost instance;
@@ -34,9 +35,16 @@ class VmaHost : public std::unordered_map<VulkanDeviceHandlePair, VmaAllocator>
     }
 
 	static void setVkInstance(VkInstance aVkInstance) {
+		std::lock_guard<std::mutex> lock(VmaHost::getInstance()._mWriteMutex);
 		VmaHost::getInstance()._mInstance = aVkInstance;
 	}
 
+    /// Instance given to setVkInstance(), or VK_NULL_HANDLE
+    static VkInstance getVkInstance(){
+        std::lock_guard<std::mutex> lock(VmaHost::getInstance()._mWriteMutex);
+        return(VmaHost::getInstance()._mInstance);
+    }
+
     static bool allocatorExists(const VulkanDeviceHandlePair& aDevicePair){
         return(VmaHost::getInstance()._allocatorExists(aDevicePair));
     }
@@ -45,22 +53,96 @@ class VmaHost : public std::unordered_map<VulkanDeviceHandlePair, VmaAllocator>
         return(VmaHost::getInstance()._getAllocator(aDevicePair));
     }
 
+    /// Destroys the allocator for `aDevicePair`. No other thread may still be using it.
     static void destroyAllocator(const VulkanDeviceHandlePair& aDevicePair){
         VmaHost::getInstance()._destroyAllocator(aDevicePair);
     }
 
+    /// Creates a custom pool for `aDevicePair` that getPool() finds under `aName`
+    /// \throw std::runtime_error If a pool named `aName` already exists or the pool can't be created
+    static VmaPool createPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName, const VmaPoolCreateInfo& aCreateInfo){
+        return(VmaHost::getInstance()._createPool(aDevicePair, aName, aCreateInfo));
+    }
+
+    /// \returns The pool named `aName`, or nullptr to allocate from the default pools
+    static VmaPool getPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName){
+        return(VmaHost::getInstance()._getPool(aDevicePair, aName));
+    }
+
+    /// Destroys the pool named `aName`. Everything allocated from it must already be freed.
+    static void destroyPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName){
+        VmaHost::getInstance()._destroyPool(aDevicePair, aName);
+    }
+
+    /// Pool create info for buffers like `aBufferInfo` placed according to `aMemoryUsage`
+    /// \param aBlockSize Size of each device memory block, or 0 for VMA's default
+    /// \param aFlags e.g. VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT for pools used as stacks or rings
+    /// \throw std::runtime_error If no memory type suits the buffer
+    static VmaPoolCreateInfo bufferPoolInfo(
+        const VulkanDeviceHandlePair& aDevicePair,
+        const VkBufferCreateInfo& aBufferInfo,
+        VmaMemoryUsage aMemoryUsage,
+        VkDeviceSize aBlockSize = 0,
+        VmaPoolCreateFlags aFlags = 0
+    );
+
+    /// Pool create info for images like `aImageInfo` placed according to `aMemoryUsage`
+    /// \throw std::runtime_error If no memory type suits the image
+    static VmaPoolCreateInfo imagePoolInfo(
+        const VulkanDeviceHandlePair& aDevicePair,
+        const VkImageCreateInfo& aImageInfo,
+        VmaMemoryUsage aMemoryUsage,
+        VkDeviceSize aBlockSize = 0,
+        VmaPoolCreateFlags aFlags = 0
+    );
+
+    /// Current contents of the registry. The returned map is never modified.
+    static std::shared_ptr<const base_map_t> snapshot(){
+        return(VmaHost::getInstance()._snapshot());
+    }
+
+    // Read-only forwarders for callers that used the registry as a map when VmaHost derived from
+    // std::unordered_map. Iterate over snapshot() instead; iterators into the live registry can't
+    // outlive a concurrent update.
+    size_t count(const VulkanDeviceHandlePair& aDevicePair) const {return(_snapshot()->count(aDevicePair));}
+    /// \throw std::out_of_range If no allocator exists for `aDevicePair`
+    VmaAllocator at(const VulkanDeviceHandlePair& aDevicePair) const {return(_snapshot()->at(aDevicePair));}
+    size_t size() const {return(_snapshot()->size());}
+    bool empty() const {return(_snapshot()->empty());}
+
     VmaHost(const VmaHost&) = delete;
     VmaHost& operator=(const VmaHost&) = delete;
 
  private:
-    VmaHost(){}
+    VmaHost();
 
     VmaAllocator _getAllocator(const VulkanDeviceHandlePair& aDevicePair);
     VmaAllocator _createNewAllocator(const VulkanDeviceHandlePair& aDevicePair);
     void _destroyAllocator(const VulkanDeviceHandlePair& aDevicePair);
     bool _allocatorExists(const VulkanDeviceHandlePair& aDevicePair);
 
+    VmaPool _createPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName, const VmaPoolCreateInfo& aCreateInfo);
+    VmaPool _getPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName);
+    void _destroyPool(const VulkanDeviceHandlePair& aDevicePair, const std::string& aName);
+    /// Destroys every pool of `aAllocator`. Must hold _mPoolMutex.
+    void _destroyPoolsLocked(const VulkanDeviceHandlePair& aDevicePair, VmaAllocator aAllocator);
+
+    std::shared_ptr<const base_map_t> _snapshot() const;
+    /// Replaces the snapshot and invalidates cached lookups. Must hold _mWriteMutex.
+    void _publishLocked(std::shared_ptr<const base_map_t> aSnapshot);
+
 	VkInstance _mInstance = VK_NULL_HANDLE;
+
+    std::shared_ptr<const base_map_t> _mSnapshot;
+    // Guards only the _mSnapshot pointer itself, never held across allocator creation
+    mutable std::mutex _mSnapshotMutex;
+    // Serializes writers. Readers only copy the snapshot.
+    std::mutex _mWriteMutex;
+    // Bumped after every change to the snapshot, invalidating each thread's cached lookup
+    std::atomic<uint64_t> _mGeneration = {1};
+
+    std::unordered_map<VulkanDeviceHandlePair, std::unordered_map<std::string, VmaPool>> _mPools;
+    std::mutex _mPoolMutex;
 };
 
 #endif
\ No newline at end of file
@@ -2,7 +2,56 @@
 #include <set>
 #include <algorithm>
 
-namespace vkutils{const char* vk_result_str(VkResult);}
+namespace vkutils{
+const char* vk_result_str(VkResult);
+uint32_t effective_api_version(VkPhysicalDevice);
+PFN_vkGetPhysicalDeviceFeatures2 get_physical_device_features2_func(VkPhysicalDevice);
+}
+
+static bool pnext_chain_contains(const void* aChain, VkStructureType aType){
+    const VkBaseInStructure* link = reinterpret_cast<const VkBaseInStructure*>(aChain);
+    while(link != nullptr){
+        if(link->sType == aType) return(true);
+        link = link->pNext;
+    }
+    return(false);
+}
+
+static VkBaseOutStructure* pnext_chain_find(void* aChain, VkStructureType aType){
+    VkBaseOutStructure* link = reinterpret_cast<VkBaseOutStructure*>(aChain);
+    while(link != nullptr && link->sType != aType){
+        link = link->pNext;
+    }
+    return(link);
+}
+
+// All false if vkGetPhysicalDeviceFeatures2 isn't available to the instance
+static VkPhysicalDeviceDescriptorIndexingFeatures query_descriptor_indexing_features(VkPhysicalDevice aDevice){
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    PFN_vkGetPhysicalDeviceFeatures2 getFeatures2 = vkutils::get_physical_device_features2_func(aDevice);
+    if(getFeatures2 == nullptr) return(indexingFeatures);
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &indexingFeatures;
+    getFeatures2(aDevice, &features);
+    return(indexingFeatures);
+}
+
+// Works on both VkPhysicalDeviceDescriptorIndexingFeatures and VkPhysicalDeviceVulkan12Features, which share these members
+template<typename FeatureStruct>
+static void enable_bindless_features(FeatureStruct& aFeatures, const VkPhysicalDeviceDescriptorIndexingFeatures& aSupported){
+    aFeatures.runtimeDescriptorArray = VK_TRUE;
+    aFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    aFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    aFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    aFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    aFeatures.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+    aFeatures.shaderStorageBufferArrayNonUniformIndexing |= aSupported.shaderStorageBufferArrayNonUniformIndexing;
+    aFeatures.shaderSampledImageArrayNonUniformIndexing |= aSupported.shaderSampledImageArrayNonUniformIndexing;
+    aFeatures.shaderStorageImageArrayNonUniformIndexing |= aSupported.shaderStorageImageArrayNonUniformIndexing;
+}
 
 QueueFamily::QueueFamily(const VkQueueFamilyProperties& aFamily, uint32_t aIndex) 
 : mIndex(aIndex),
@@ -17,6 +66,93 @@ QueueFamily::QueueFamily(const VkQueueFamilyProperties& aFamily, uint32_t aIndex
   mProtected(aFamily.queueFlags & VK_QUEUE_PROTECTED_BIT)
 {}
 
+QueuePool::Lease::Lease(const std::shared_ptr<QueuePool>& aPool, size_t aIndex) : _mPool(aPool), _mIndex(aIndex) {
+    ++_mPool->_mQueues[_mIndex]->mLeases;
+}
+
+QueuePool::Lease::Lease(Lease&& aOther) noexcept : _mPool(std::move(aOther._mPool)), _mIndex(aOther._mIndex) {
+    aOther._mPool = nullptr;
+}
+
+QueuePool::Lease& QueuePool::Lease::operator=(Lease&& aOther) noexcept{
+    if(this != &aOther){
+        release();
+        _mPool = std::move(aOther._mPool);
+        _mIndex = aOther._mIndex;
+        aOther._mPool = nullptr;
+    }
+    return(*this);
+}
+
+VkQueue QueuePool::Lease::getQueue() const{
+    if(_mPool == nullptr) return(VK_NULL_HANDLE);
+    return(_mPool->_mQueues[_mIndex]->mQueue);
+}
+
+uint32_t QueuePool::Lease::getFamilyIdx() const{
+    if(_mPool == nullptr) return(std::numeric_limits<uint32_t>::max());
+    return(_mPool->_mFamilyIdx);
+}
+
+VkResult QueuePool::Lease::submit(uint32_t aSubmitCount, const VkSubmitInfo* aSubmits, VkFence aFence) const{
+    if(_mPool == nullptr) throw std::runtime_error("Attempted to submit through an empty queue lease!");
+    PooledQueue& pooled = *_mPool->_mQueues[_mIndex];
+    std::lock_guard<std::mutex> lock(pooled.mMutex);
+    return(vkQueueSubmit(pooled.mQueue, aSubmitCount, aSubmits, aFence));
+}
+
+std::unique_lock<std::mutex> QueuePool::Lease::lock() const{
+    if(_mPool == nullptr) throw std::runtime_error("Attempted to lock an empty queue lease!");
+    return(std::unique_lock<std::mutex>(_mPool->_mQueues[_mIndex]->mMutex));
+}
+
+void QueuePool::Lease::release(){
+    if(_mPool == nullptr) return;
+    --_mPool->_mQueues[_mIndex]->mLeases;
+    _mPool = nullptr;
+}
+
+QueuePool::QueuePool(uint32_t aFamilyIdx, const std::vector<VkQueue>& aQueues, const std::vector<float>& aPriorities)
+: _mFamilyIdx(aFamilyIdx)
+{
+    if(aQueues.empty()) throw std::runtime_error("Attempted to create an empty queue pool!");
+    _mQueues.reserve(aQueues.size());
+    for(size_t i = 0; i < aQueues.size(); ++i){
+        _mQueues.emplace_back(new PooledQueue());
+        _mQueues.back()->mQueue = aQueues[i];
+        _mQueues.back()->mPriority = i < aPriorities.size() ? aPriorities[i] : 1.0f;
+    }
+}
+
+QueuePool::Lease QueuePool::acquireRoundRobin(){
+    return(_lease(_mNextIdx.fetch_add(1) % _mQueues.size()));
+}
+
+QueuePool::Lease QueuePool::acquireLeastLoaded(){
+    // Loads may change while scanning; this only needs to be a good guess
+    size_t best = 0;
+    uint32_t bestLoad = _mQueues[0]->mLeases.load();
+    for(size_t i = 1; i < _mQueues.size(); ++i){
+        uint32_t load = _mQueues[i]->mLeases.load();
+        if(load < bestLoad || (load == bestLoad && _mQueues[i]->mPriority > _mQueues[best]->mPriority)){
+            best = i;
+            bestLoad = load;
+        }
+    }
+    return(_lease(best));
+}
+
+QueuePool::Lease QueuePool::_lease(size_t aIndex){
+    return(Lease(shared_from_this(), aIndex));
+}
+
+std::shared_ptr<QueuePool> VulkanLogicalDevice::getQueuePool(uint32_t aFamilyIdx) const{
+    for(const std::shared_ptr<QueuePool>& pool : mQueuePools){
+        if(pool->getFamilyIdx() == aFamilyIdx) return(pool);
+    }
+    return(nullptr);
+}
+
 VulkanPhysicalDevice::VulkanPhysicalDevice(VkPhysicalDevice aDevice) : mHandle(aDevice) {
     vkGetPhysicalDeviceProperties(aDevice, &mProperties);
     vkGetPhysicalDeviceFeatures(aDevice, &mFeatures);
@@ -52,6 +188,26 @@ void VulkanPhysicalDevice::_initQueueFamilies(){
             mProtectedIdx = familyIdx;
         if(!mSparseBindIdx && queueFamily.mSparseBinding)
             mSparseBindIdx = familyIdx;
+
+        if(!mAsyncComputeIdx && queueFamily.mCompute && !queueFamily.mGraphics)
+            mAsyncComputeIdx = familyIdx;
+    }
+
+    // Prefer a transfer-only family (usually DMA engines), then any other family without graphics
+    for(const QueueFamily& queueFamily : mQueueFamilies){
+        if(queueFamily.mTransfer && !queueFamily.mGraphics && !queueFamily.mCompute){
+            mAsyncTransferIdx = queueFamily.mIndex;
+            break;
+        }
+    }
+    if(!mAsyncTransferIdx){
+        for(const QueueFamily& queueFamily : mQueueFamilies){
+            // Compute families support transfer operations even when they don't report the bit
+            if((queueFamily.mTransfer || queueFamily.mCompute) && !queueFamily.mGraphics){
+                mAsyncTransferIdx = queueFamily.mIndex;
+                break;
+            }
+        }
     }
 }
 SwapChainSupportInfo VulkanPhysicalDevice::getSwapChainSupportInfo(const VkSurfaceKHR aSurface) const{
@@ -81,6 +237,39 @@ opt::optional<uint32_t> VulkanPhysicalDevice::getPresentableQueueIndex(const VkS
     return(opt::optional<uint32_t>());
 }
 
+bool VulkanPhysicalDevice::supportsTimelineSemaphores() const{
+    PFN_vkGetPhysicalDeviceFeatures2 getFeatures2 = vkutils::get_physical_device_features2_func(mHandle);
+    if(getFeatures2 == nullptr) return(false);
+    if(vkutils::effective_api_version(mHandle) < VK_API_VERSION_1_2){
+        auto extMatch = [](const VkExtensionProperties& ext) -> bool {return(std::string(ext.extensionName) == VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);};
+        if(std::find_if(mAvailableExtensions.begin(), mAvailableExtensions.end(), extMatch) == mAvailableExtensions.end()) return(false);
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+    getFeatures2(mHandle, &features);
+    return(timelineFeatures.timelineSemaphore == VK_TRUE);
+}
+
+bool VulkanPhysicalDevice::supportsBindlessDescriptors() const{
+    if(vkutils::effective_api_version(mHandle) < VK_API_VERSION_1_2){
+        auto extMatch = [](const VkExtensionProperties& ext) -> bool {return(std::string(ext.extensionName) == VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);};
+        if(std::find_if(mAvailableExtensions.begin(), mAvailableExtensions.end(), extMatch) == mAvailableExtensions.end()) return(false);
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = query_descriptor_indexing_features(mHandle);
+    return(
+        indexingFeatures.runtimeDescriptorArray == VK_TRUE &&
+        indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+        indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+        indexingFeatures.descriptorBindingStorageImageUpdateAfterBind == VK_TRUE
+    );
+}
 
 VulkanLogicalDevice VulkanPhysicalDevice::createLogicalDevice(const VkDeviceCreateInfo& aDeviceCreateInfo, const std::optional<uint32_t>& aPresentationIdx) const{
     VkDevice deviceHandle = VK_NULL_HANDLE;
@@ -94,6 +283,15 @@ VulkanLogicalDevice VulkanPhysicalDevice::createLogicalDevice(const VkDeviceCrea
 
     for(size_t i = 0; i < aDeviceCreateInfo.queueCreateInfoCount; ++i){
         const VkDeviceQueueCreateInfo& queueInfo = aDeviceCreateInfo.pQueueCreateInfos[i];
+        if(queueInfo.queueCount > 0){
+            std::vector<VkQueue> queues(queueInfo.queueCount);
+            for(uint32_t queueIdx = 0; queueIdx < queueInfo.queueCount; ++queueIdx){
+                vkGetDeviceQueue(deviceHandle, queueInfo.queueFamilyIndex, queueIdx, &queues[queueIdx]);
+            }
+            std::vector<float> priorities(queueInfo.pQueuePriorities, queueInfo.pQueuePriorities + queueInfo.queueCount);
+            device.mQueuePools.emplace_back(std::make_shared<QueuePool>(queueInfo.queueFamilyIndex, queues, priorities));
+        }
+
         if(queueInfo.queueFamilyIndex == mGraphicsIdx && device.mGraphicsQueue == VK_NULL_HANDLE) 
             vkGetDeviceQueue(deviceHandle, *mGraphicsIdx, 0, &device.mGraphicsQueue);
         if(queueInfo.queueFamilyIndex == mComputeIdx && device.mComputeQueue == VK_NULL_HANDLE) 
@@ -106,6 +304,13 @@ VulkanLogicalDevice VulkanPhysicalDevice::createLogicalDevice(const VkDeviceCrea
             vkGetDeviceQueue(deviceHandle, *mProtectedIdx, 0, &device.mProtectedQueue);
         if(queueInfo.queueFamilyIndex == mSparseBindIdx && device.mSparseBindingQueue == VK_NULL_HANDLE) 
             vkGetDeviceQueue(deviceHandle, *mSparseBindIdx, 0, &device.mSparseBindingQueue);   
+        if(queueInfo.queueFamilyIndex == mAsyncComputeIdx && device.mAsyncComputeQueue == VK_NULL_HANDLE) 
+            vkGetDeviceQueue(deviceHandle, *mAsyncComputeIdx, 0, &device.mAsyncComputeQueue);
+        if(queueInfo.queueFamilyIndex == mAsyncTransferIdx && device.mAsyncTransferQueue == VK_NULL_HANDLE){
+            // Sharing a family with async compute, the second queue keeps the two from being the same VkQueue
+            const uint32_t queueIdx = (mAsyncTransferIdx == mAsyncComputeIdx && queueInfo.queueCount > 1) ? 1 : 0;
+            vkGetDeviceQueue(deviceHandle, *mAsyncTransferIdx, queueIdx, &device.mAsyncTransferQueue);
+        }
     }
 
      return(device);
@@ -116,14 +321,31 @@ VulkanLogicalDevice VulkanPhysicalDevice::createLogicalDevice(
     const std::vector<const char*>& aExtensions,
     const VkPhysicalDeviceFeatures& aFeatures,
     VkSurfaceKHR aSurface,
-    void* aDeviceCreateInfoPnext
+    void* aDeviceCreateInfoPnext,
+    bool aEnableBindless
+) const{
+    return(createPooledLogicalDevice(aQueues, std::vector<float>{1.0f}, aExtensions, aFeatures, aSurface, aDeviceCreateInfoPnext, aEnableBindless));
+}
+
+VulkanLogicalDevice VulkanPhysicalDevice::createPooledLogicalDevice(
+    VkQueueFlags aQueues,
+    const std::vector<float>& aQueuePriorities,
+    const std::vector<const char*>& aExtensions,
+    const VkPhysicalDeviceFeatures& aFeatures,
+    VkSurfaceKHR aSurface,
+    void* aDeviceCreateInfoPnext,
+    bool aEnableBindless
 ) const{
+    if(aQueuePriorities.empty()) throw std::runtime_error("Attempted to create a pooled device without any queue priorities!");
+
     std::set<uint32_t> queueFamilyIndices;
-    if(aQueues | VK_QUEUE_GRAPHICS_BIT && mGraphicsIdx) queueFamilyIndices.emplace(*mGraphicsIdx);
-    if(aQueues | VK_QUEUE_COMPUTE_BIT && mComputeIdx) queueFamilyIndices.emplace(*mComputeIdx);
-    if(aQueues | VK_QUEUE_TRANSFER_BIT && mTransferIdx) queueFamilyIndices.emplace(*mTransferIdx);
-    if(aQueues | VK_QUEUE_PROTECTED_BIT && mProtectedIdx) queueFamilyIndices.emplace(*mProtectedIdx);
-    if(aQueues | VK_QUEUE_SPARSE_BINDING_BIT && mSparseBindIdx) queueFamilyIndices.emplace(*mSparseBindIdx);
+    if((aQueues & VK_QUEUE_GRAPHICS_BIT) && mGraphicsIdx) queueFamilyIndices.emplace(*mGraphicsIdx);
+    if((aQueues & VK_QUEUE_COMPUTE_BIT) && mComputeIdx) queueFamilyIndices.emplace(*mComputeIdx);
+    if((aQueues & VK_QUEUE_TRANSFER_BIT) && mTransferIdx) queueFamilyIndices.emplace(*mTransferIdx);
+    if((aQueues & VK_QUEUE_PROTECTED_BIT) && mProtectedIdx) queueFamilyIndices.emplace(*mProtectedIdx);
+    if((aQueues & VK_QUEUE_SPARSE_BINDING_BIT) && mSparseBindIdx) queueFamilyIndices.emplace(*mSparseBindIdx);
+    if((aQueues & VK_QUEUE_COMPUTE_BIT) && mAsyncComputeIdx) queueFamilyIndices.emplace(*mAsyncComputeIdx);
+    if((aQueues & VK_QUEUE_TRANSFER_BIT) && mAsyncTransferIdx) queueFamilyIndices.emplace(*mAsyncTransferIdx);
     
     opt::optional<uint32_t> presentationIdx;
     if(aSurface != VK_NULL_HANDLE){
@@ -135,31 +357,68 @@ VulkanLogicalDevice VulkanPhysicalDevice::createLogicalDevice(
         }
     }
 
-    float priorities = 1.0f;
+    // Async compute and transfer falling back to the same family need a queue each to run concurrently
+    const bool sharedAsyncFamily = (aQueues & VK_QUEUE_COMPUTE_BIT) && (aQueues & VK_QUEUE_TRANSFER_BIT) &&
+                                   mAsyncComputeIdx && mAsyncComputeIdx == mAsyncTransferIdx;
+    std::vector<float> sharedAsyncPriorities = aQueuePriorities;
+    if(sharedAsyncPriorities.size() < 2) sharedAsyncPriorities.resize(2, aQueuePriorities.back());
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos(queueFamilyIndices.size());
     std::set<uint32_t>::const_iterator famIter = queueFamilyIndices.begin();
     size_t i = 0;
     while(famIter != queueFamilyIndices.end()){
+        uint32_t familyCount = std::max(mQueueFamilies[*famIter].mCount, 1u);
+        const std::vector<float>& priorities = (sharedAsyncFamily && *famIter == *mAsyncComputeIdx) ? sharedAsyncPriorities : aQueuePriorities;
         queueCreateInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfos[i].pNext = nullptr;
-        queueCreateInfos[i].queueCount = 1;
+        queueCreateInfos[i].flags = 0;
+        queueCreateInfos[i].queueCount = std::min(static_cast<uint32_t>(priorities.size()), familyCount);
         queueCreateInfos[i].queueFamilyIndex = *famIter;
-        queueCreateInfos[i].pQueuePriorities = &priorities;
+        queueCreateInfos[i].pQueuePriorities = priorities.data();
         ++famIter; ++i;
     }
 
+    std::vector<const char*> extensions = aExtensions;
+    void* createInfoPnext = aDeviceCreateInfoPnext;
+    VkPhysicalDeviceDescriptorIndexingFeatures bindlessFeatures = {};
+    if(aEnableBindless){
+        if(!supportsBindlessDescriptors()) throw std::runtime_error("Attempted to enable bindless descriptors on a device without descriptor indexing support!");
+
+        auto extMatch = [](const char* ext) -> bool {return(std::string(ext) == VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);};
+        if(vkutils::effective_api_version(mHandle) < VK_API_VERSION_1_2 && std::find_if(extensions.begin(), extensions.end(), extMatch) == extensions.end()){
+            extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
+
+        // The chain may hold at most one of these structs, so features go into one already present if possible
+        const VkPhysicalDeviceDescriptorIndexingFeatures supported = query_descriptor_indexing_features(mHandle);
+        if(VkBaseOutStructure* core12 = pnext_chain_find(aDeviceCreateInfoPnext, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES)){
+            VkPhysicalDeviceVulkan12Features* features = reinterpret_cast<VkPhysicalDeviceVulkan12Features*>(core12);
+            features->descriptorIndexing = VK_TRUE;
+            enable_bindless_features(*features, supported);
+        }else if(VkBaseOutStructure* indexing = pnext_chain_find(aDeviceCreateInfoPnext, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES)){
+            enable_bindless_features(*reinterpret_cast<VkPhysicalDeviceDescriptorIndexingFeatures*>(indexing), supported);
+        }else{
+            bindlessFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+            bindlessFeatures.pNext = aDeviceCreateInfoPnext;
+            enable_bindless_features(bindlessFeatures, supported);
+            createInfoPnext = &bindlessFeatures;
+        }
+    }
+
     VkDeviceCreateInfo createInfo;
     {
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.pNext = aDeviceCreateInfoPnext;
-        createInfo.pEnabledFeatures = (aDeviceCreateInfoPnext == nullptr) ? &aFeatures : nullptr;
+        createInfo.pNext = createInfoPnext;
+        // VkPhysicalDeviceFeatures2 in the chain replaces pEnabledFeatures, and the two may not be used together
+        bool hasFeatures2 = pnext_chain_contains(aDeviceCreateInfoPnext, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2);
+        createInfo.pEnabledFeatures = hasFeatures2 ? nullptr : &aFeatures;
         createInfo.flags = 0;
         createInfo.ppEnabledLayerNames = nullptr;
         createInfo.enabledLayerCount = 0;
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-        createInfo.ppEnabledExtensionNames = aExtensions.data();
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(aExtensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     }
 
     return(createLogicalDevice(createInfo, presentationIdx));
@@ -5,6 +5,10 @@
 #include <vector>
 #include <stdexcept>
 #include <limits>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 class QueueFamily
 {
@@ -42,6 +46,98 @@ struct VulkanDeviceHandlePair
    friend bool operator!=(const VulkanDeviceHandlePair& lhs, const VulkanDeviceHandlePair& rhs){return(!operator==(lhs, rhs));}
 };
 
+template<>
+struct std::hash<VulkanDeviceHandlePair>{
+    size_t operator()(const VulkanDeviceHandlePair& aDevicePair) const noexcept{
+        return(
+            std::hash<VkDevice>()(aDevicePair.device)
+            ^
+            std::hash<VkPhysicalDevice>()(aDevicePair.physicalDevice)
+        );
+    }
+};
+
+/// The queues a logical device was created with from a single family.
+///
+/// Work is spread across the queues by leasing one with acquireRoundRobin() or acquireLeastLoaded().
+/// A queue may be leased by several users at once; VkQueue access is externally synchronized, so
+/// submissions through a lease are serialized against other leases of the same queue. Queue 0 of
+/// each family is also returned by VulkanLogicalDevice's per-role getters, and work submitted
+/// directly to those handles bypasses the pool's locking.
+class QueuePool : public std::enable_shared_from_this<QueuePool>
+{
+ public:
+    /// Holds one queue of the pool until destroyed or released
+    class Lease
+    {
+     public:
+        Lease(){}
+        ~Lease() {release();}
+
+        Lease(Lease&& aOther) noexcept;
+        Lease& operator=(Lease&& aOther) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        bool isValid() const {return(_mPool != nullptr);}
+        VkQueue getQueue() const;
+        uint32_t getFamilyIdx() const;
+        size_t getIndex() const {return(_mIndex);}
+
+        /// vkQueueSubmit under the queue's lock
+        VkResult submit(uint32_t aSubmitCount, const VkSubmitInfo* aSubmits, VkFence aFence = VK_NULL_HANDLE) const;
+
+        /// Locks the queue for other externally synchronized calls, e.g. vkQueuePresentKHR
+        std::unique_lock<std::mutex> lock() const;
+
+        void release();
+
+        operator VkQueue() const {return(getQueue());}
+
+     protected:
+        friend class QueuePool;
+        Lease(const std::shared_ptr<QueuePool>& aPool, size_t aIndex);
+
+     private:
+        std::shared_ptr<QueuePool> _mPool = nullptr;
+        size_t _mIndex = 0;
+    };
+
+    /// \param aQueues Queues retrieved from family `aFamilyIdx`, in index order
+    /// \param aPriorities Priority each queue was created with
+    QueuePool(uint32_t aFamilyIdx, const std::vector<VkQueue>& aQueues, const std::vector<float>& aPriorities);
+
+    /// Leases the queue after the one handed out last
+    Lease acquireRoundRobin();
+
+    /// Leases the queue with the fewest outstanding leases, preferring higher priority queues on ties
+    Lease acquireLeastLoaded();
+
+    size_t size() const {return(_mQueues.size());}
+    uint32_t getFamilyIdx() const {return(_mFamilyIdx);}
+    VkQueue getQueue(size_t aIndex) const {return(_mQueues.at(aIndex)->mQueue);}
+    float getPriority(size_t aIndex) const {return(_mQueues.at(aIndex)->mPriority);}
+
+    /// Number of outstanding leases on queue `aIndex`
+    uint32_t getLoad(size_t aIndex) const {return(_mQueues.at(aIndex)->mLeases.load());}
+
+ protected:
+    struct PooledQueue
+    {
+        VkQueue mQueue = VK_NULL_HANDLE;
+        float mPriority = 1.0f;
+        std::atomic<uint32_t> mLeases = {0};
+        std::mutex mMutex;
+    };
+
+    Lease _lease(size_t aIndex);
+
+ private:
+    uint32_t _mFamilyIdx;
+    std::vector<std::unique_ptr<PooledQueue>> _mQueues;
+    std::atomic<size_t> _mNextIdx = {0};
+};
+
 class VulkanLogicalDevice
 {
  public:
@@ -59,6 +155,25 @@ class VulkanLogicalDevice
     VkQueue getProtectedQueue() const {return(mProtectedQueue);}
     VkQueue getPresentationQueue() const {return(mPresentationQueue);}
 
+    /// Queue from a compute family without graphics support, or VK_NULL_HANDLE if the device has none.
+    /// Work submitted here can overlap work on the graphics queue.
+    VkQueue getAsyncComputeQueue() const {return(mAsyncComputeQueue);}
+    /// Queue from a transfer family without graphics or compute support, or failing that one without graphics.
+    /// VK_NULL_HANDLE if the device has neither. When it shares the async compute family it is a different
+    /// queue of that family if the family has more than one.
+    VkQueue getAsyncTransferQueue() const {return(mAsyncTransferQueue);}
+
+    bool hasAsyncComputeQueue() const {return(mAsyncComputeQueue != VK_NULL_HANDLE);}
+    bool hasAsyncTransferQueue() const {return(mAsyncTransferQueue != VK_NULL_HANDLE);}
+
+    /// True if the async compute and transfer queues are the same VkQueue, so submissions to them must be
+    /// synchronized together and won't overlap
+    bool asyncQueuesAlias() const {return(hasAsyncComputeQueue() && mAsyncComputeQueue == mAsyncTransferQueue);}
+
+    /// Pool holding every queue created from family `aFamilyIdx`, or nullptr if the device has none
+    std::shared_ptr<QueuePool> getQueuePool(uint32_t aFamilyIdx) const;
+    const std::vector<std::shared_ptr<QueuePool>>& getQueuePools() const {return(mQueuePools);}
+
     operator VkDevice() const {return(mHandle);}
 
  protected:
@@ -74,6 +189,10 @@ class VulkanLogicalDevice
     VkQueue mSparseBindingQueue = VK_NULL_HANDLE;
     VkQueue mProtectedQueue = VK_NULL_HANDLE;
     VkQueue mPresentationQueue = VK_NULL_HANDLE;
+    VkQueue mAsyncComputeQueue = VK_NULL_HANDLE;
+    VkQueue mAsyncTransferQueue = VK_NULL_HANDLE;
+
+    std::vector<std::shared_ptr<QueuePool>> mQueuePools;
 };
 
 struct SwapChainSupportInfo;
@@ -90,15 +209,60 @@ class VulkanPhysicalDevice
    SwapChainSupportInfo getSwapChainSupportInfo(const VkSurfaceKHR aSurface) const;
 
    opt::optional<uint32_t> getPresentableQueueIndex(const VkSurfaceKHR aSurface) const;
+
+   /// True if the device can enable timeline semaphores, either as Vulkan 1.2 core or through VK_KHR_timeline_semaphore.
+   /// Requires an instance created with Vulkan 1.1 or later.
+   bool supportsTimelineSemaphores() const;
+
+   /// True if the device can enable the descriptor indexing features used by vkutils::BindlessTable, either as
+   /// Vulkan 1.2 core or through VK_EXT_descriptor_indexing: partially bound, runtime sized arrays of storage
+   /// buffers, sampled images and storage images that can be updated after binding and while unused but pending.
+   /// Requires vkGetPhysicalDeviceFeatures2, from a Vulkan 1.1 instance (see VULKAN_BASE_VK_API_VERSION) or
+   /// VK_KHR_get_physical_device_properties2 enabled on the instance given to VmaHost.
+   bool supportsBindlessDescriptors() const;
    
+   /// Creates a logical device with one queue from each family needed for `aQueues`.
+   ///
+   /// Requesting VK_QUEUE_COMPUTE_BIT or VK_QUEUE_TRANSFER_BIT also creates queues from the async compute
+   /// and async transfer families, when the device has them.
+   ///
+   /// `aDeviceCreateInfoPnext` is chained onto the VkDeviceCreateInfo, and may be used to enable features
+   /// such as VkPhysicalDeviceTimelineSemaphoreFeatures. `aFeatures` is still applied unless the chain
+   /// contains a VkPhysicalDeviceFeatures2, in which case that struct is used instead.
+   ///
+   /// `aEnableBindless` enables the features checked by supportsBindlessDescriptors(), along with non-uniform
+   /// indexing of those arrays where supported, and adds VK_EXT_descriptor_indexing on pre-1.2 devices. The
+   /// features are set in a VkPhysicalDeviceVulkan12Features or VkPhysicalDeviceDescriptorIndexingFeatures
+   /// already in the chain, or in a struct chained in front of it otherwise.
+   /// \throw std::runtime_error If device creation fails, or bindless descriptors are requested but unsupported
    VulkanLogicalDevice createLogicalDevice(
       VkQueueFlags aQueues,
       const std::vector<const char*>& aExtensions = std::vector<const char*>(),
       const VkPhysicalDeviceFeatures& aFeatures = {},
       VkSurfaceKHR aSurface = VK_NULL_HANDLE,
-      void* aDeviceCreateInfoPnext = nullptr
+      void* aDeviceCreateInfoPnext = nullptr,
+      bool aEnableBindless = false
+   ) const;
+
+   /// Like createLogicalDevice(), but requests several queues from each family and exposes them through
+   /// VulkanLogicalDevice::getQueuePool().
+   ///
+   /// Each family gets one queue per entry of `aQueuePriorities`, capped at the family's queue count,
+   /// created with the leading priorities. Priorities must lie within [0, 1]. A family serving both async
+   /// compute and async transfer gets at least two queues, the extra one repeating the last priority.
+   /// \throw std::runtime_error If `aQueuePriorities` is empty or device creation fails
+   VulkanLogicalDevice createPooledLogicalDevice(
+      VkQueueFlags aQueues,
+      const std::vector<float>& aQueuePriorities,
+      const std::vector<const char*>& aExtensions = std::vector<const char*>(),
+      const VkPhysicalDeviceFeatures& aFeatures = {},
+      VkSurfaceKHR aSurface = VK_NULL_HANDLE,
+      void* aDeviceCreateInfoPnext = nullptr,
+      bool aEnableBindless = false
    ) const;
 
+   /// Creates a logical device from a complete create info. Every queue requested by its queue create
+   /// infos is placed in a QueuePool for its family.
    VulkanLogicalDevice createLogicalDevice(
       const VkDeviceCreateInfo& aDeviceCreateInfo,
       const std::optional<uint32_t>& aPresentationIdx = std::nullopt
@@ -126,6 +290,11 @@ class VulkanPhysicalDevice
    opt::optional<uint32_t> mProtectedIdx;
    opt::optional<uint32_t> mSparseBindIdx;
 
+   // Compute family without graphics support
+   opt::optional<uint32_t> mAsyncComputeIdx;
+   // Transfer-only family, or failing that a transfer family without graphics support
+   opt::optional<uint32_t> mAsyncTransferIdx;
+
    // Index of queue supporting graphics, compute, transfer, and presentation
    opt::optional<uint32_t> coreFeaturesIdx; 
 
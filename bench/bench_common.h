@@ -0,0 +1,241 @@
+#ifndef VKUTILS_BENCH_COMMON_H_
+#define VKUTILS_BENCH_COMMON_H_
+#include "vkutils.h"
+#include "VmaHost.h"
+#include "PipelineCacheHost.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace bench{
+
+/// Instance and logical device for one benchmark run.
+///
+/// The physical device is the one at index VKUTILS_BENCH_DEVICE of vkEnumeratePhysicalDevices() when that
+/// variable is set, and vkutils::select_physical_device()'s pick (or the first device) otherwise.
+class BenchDevice
+{
+ public:
+    /// \param aOptionalExtensions Extensions enabled only when the device has them. Check with hasExtension().
+    /// \throw std::runtime_error If no instance or device can be created
+    explicit BenchDevice(
+        VkQueueFlags aQueues = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT,
+        const std::vector<const char*>& aExtensions = std::vector<const char*>(),
+        void* aDeviceCreateInfoPnext = nullptr,
+        const std::vector<const char*>& aOptionalExtensions = std::vector<const char*>()
+    ){
+        VkApplicationInfo appInfo = {};
+        {
+            appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+            appInfo.pApplicationName = "vkutils-bench";
+            appInfo.apiVersion = VK_API_VERSION_1_2;
+        }
+
+        VkInstanceCreateInfo instanceInfo = {};
+        {
+            instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+            instanceInfo.pApplicationInfo = &appInfo;
+        }
+        VkResult result = vkCreateInstance(&instanceInfo, nullptr, &mInstance);
+        if(result != VK_SUCCESS){
+            throw std::runtime_error("Failed to create benchmark instance! (" + std::string(vkutils::vk_result_str(result)) + ")");
+        }
+        VmaHost::setVkInstance(mInstance);
+
+        uint32_t count = 0;
+        vkEnumeratePhysicalDevices(mInstance, &count, nullptr);
+        std::vector<VkPhysicalDevice> devices(count);
+        vkEnumeratePhysicalDevices(mInstance, &count, devices.data());
+        if(devices.empty()) throw std::runtime_error("No Vulkan devices available for benchmarking!");
+
+        VkPhysicalDevice selected = vkutils::select_physical_device(devices);
+        if(const char* index = std::getenv("VKUTILS_BENCH_DEVICE")){
+            selected = devices.at(std::strtoul(index, nullptr, 10));
+        }
+        mPhysicalDevice = VulkanPhysicalDevice(selected != VK_NULL_HANDLE ? selected : devices.front());
+
+        std::vector<const char*> extensions = aExtensions;
+        for(const char* extension : aOptionalExtensions){
+            if(hasExtension(extension)) extensions.push_back(extension);
+        }
+        mLogicalDevice = mPhysicalDevice.createLogicalDevice(aQueues, extensions, {}, VK_NULL_HANDLE, aDeviceCreateInfoPnext);
+
+        std::printf("Device: %s\n", mPhysicalDevice.mProperties.deviceName);
+    }
+
+    ~BenchDevice(){
+        vkDeviceWaitIdle(mLogicalDevice.handle());
+        PipelineCacheHost::release(pair());
+        VmaHost::destroyAllocator(pair());
+        vkDestroyDevice(mLogicalDevice.handle(), nullptr);
+        vkDestroyInstance(mInstance, nullptr);
+    }
+
+    BenchDevice(const BenchDevice&) = delete;
+    BenchDevice& operator=(const BenchDevice&) = delete;
+
+    VulkanDeviceHandlePair pair() const {return(VulkanDeviceHandlePair(mLogicalDevice.handle(), mPhysicalDevice.handle()));}
+    VkDevice device() const {return(mLogicalDevice.handle());}
+
+    uint32_t computeFamily() const {return(mPhysicalDevice.mComputeIdx.value());}
+    VkQueue computeQueue() const {return(mLogicalDevice.getComputeQueue());}
+
+    bool hasExtension(const char* aName) const{
+        for(const VkExtensionProperties& extension : mPhysicalDevice.mAvailableExtensions){
+            if(std::string(extension.extensionName) == aName) return(true);
+        }
+        return(false);
+    }
+
+    VkInstance mInstance = VK_NULL_HANDLE;
+    VulkanPhysicalDevice mPhysicalDevice;
+    VulkanLogicalDevice mLogicalDevice;
+};
+
+class Stopwatch
+{
+ public:
+    Stopwatch() : _mStart(std::chrono::steady_clock::now()) {}
+
+    void restart() {_mStart = std::chrono::steady_clock::now();}
+    double seconds() const {return(std::chrono::duration<double>(std::chrono::steady_clock::now() - _mStart).count());}
+
+ private:
+    std::chrono::steady_clock::time_point _mStart;
+};
+
+/// Pair of small device local buffers for timing tiny one-shot copies. Destroyed after the device goes idle.
+class CopyBuffers
+{
+ public:
+    static constexpr VkDeviceSize kSize = 256;
+
+    explicit CopyBuffers(const VulkanDeviceHandlePair& aDevicePair) : _mDevicePair(aDevicePair){
+        VkBufferCreateInfo bufferInfo = {};
+        {
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = kSize;
+            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        VmaAllocator allocator = VmaHost::getAllocator(aDevicePair);
+        if(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &mSrc, &_mSrcAllocation, nullptr) != VK_SUCCESS ||
+           vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &mDst, &_mDstAllocation, nullptr) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create benchmark copy buffers!");
+        }
+    }
+
+    ~CopyBuffers(){
+        vkDeviceWaitIdle(_mDevicePair.device);
+        VmaAllocator allocator = VmaHost::getAllocator(_mDevicePair);
+        vmaDestroyBuffer(allocator, mSrc, _mSrcAllocation);
+        vmaDestroyBuffer(allocator, mDst, _mDstAllocation);
+    }
+
+    CopyBuffers(const CopyBuffers&) = delete;
+    CopyBuffers& operator=(const CopyBuffers&) = delete;
+
+    VkBuffer mSrc = VK_NULL_HANDLE;
+    VkBuffer mDst = VK_NULL_HANDLE;
+
+ private:
+    VulkanDeviceHandlePair _mDevicePair;
+    VmaAllocation _mSrcAllocation = nullptr;
+    VmaAllocation _mDstAllocation = nullptr;
+};
+
+inline void record_copy(VkCommandBuffer aCmdBuffer, const CopyBuffers& aBuffers){
+    VkBufferCopy region = {0, 0, CopyBuffers::kSize};
+    vkCmdCopyBuffer(aCmdBuffer, aBuffers.mSrc, aBuffers.mDst, 1, &region);
+}
+
+/// Prints one result line: total time, rate and time per operation
+inline void report(const std::string& aName, uint64_t aCount, double aSeconds){
+    std::printf(
+        "%-44s %10llu ops %10.2f ms %12.0f ops/s %10.3f us/op\n",
+        aName.c_str(), static_cast<unsigned long long>(aCount), aSeconds * 1e3,
+        aSeconds > 0.0 ? aCount / aSeconds : 0.0, aCount != 0 ? aSeconds * 1e6 / aCount : 0.0
+    );
+}
+
+/// Integer argument `aIndex` of the command line, or `aDefault` if absent
+inline uint64_t arg_or(int argc, char** argv, int aIndex, uint64_t aDefault){
+    return(aIndex < argc ? std::strtoull(argv[aIndex], nullptr, 10) : aDefault);
+}
+
+/// SPIR-V 1.0 compute shader with a 1x1x1 workgroup that stores `aValue` into the first word of the
+/// storage buffer at set 0, binding 0. Distinct values give distinct modules for cache benchmarks.
+/// \param aPaddingWords Size of an OpSourceExtension string added to make the module larger, up to 65000 words
+inline std::vector<uint32_t> make_compute_spirv(uint32_t aValue, uint32_t aPaddingWords = 0){
+    enum : uint32_t {
+        idVoid = 1, idFunc, idUint, idBlock, idBlockPtr, idUintPtr, idBuffer, idZero, idValue, idMain, idLabel, idElement, idBound
+    };
+    auto op = [](uint32_t aWordCount, uint32_t aOpcode){return((aWordCount << 16) | aOpcode);};
+
+    std::vector<uint32_t> code = {
+        0x07230203, 0x00010000, 0, idBound, 0,
+        op(2, 17), 1,                                   // OpCapability Shader
+        op(3, 14), 0, 1,                                // OpMemoryModel Logical GLSL450
+        op(5, 15), 5, idMain, 0x6E69616D, 0,            // OpEntryPoint GLCompute %main "main"
+        op(6, 16), idMain, 17, 1, 1, 1                  // OpExecutionMode %main LocalSize 1 1 1
+    };
+
+    // OpSourceExtension with a string of 'x's, terminated by a zero word
+    aPaddingWords = std::min<uint32_t>(aPaddingWords, 65000);
+    if(aPaddingWords != 0){
+        code.push_back(op(aPaddingWords + 2, 4));
+        code.insert(code.end(), aPaddingWords, 0x78787878);
+        code.push_back(0);
+    }
+
+    code.insert(code.end(), {
+        op(3, 71), idBlock, 3,                          // OpDecorate %block BufferBlock
+        op(5, 72), idBlock, 0, 35, 0,                   // OpMemberDecorate %block 0 Offset 0
+        op(4, 71), idBuffer, 34, 0,                     // OpDecorate %buffer DescriptorSet 0
+        op(4, 71), idBuffer, 33, 0,                     // OpDecorate %buffer Binding 0
+        op(2, 19), idVoid,                              // OpTypeVoid
+        op(3, 33), idFunc, idVoid,                      // OpTypeFunction %void
+        op(4, 21), idUint, 32, 0,                       // OpTypeInt 32 0
+        op(3, 30), idBlock, idUint,                     // OpTypeStruct %uint
+        op(4, 32), idBlockPtr, 2, idBlock,              // OpTypePointer Uniform %block
+        op(4, 32), idUintPtr, 2, idUint,                // OpTypePointer Uniform %uint
+        op(4, 43), idUint, idZero, 0,                   // OpConstant %uint 0
+        op(4, 43), idUint, idValue, aValue,             // OpConstant %uint aValue
+        op(4, 59), idBlockPtr, idBuffer, 2,             // OpVariable %blockPtr Uniform
+        op(5, 54), idVoid, idMain, 0, idFunc,           // OpFunction %void None %func
+        op(2, 248), idLabel,                            // OpLabel
+        op(5, 65), idUintPtr, idElement, idBuffer, idZero, // OpAccessChain %uintPtr %buffer %zero
+        op(3, 62), idElement, idValue,                  // OpStore %element %value
+        op(1, 253),                                     // OpReturn
+        op(1, 56)                                       // OpFunctionEnd
+    });
+    return(code);
+}
+
+/// Builds a compute pipeline for `aCode` with its layout reflected from the code
+/// \param aPushDescriptorSet Set of the layout to create as a push descriptor set, if any
+inline vkutils::VulkanComputePipeline build_compute_pipeline(
+    const VulkanDeviceHandlePair& aDevicePair, const std::vector<uint32_t>& aCode, VkPipelineCache aCache,
+    uint32_t aPushDescriptorSet = vkutils::PipelineLayoutDescription::kNoPushDescriptorSet
+){
+    VkShaderModule module = vkutils::create_shader_module(aDevicePair.device, aCode.data(), aCode.size() * sizeof(uint32_t));
+
+    vkutils::ComputePipelineConstructionSet ctorSet;
+    vkutils::VulkanComputePipelineBuilder::prepareUnspecialized(ctorSet, module);
+    vkutils::VulkanComputePipelineBuilder::reflectLayout(ctorSet, vkutils::ShaderReflection::reflect(aCode.data(), aCode.size() * sizeof(uint32_t)));
+    ctorSet.mPushDescriptorSet = aPushDescriptorSet;
+    vkutils::VulkanComputePipelineBuilder builder(ctorSet);
+    vkutils::VulkanComputePipeline pipeline = builder.build(aDevicePair.device, aCache);
+
+    vkDestroyShaderModule(aDevicePair.device, module, nullptr);
+    return(pipeline);
+}
+
+} // end namespace bench
+
+#endif
@@ -0,0 +1,57 @@
+// Cold vs warm startup through PipelineCacheHost.
+//
+// Each run creates a fresh device and builds the same set of distinct compute pipelines through the
+// device's pipeline cache, then releases the cache (saving it) and the device, as a process would on
+// shutdown. The first run starts from an empty cache directory; later runs load the blob it wrote.
+//
+// Usage: pipeline_cache_bench [pipeline count = 256] [warm runs = 3]
+#include "bench_common.h"
+#include "PipelineCacheHost.h"
+#include <filesystem>
+
+namespace{
+
+double run_startup(const std::vector<std::vector<uint32_t>>& aShaders){
+    bench::Stopwatch timer;
+    bench::BenchDevice device;
+    VkPipelineCache cache = PipelineCacheHost::getCache(device.pair());
+
+    std::vector<vkutils::VulkanComputePipeline> pipelines;
+    pipelines.reserve(aShaders.size());
+    for(const std::vector<uint32_t>& code : aShaders){
+        pipelines.push_back(bench::build_compute_pipeline(device.pair(), code, cache));
+    }
+    const double seconds = timer.seconds();
+
+    for(vkutils::VulkanComputePipeline& pipeline : pipelines){
+        pipeline.destroy(device.device());
+    }
+    PipelineCacheHost::release(device.pair());
+    return(seconds);
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv){
+    const uint64_t pipelineCount = bench::arg_or(argc, argv, 1, 256);
+    const uint64_t warmRuns = bench::arg_or(argc, argv, 2, 3);
+
+    std::vector<std::vector<uint32_t>> shaders;
+    for(uint64_t i = 0; i < pipelineCount; ++i){
+        shaders.push_back(bench::make_compute_spirv(static_cast<uint32_t>(i)));
+    }
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vkutils_pipeline_cache_bench";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    PipelineCacheHost::setCacheDirectory(directory.string());
+
+    bench::report("cold startup (empty cache)", pipelineCount, run_startup(shaders));
+    for(uint64_t i = 0; i < warmRuns; ++i){
+        bench::report("warm startup (cache loaded from disk)", pipelineCount, run_startup(shaders));
+    }
+
+    PipelineCacheHost::setCacheDirectory("");
+    std::filesystem::remove_all(directory);
+    return(0);
+}
@@ -0,0 +1,140 @@
+// Host CPU cost of binding a storage buffer per dispatch, with descriptor sets from DescriptorAllocator
+// vs vkCmdPushDescriptorSetKHR through PushDescriptorRecorder.
+//
+// "pool-allocated" allocates a set from the frame's pools, writes it with vkUpdateDescriptorSets and
+// binds it before each dispatch. "push descriptors" records the write straight into the command
+// buffer. Only recording is timed; each round is submitted and waited on outside the timer, after
+// which the allocator's pools are reset.
+//
+// Usage: push_descriptor_bench [dispatch count = 100000]
+#include "bench_common.h"
+
+namespace{
+
+constexpr uint64_t kRoundSize = 1024;
+
+/// Small device local storage buffer the benchmark shader writes to
+class StorageBuffer
+{
+ public:
+    explicit StorageBuffer(const VulkanDeviceHandlePair& aDevicePair) : _mDevicePair(aDevicePair){
+        VkBufferCreateInfo bufferInfo = {};
+        {
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = 256;
+            bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if(vmaCreateBuffer(VmaHost::getAllocator(aDevicePair), &bufferInfo, &allocInfo, &mBuffer, &_mAllocation, nullptr) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create benchmark storage buffer!");
+        }
+    }
+
+    ~StorageBuffer(){
+        vkDeviceWaitIdle(_mDevicePair.device);
+        vmaDestroyBuffer(VmaHost::getAllocator(_mDevicePair), mBuffer, _mAllocation);
+    }
+
+    StorageBuffer(const StorageBuffer&) = delete;
+    StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+
+ private:
+    VulkanDeviceHandlePair _mDevicePair;
+    VmaAllocation _mAllocation = nullptr;
+};
+
+/// Records `aCount` dispatches in rounds, timing only the calls to `aRecord`. `aAfterRound` runs once
+/// each round's work has completed.
+template<typename RecordFunc, typename RoundFunc>
+double run_rounds(vkutils::QueueClosure& aClosure, uint64_t aCount, RecordFunc aRecord, RoundFunc aAfterRound){
+    double seconds = 0.0;
+    for(uint64_t done = 0; done < aCount; done += kRoundSize){
+        const uint64_t roundSize = std::min(kRoundSize, aCount - done);
+        VkCommandBuffer cmdBuffer = aClosure.beginOneSubmitCommands();
+
+        bench::Stopwatch timer;
+        for(uint64_t i = 0; i < roundSize; ++i) aRecord(cmdBuffer);
+        seconds += timer.seconds();
+
+        aClosure.finishOneSubmitCommands(cmdBuffer);
+        aAfterRound();
+    }
+    return(seconds);
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv){
+    const uint64_t dispatchCount = bench::arg_or(argc, argv, 1, 100000);
+
+    bench::BenchDevice device(VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, {}, nullptr, {VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME});
+    StorageBuffer storage(device.pair());
+    vkutils::QueueClosure closure(device.pair(), device.computeFamily(), device.computeQueue());
+    const std::vector<uint32_t> code = bench::make_compute_spirv(0);
+
+    {
+        vkutils::VulkanComputePipeline pipeline = bench::build_compute_pipeline(device.pair(), code, VK_NULL_HANDLE);
+
+        // Same description the pipeline layout was built from, so the cache hands back its set layout
+        const vkutils::PipelineLayoutDescription description = vkutils::PipelineLayoutDescription::fromReflection(
+            {vkutils::ShaderReflection::reflect(code.data(), code.size() * sizeof(uint32_t))}
+        );
+        vkutils::DescriptorSetLayoutRef setLayout;
+        vkutils::PipelineLayoutCache::forDevice(device.device())->getSetLayout(description.mSetLayouts.at(0), setLayout);
+
+        vkutils::DescriptorAllocator allocator(device.device(), 1);
+        VkDescriptorBufferInfo bufferInfo = {storage.mBuffer, 0, VK_WHOLE_SIZE};
+
+        const double seconds = run_rounds(closure, dispatchCount, [&](VkCommandBuffer aCmdBuffer){
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            allocator.allocate(setLayout, set);
+
+            VkWriteDescriptorSet write = {};
+            {
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet = set;
+                write.dstBinding = 0;
+                write.descriptorCount = 1;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                write.pBufferInfo = &bufferInfo;
+            }
+            vkUpdateDescriptorSets(device.device(), 1, &write, 0, nullptr);
+
+            vkCmdBindPipeline(aCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.handle());
+            vkCmdBindDescriptorSets(aCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getLayout(), 0, 1, &set, 0, nullptr);
+            vkCmdDispatch(aCmdBuffer, 1, 1, 1);
+        }, [&](){allocator.resetAll();});
+        bench::report("pool-allocated set per dispatch", dispatchCount, seconds);
+
+        const vkutils::DescriptorAllocatorStats stats = allocator.stats();
+        std::printf(
+            "  %llu sets allocated, %zu pools created, %llu pool growths\n",
+            static_cast<unsigned long long>(stats.mSetsAllocated), stats.mPoolsCreated, static_cast<unsigned long long>(stats.mPoolGrowths)
+        );
+        pipeline.destroy(device.device());
+    }
+
+    if(!device.hasExtension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)){
+        std::printf("%s is not supported, skipping push descriptors\n", VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+        return(0);
+    }
+
+    {
+        vkutils::VulkanComputePipeline pipeline = bench::build_compute_pipeline(device.pair(), code, VK_NULL_HANDLE, 0);
+        vkutils::PushDescriptorRecorder recorder(device.device());
+
+        const double seconds = run_rounds(closure, dispatchCount, [&](VkCommandBuffer aCmdBuffer){
+            vkCmdBindPipeline(aCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.handle());
+            recorder.clear().storageBuffer(0, storage.mBuffer).push(aCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getLayout(), 0);
+            vkCmdDispatch(aCmdBuffer, 1, 1, 1);
+        }, [](){});
+        bench::report("push descriptors per dispatch", dispatchCount, seconds);
+        pipeline.destroy(device.device());
+    }
+    return(0);
+}
@@ -0,0 +1,86 @@
+// Submits per second for tiny one-shot copies through QueueClosure.
+//
+// "create/destroy pool" reproduces the old QueueClosure path: a command pool created, used for one
+// command buffer and destroyed around every submit. "recycled" goes through beginOneSubmitCommands()
+// without a pool, which reuses the calling thread's pool and retired command buffers.
+//
+// Usage: queue_closure_bench [submit count = 10000]
+#include "bench_common.h"
+
+namespace{
+
+double run_pool_per_submit(const bench::BenchDevice& aDevice, const bench::CopyBuffers& aBuffers, uint64_t aCount){
+    VkFence fence = VK_NULL_HANDLE;
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    vkCreateFence(aDevice.device(), &fenceInfo, nullptr, &fence);
+
+    bench::Stopwatch timer;
+    for(uint64_t i = 0; i < aCount; ++i){
+        VkCommandPoolCreateInfo poolInfo = {};
+        {
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = aDevice.computeFamily();
+        }
+        VkCommandPool pool = VK_NULL_HANDLE;
+        vkCreateCommandPool(aDevice.device(), &poolInfo, nullptr, &pool);
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        {
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+        }
+        VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+        vkAllocateCommandBuffers(aDevice.device(), &allocInfo, &cmdBuffer);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+        bench::record_copy(cmdBuffer, aBuffers);
+        vkEndCommandBuffer(cmdBuffer);
+
+        VkSubmitInfo submitInfo = vkutils::sSingleSubmitTemplate;
+        submitInfo.pCommandBuffers = &cmdBuffer;
+        vkQueueSubmit(aDevice.computeQueue(), 1, &submitInfo, fence);
+        vkWaitForFences(aDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+        vkResetFences(aDevice.device(), 1, &fence);
+
+        vkDestroyCommandPool(aDevice.device(), pool, nullptr);
+    }
+    const double seconds = timer.seconds();
+
+    vkDestroyFence(aDevice.device(), fence, nullptr);
+    return(seconds);
+}
+
+double run_recycled(const bench::BenchDevice& aDevice, const bench::CopyBuffers& aBuffers, uint64_t aCount){
+    vkutils::QueueClosure closure(aDevice.pair(), aDevice.computeFamily(), aDevice.computeQueue());
+
+    bench::Stopwatch timer;
+    for(uint64_t i = 0; i < aCount; ++i){
+        VkCommandBuffer cmdBuffer = closure.beginOneSubmitCommands();
+        bench::record_copy(cmdBuffer, aBuffers);
+        closure.finishOneSubmitCommands(cmdBuffer);
+    }
+    return(timer.seconds());
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv){
+    const uint64_t submitCount = bench::arg_or(argc, argv, 1, 10000);
+
+    bench::BenchDevice device;
+    bench::CopyBuffers buffers(device.pair());
+
+    // Warm up driver paths and the recycler's pool before measuring
+    run_recycled(device, buffers, 100);
+
+    bench::report("one-shot copy, create/destroy pool", submitCount, run_pool_per_submit(device, buffers, submitCount));
+    bench::report("one-shot copy, recycled pool and buffers", submitCount, run_recycled(device, buffers, submitCount));
+    return(0);
+}
@@ -0,0 +1,69 @@
+// Startup time for loading a large shader set from disk, with load_shader_module() vs ShaderModuleCache.
+//
+// Writes a set of distinct SPIR-V files, then loads each of them once per pipeline that uses it, as a
+// renderer building several pipelines from shared shaders would. load_shader_module() reads every
+// file into a vector and creates a module per call. ShaderModuleCache maps the file, hashes it and
+// creates each module once.
+//
+// Usage: shader_module_cache_bench [shader count = 512] [pipelines per shader = 4] [words per shader = 4096]
+#include "bench_common.h"
+#include <filesystem>
+#include <fstream>
+
+int main(int argc, char** argv){
+    const uint64_t shaderCount = bench::arg_or(argc, argv, 1, 512);
+    const uint64_t usesPerShader = bench::arg_or(argc, argv, 2, 4);
+    const uint32_t paddingWords = static_cast<uint32_t>(bench::arg_or(argc, argv, 3, 4096));
+    const uint64_t loadCount = shaderCount * usesPerShader;
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vkutils_shader_module_cache_bench";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::string> paths;
+    for(uint64_t i = 0; i < shaderCount; ++i){
+        const std::vector<uint32_t> code = bench::make_compute_spirv(static_cast<uint32_t>(i), paddingWords);
+        paths.push_back((directory / ("shader_" + std::to_string(i) + ".spv")).string());
+        std::ofstream file(paths.back(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+    }
+
+    bench::BenchDevice device;
+
+    {
+        std::vector<VkShaderModule> modules;
+        modules.reserve(loadCount);
+        bench::Stopwatch timer;
+        for(uint64_t use = 0; use < usesPerShader; ++use){
+            for(const std::string& path : paths){
+                modules.push_back(vkutils::load_shader_module(device.device(), path));
+            }
+        }
+        bench::report("load_shader_module per use", loadCount, timer.seconds());
+
+        for(VkShaderModule module : modules) vkDestroyShaderModule(device.device(), module, nullptr);
+    }
+
+    {
+        std::shared_ptr<vkutils::ShaderModuleCache> cache = vkutils::ShaderModuleCache::forDevice(device.device());
+        std::vector<vkutils::ShaderModuleRef> modules;
+        modules.reserve(loadCount);
+        bench::Stopwatch timer;
+        for(uint64_t use = 0; use < usesPerShader; ++use){
+            for(const std::string& path : paths){
+                modules.push_back(cache->load(path));
+            }
+        }
+        bench::report("ShaderModuleCache::load per use", loadCount, timer.seconds());
+
+        const vkutils::ShaderCacheStats stats = cache->stats();
+        std::printf(
+            "  %llu hits, %llu misses, %llu MiB hashed, %zu live modules\n",
+            static_cast<unsigned long long>(stats.mHits), static_cast<unsigned long long>(stats.mMisses),
+            static_cast<unsigned long long>(stats.mBytesHashed >> 20), stats.mLiveModules
+        );
+    }
+
+    std::filesystem::remove_all(directory);
+    return(0);
+}
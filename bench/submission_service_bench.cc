@@ -0,0 +1,74 @@
+// Multi-threaded submission stress test: producers sharing one queue through an application mutex
+// vs through QueueSubmissionService.
+//
+// Every producer thread records tiny copies into its own recycled command buffers and submits them,
+// waiting on its outstanding work every few hundred submissions.
+//
+// Usage: submission_service_bench [threads = hardware concurrency] [submits per thread = 5000]
+#include "bench_common.h"
+#include <thread>
+
+namespace{
+
+constexpr uint64_t kRoundSize = 256;
+
+template<typename SubmitFunc>
+double run_producers(uint32_t aThreadCount, uint64_t aPerThread, vkutils::QueueClosure& aClosure, const bench::CopyBuffers& aBuffers, SubmitFunc aSubmit){
+    bench::Stopwatch timer;
+    std::vector<std::thread> threads;
+    for(uint32_t t = 0; t < aThreadCount; ++t){
+        threads.emplace_back([&](){
+            std::vector<vkutils::SubmissionFuture> futures;
+            for(uint64_t i = 0; i < aPerThread; ++i){
+                VkCommandBuffer cmdBuffer = aClosure.beginOneSubmitCommands();
+                bench::record_copy(cmdBuffer, aBuffers);
+                futures.push_back(aSubmit(cmdBuffer));
+                if(futures.size() == kRoundSize){
+                    for(const vkutils::SubmissionFuture& future : futures) future.wait();
+                    futures.clear();
+                }
+            }
+            for(const vkutils::SubmissionFuture& future : futures) future.wait();
+        });
+    }
+    for(std::thread& thread : threads) thread.join();
+    return(timer.seconds());
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv){
+    const uint32_t threadCount = static_cast<uint32_t>(bench::arg_or(argc, argv, 1, std::max(std::thread::hardware_concurrency(), 1U)));
+    const uint64_t perThread = bench::arg_or(argc, argv, 2, 5000);
+    const uint64_t total = threadCount * perThread;
+
+    bench::BenchDevice device;
+    bench::CopyBuffers buffers(device.pair());
+    vkutils::QueueClosure closure(device.pair(), device.computeFamily(), device.computeQueue());
+    std::printf("Producer threads: %u\n", threadCount);
+
+    std::mutex queueMutex;
+    double seconds = run_producers(threadCount, perThread, closure, buffers, [&](VkCommandBuffer aCmdBuffer){
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return(closure.finishOneSubmitCommandsAsync(aCmdBuffer));
+    });
+    bench::report("application mutex around vkQueueSubmit", total, seconds);
+
+    vkutils::SubmissionServiceStats stats;
+    {
+        vkutils::QueueSubmissionService service(closure);
+        seconds = run_producers(threadCount, perThread, closure, buffers, [&](VkCommandBuffer aCmdBuffer){
+            return(service.submit(aCmdBuffer));
+        });
+        stats = service.stats();
+    }
+    bench::report("QueueSubmissionService", total, seconds);
+    std::printf(
+        "  %llu vkQueueSubmit calls, %.1f submissions per call, average latency %.2f us, max latency %.2f us\n",
+        static_cast<unsigned long long>(stats.mQueueSubmitCalls),
+        stats.mQueueSubmitCalls != 0 ? static_cast<double>(stats.mSubmissions) / stats.mQueueSubmitCalls : 0.0,
+        stats.averageLatencyMicroseconds(),
+        std::chrono::duration<double, std::micro>(stats.mMaxLatency).count()
+    );
+    return(0);
+}
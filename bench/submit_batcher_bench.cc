@@ -0,0 +1,73 @@
+// Host CPU cost per submission, one vkQueueSubmit each vs coalesced through SubmitBatcher.
+//
+// Submissions are tiny copies recorded into recycled command buffers. Only recording and submission
+// are timed; each round of submissions is waited on outside the timer.
+//
+// Usage: submit_batcher_bench [submit count = 20000]
+#include "bench_common.h"
+
+namespace{
+
+constexpr uint64_t kRoundSize = 256;
+
+double run_individual(vkutils::QueueClosure& aClosure, const bench::CopyBuffers& aBuffers, uint64_t aCount){
+    double seconds = 0.0;
+    std::vector<vkutils::SubmissionFuture> futures;
+    for(uint64_t done = 0; done < aCount; done += kRoundSize){
+        const uint64_t roundSize = std::min(kRoundSize, aCount - done);
+        bench::Stopwatch timer;
+        for(uint64_t i = 0; i < roundSize; ++i){
+            VkCommandBuffer cmdBuffer = aClosure.beginOneSubmitCommands();
+            bench::record_copy(cmdBuffer, aBuffers);
+            futures.push_back(aClosure.finishOneSubmitCommandsAsync(cmdBuffer));
+        }
+        seconds += timer.seconds();
+
+        for(const vkutils::SubmissionFuture& future : futures) future.wait();
+        futures.clear();
+    }
+    return(seconds);
+}
+
+double run_batched(vkutils::QueueClosure& aClosure, const bench::CopyBuffers& aBuffers, uint64_t aCount, uint32_t aBatchSize){
+    vkutils::SubmitBatchLimits limits;
+    limits.mMaxSubmissions = aBatchSize;
+    vkutils::SubmitBatcher batcher(aClosure, limits);
+
+    double seconds = 0.0;
+    std::vector<vkutils::SubmissionFuture> futures;
+    for(uint64_t done = 0; done < aCount; done += kRoundSize){
+        const uint64_t roundSize = std::min(kRoundSize, aCount - done);
+        bench::Stopwatch timer;
+        for(uint64_t i = 0; i < roundSize; ++i){
+            VkCommandBuffer cmdBuffer = aClosure.beginOneSubmitCommands();
+            bench::record_copy(cmdBuffer, aBuffers);
+            futures.push_back(batcher.enqueue(cmdBuffer, {}, {}, bench::CopyBuffers::kSize));
+        }
+        batcher.flush();
+        seconds += timer.seconds();
+
+        for(const vkutils::SubmissionFuture& future : futures) future.wait();
+        futures.clear();
+    }
+    return(seconds);
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv){
+    const uint64_t submitCount = bench::arg_or(argc, argv, 1, 20000);
+
+    bench::BenchDevice device;
+    bench::CopyBuffers buffers(device.pair());
+    vkutils::QueueClosure closure(device.pair(), device.computeFamily(), device.computeQueue());
+
+    // Warm up the recycler so both modes reuse command buffers
+    run_individual(closure, buffers, kRoundSize);
+
+    bench::report("one vkQueueSubmit per submission", submitCount, run_individual(closure, buffers, submitCount));
+    for(uint32_t batchSize : {8u, 32u, 128u}){
+        bench::report("SubmitBatcher, batches of " + std::to_string(batchSize), submitCount, run_batched(closure, buffers, submitCount, batchSize));
+    }
+    return(0);
+}
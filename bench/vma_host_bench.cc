@@ -0,0 +1,70 @@
+// Contention on VmaHost::getAllocator() from many threads.
+//
+// "mutex + map" is the registry as it was before: a std::unordered_map behind one mutex. VmaHost is
+// measured with each thread repeatedly looking up one device, which its thread-local cache serves,
+// and alternating between two devices, which falls through to the copy-on-write snapshot.
+//
+// Usage: vma_host_bench [threads = hardware concurrency] [lookups per thread = 2000000]
+#include "bench_common.h"
+#include <thread>
+
+namespace{
+
+template<typename LookupFunc>
+double run_lookups(uint32_t aThreadCount, uint64_t aPerThread, LookupFunc aLookup){
+    std::atomic<uint64_t> checksum = {0};
+    bench::Stopwatch timer;
+    std::vector<std::thread> threads;
+    for(uint32_t t = 0; t < aThreadCount; ++t){
+        threads.emplace_back([&, t](){
+            uint64_t local = 0;
+            for(uint64_t i = 0; i < aPerThread; ++i){
+                local += reinterpret_cast<uintptr_t>(aLookup(t + i));
+            }
+            checksum += local;
+        });
+    }
+    for(std::thread& thread : threads) thread.join();
+    const double seconds = timer.seconds();
+
+    // Keeps the lookups from being optimized away
+    if(checksum.load() == 0) std::printf("  (no allocators found)\n");
+    return(seconds);
+}
+
+} // end anonymous namespace
+
+int main(int argc, char** argv){
+    const uint32_t threadCount = static_cast<uint32_t>(bench::arg_or(argc, argv, 1, std::max(std::thread::hardware_concurrency(), 1U)));
+    const uint64_t perThread = bench::arg_or(argc, argv, 2, 2000000);
+    const uint64_t total = threadCount * perThread;
+
+    bench::BenchDevice device;
+    VulkanLogicalDevice secondDevice = device.mPhysicalDevice.createLogicalDevice(VK_QUEUE_COMPUTE_BIT);
+    const VulkanDeviceHandlePair pairs[2] = {device.pair(), VulkanDeviceHandlePair(secondDevice.handle(), device.mPhysicalDevice.handle())};
+    std::printf("Lookup threads: %u\n", threadCount);
+
+    std::mutex registryMutex;
+    std::unordered_map<VulkanDeviceHandlePair, VmaAllocator> registry;
+    registry[pairs[0]] = VmaHost::getAllocator(pairs[0]);
+    registry[pairs[1]] = VmaHost::getAllocator(pairs[1]);
+
+    bench::report("mutex + map, one device", total, run_lookups(threadCount, perThread, [&](uint64_t){
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return(registry.find(pairs[0])->second);
+    }));
+    bench::report("VmaHost, one device", total, run_lookups(threadCount, perThread, [&](uint64_t){
+        return(VmaHost::getAllocator(pairs[0]));
+    }));
+    bench::report("mutex + map, alternating devices", total, run_lookups(threadCount, perThread, [&](uint64_t aIndex){
+        std::lock_guard<std::mutex> lock(registryMutex);
+        return(registry.find(pairs[aIndex & 1])->second);
+    }));
+    bench::report("VmaHost, alternating devices", total, run_lookups(threadCount, perThread, [&](uint64_t aIndex){
+        return(VmaHost::getAllocator(pairs[aIndex & 1]));
+    }));
+
+    VmaHost::destroyAllocator(pairs[1]);
+    vkDestroyDevice(secondDevice.handle(), nullptr);
+    return(0);
+}
@@ -0,0 +1,156 @@
+// HostImportedBuffer on both of its paths: importing host memory through VK_EXT_external_memory_host,
+// and the staged fallback taken for misaligned pointers, allocations too small to import and file
+// mappings the driver won't import.
+//
+// Run against any device, e.g. lavapipe with VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json.
+// The import cases are skipped when the device lacks the extension. Exits with 77 when there is no device.
+#include "bench/bench_common.h"
+#include <filesystem>
+#include <fstream>
+
+namespace{
+
+int sFailures = 0;
+
+#define CHECK(aCondition) \
+    do{ \
+        if(!(aCondition)){ \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #aCondition); \
+            ++sFailures; \
+        } \
+    }while(0)
+
+/// Host allocation aligned for import, freed on destruction
+struct AlignedAllocation
+{
+    AlignedAllocation(VkDeviceSize aAlignment, VkDeviceSize aSize)
+    :   mSize((aSize + aAlignment - 1) / aAlignment * aAlignment),
+        mData(static_cast<uint8_t*>(std::aligned_alloc(aAlignment, mSize))) {}
+    ~AlignedAllocation() {std::free(mData);}
+
+    AlignedAllocation(const AlignedAllocation&) = delete;
+    AlignedAllocation& operator=(const AlignedAllocation&) = delete;
+
+    VkDeviceSize mSize;
+    uint8_t* mData;
+};
+
+void fill_pattern(uint8_t* aData, VkDeviceSize aSize, uint8_t aSeed){
+    for(VkDeviceSize i = 0; i < aSize; ++i) aData[i] = static_cast<uint8_t>(aSeed + i * 7);
+}
+
+/// True if the buffer's contents, read back by the GPU, match `aExpected`
+bool read_back_matches(vkutils::ReadbackStream& aReadback, const vkutils::HostImportedBuffer& aBuffer, const uint8_t* aExpected){
+    aBuffer.getReadyTicket().wait();
+    vkutils::ReadbackFuture future = aReadback.readBuffer(aBuffer.getBuffer(), 0, aBuffer.getSize());
+    if(future.wait() != VK_SUCCESS) return(false);
+    const vkutils::ReadbackSpan span = future.span();
+    return(span.mSize == aBuffer.getSize() && std::memcmp(span.mData, aExpected, span.mSize) == 0);
+}
+
+constexpr VkBufferUsageFlags kUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+void test_import(const bench::BenchDevice& aDevice, vkutils::QueueClosure& aClosure, vkutils::ReadbackStream& aReadback){
+    const VkDeviceSize alignment = vkutils::HostImportedBuffer::importAlignment(aDevice.mPhysicalDevice.handle());
+    if(!vkutils::HostImportedBuffer::supportsImport(aDevice.device()) || alignment == 0){
+        std::printf("skipped import: %s not supported\n", VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+        return;
+    }
+
+    AlignedAllocation allocation(alignment, 3 * alignment);
+    fill_pattern(allocation.mData, allocation.mSize, 1);
+    vkutils::HostImportedBuffer buffer(aClosure, allocation.mData, allocation.mSize, kUsage);
+    CHECK(buffer.isImported());
+    CHECK(read_back_matches(aReadback, buffer, allocation.mData));
+
+    // GPU writes land in the host allocation itself
+    VkCommandBuffer cmdBuffer = aClosure.beginOneSubmitCommands();
+    vkCmdFillBuffer(cmdBuffer, buffer.getBuffer(), 0, VK_WHOLE_SIZE, 0xA5A5A5A5);
+    aClosure.finishOneSubmitCommands(cmdBuffer);
+    CHECK(buffer.isImported() && allocation.mData[0] == 0xA5 && allocation.mData[allocation.mSize - 1] == 0xA5);
+    std::printf("import: %s\n", buffer.isImported() ? "imported" : "staged");
+}
+
+void test_unaligned_size(const bench::BenchDevice& aDevice, vkutils::QueueClosure& aClosure, vkutils::ReadbackStream& aReadback){
+    const VkDeviceSize alignment = vkutils::HostImportedBuffer::importAlignment(aDevice.mPhysicalDevice.handle());
+    if(alignment <= 4) return;
+
+    // The aligned import would cover bytes past the caller's size, so the buffer is staged unless the
+    // real allocation size is passed
+    AlignedAllocation allocation(alignment, 2 * alignment);
+    const VkDeviceSize size = alignment + 4;
+    fill_pattern(allocation.mData, allocation.mSize, 2);
+
+    vkutils::HostImportedBuffer staged(aClosure, allocation.mData, size, kUsage);
+    CHECK(!staged.isImported());
+    CHECK(read_back_matches(aReadback, staged, allocation.mData));
+
+    if(vkutils::HostImportedBuffer::supportsImport(aDevice.device())){
+        vkutils::HostImportedBuffer imported(aClosure, allocation.mData, size, kUsage, nullptr, allocation.mSize);
+        CHECK(imported.isImported());
+        CHECK(read_back_matches(aReadback, imported, allocation.mData));
+    }
+}
+
+void test_misaligned_fallback(const bench::BenchDevice& aDevice, vkutils::QueueClosure& aClosure, vkutils::ReadbackStream& aReadback){
+    std::vector<uint8_t> data(4097);
+    fill_pattern(data.data(), data.size(), 3);
+
+    // Through a temporary uploader, then through a caller's uploader followed by a sync()
+    vkutils::HostImportedBuffer buffer(aClosure, data.data() + 1, data.size() - 1, kUsage);
+    CHECK(!buffer.isImported());
+    CHECK(read_back_matches(aReadback, buffer, data.data() + 1));
+
+    vkutils::StagingUploader uploader(aClosure, 1 << 16);
+    vkutils::HostImportedBuffer uploaded(aClosure, data.data() + 1, data.size() - 1, kUsage, &uploader);
+    CHECK(!uploaded.isImported());
+    CHECK(read_back_matches(aReadback, uploaded, data.data() + 1));
+
+    fill_pattern(data.data(), data.size(), 4);
+    uploaded.sync();
+    CHECK(read_back_matches(aReadback, uploaded, data.data() + 1));
+}
+
+void test_mapped_file(vkutils::QueueClosure& aClosure, vkutils::ReadbackStream& aReadback){
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "vkutils_host_imported_buffer_test.bin";
+    std::vector<uint8_t> data(10000);
+    fill_pattern(data.data(), data.size(), 5);
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    {
+        vkutils::MappedFile mapping(path.string());
+        vkutils::HostImportedBuffer buffer(aClosure, mapping, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+        CHECK(buffer.getSize() == data.size());
+        CHECK(read_back_matches(aReadback, buffer, data.data()));
+        std::printf("mapped file: %s\n", buffer.isImported() ? "imported" : "staged");
+    }
+    std::filesystem::remove(path);
+}
+
+} // end anonymous namespace
+
+int main(){
+    std::unique_ptr<bench::BenchDevice> device;
+    try{
+        device.reset(new bench::BenchDevice(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT, {}, nullptr, {VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME}));
+    }catch(const std::exception& e){
+        std::printf("skipped: %s\n", e.what());
+        return(77);
+    }
+
+    {
+        vkutils::QueueClosure closure(device->pair(), device->computeFamily(), device->computeQueue());
+        vkutils::ReadbackStream readback(closure, 1 << 16, 2);
+
+        test_import(*device, closure, readback);
+        test_unaligned_size(*device, closure, readback);
+        test_misaligned_fallback(*device, closure, readback);
+        test_mapped_file(closure, readback);
+    }
+
+    if(sFailures != 0) std::fprintf(stderr, "%d checks failed\n", sFailures);
+    return(sFailures == 0 ? 0 : 1);
+}
@@ -1,6 +1,6 @@
 #include "vkutils.h"
+#include "VmaHost.h"
 #include <iostream>
-#include <fstream>
 #include <algorithm>
 #include <cassert>
 #include <iterator>
@@ -62,18 +62,9 @@ VkFormat select_depth_format(const VkPhysicalDevice& aPhysDev, const VkFormat& a
 }
 
 VkShaderModule load_shader_module(const VkDevice& aDevice, const std::string& aFilePath){
-    std::ifstream shaderFile(aFilePath, std::ios::in | std::ios::binary | std::ios::ate);
-    if(!shaderFile.is_open()){
-        perror(aFilePath.c_str());
-        throw std::runtime_error("Failed to open shader file" + aFilePath + "!");
-    }
-    size_t fileSize = static_cast<size_t>(shaderFile.tellg());
-    std::vector<uint8_t> byteCode(fileSize);
-    shaderFile.seekg(std::ios::beg);
-    shaderFile.read(reinterpret_cast<char*>(byteCode.data()), fileSize);
-    shaderFile.close();
-
-    VkShaderModule resultModule = create_shader_module(aDevice, byteCode, true);
+    // The driver copies the code, so it can be read straight out of the mapping
+    MappedFile shaderFile(aFilePath);
+    VkShaderModule resultModule = create_shader_module(aDevice, shaderFile.data(), shaderFile.size(), true);
     if(resultModule == VK_NULL_HANDLE){
         std::cerr << "Failed to create shader module from '" << aFilePath << "'!" << std::endl;
     }
@@ -81,12 +72,16 @@ VkShaderModule load_shader_module(const VkDevice& aDevice, const std::string& aF
 }
 
 VkShaderModule create_shader_module(const VkDevice& aDevice, const std::vector<uint8_t>& aByteCode, bool silent){
+    return(create_shader_module(aDevice, aByteCode.data(), aByteCode.size(), silent));
+}
+
+VkShaderModule create_shader_module(const VkDevice& aDevice, const void* aByteCode, size_t aSize, bool silent){
     VkShaderModuleCreateInfo createInfo;{
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         createInfo.pNext = nullptr;
         createInfo.flags = 0;
-        createInfo.codeSize = aByteCode.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(aByteCode.data());
+        createInfo.codeSize = aSize;
+        createInfo.pCode = static_cast<const uint32_t*>(aByteCode);
     }
 
     VkShaderModule resultModule = VK_NULL_HANDLE;
@@ -96,6 +91,79 @@ VkShaderModule create_shader_module(const VkDevice& aDevice, const std::vector<u
     return(resultModule);
 }
 
+static uint32_t instance_api_version(){
+    #ifdef VULKAN_BASE_VK_API_VERSION
+    return(VULKAN_BASE_VK_API_VERSION);
+    #else
+    return(VK_API_VERSION_1_0);
+    #endif
+}
+
+uint32_t effective_api_version(VkPhysicalDevice aPhysicalDevice){
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(aPhysicalDevice, &properties);
+    return(std::min(instance_api_version(), properties.apiVersion));
+}
+
+// Core function when the effective version has it, otherwise the extension's from the VmaHost instance
+template<typename FuncType>
+static FuncType physical_device_func(VkPhysicalDevice aPhysicalDevice, FuncType aCoreFunc, const char* aExtensionFuncName){
+    if(effective_api_version(aPhysicalDevice) >= VK_API_VERSION_1_1) return(aCoreFunc);
+
+    VkInstance instance = VmaHost::getVkInstance();
+    if(instance == VK_NULL_HANDLE) return(nullptr);
+    return(reinterpret_cast<FuncType>(vkGetInstanceProcAddr(instance, aExtensionFuncName)));
+}
+
+PFN_vkGetPhysicalDeviceProperties2 get_physical_device_properties2_func(VkPhysicalDevice aPhysicalDevice){
+    return(physical_device_func<PFN_vkGetPhysicalDeviceProperties2>(aPhysicalDevice, vkGetPhysicalDeviceProperties2, "vkGetPhysicalDeviceProperties2KHR"));
+}
+
+PFN_vkGetPhysicalDeviceFeatures2 get_physical_device_features2_func(VkPhysicalDevice aPhysicalDevice){
+    return(physical_device_func<PFN_vkGetPhysicalDeviceFeatures2>(aPhysicalDevice, vkGetPhysicalDeviceFeatures2, "vkGetPhysicalDeviceFeatures2KHR"));
+}
+
+PFN_vkGetPhysicalDeviceExternalBufferProperties get_physical_device_external_buffer_properties_func(VkPhysicalDevice aPhysicalDevice){
+    return(physical_device_func<PFN_vkGetPhysicalDeviceExternalBufferProperties>(
+        aPhysicalDevice, vkGetPhysicalDeviceExternalBufferProperties, "vkGetPhysicalDeviceExternalBufferPropertiesKHR"
+    ));
+}
+
+PFN_vkVoidFunction get_device_func(VkDevice aDevice, uint32_t aCoreVersion, const char* aCoreName, const char* aExtensionName){
+    // The device's own version is covered by vkGetDeviceProcAddr, which returns null for commands it lacks
+    PFN_vkVoidFunction function = nullptr;
+    if(instance_api_version() >= aCoreVersion) function = vkGetDeviceProcAddr(aDevice, aCoreName);
+    if(function == nullptr) function = vkGetDeviceProcAddr(aDevice, aExtensionName);
+    return(function);
+}
+
+uint64_t hash_bytes(const void* aData, size_t aSize, uint64_t aSeed){
+    // Multiply-rotate over 8 byte words, finished with the MurmurHash3 64-bit avalanche
+    const uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+    const uint8_t* bytes = static_cast<const uint8_t*>(aData);
+    uint64_t hash = aSeed ^ (static_cast<uint64_t>(aSize) * kMultiplier);
+
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= aSize; i += sizeof(uint64_t)){
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash ^= word * kMultiplier;
+        hash = (hash << 29) | (hash >> 35);
+        hash *= 0xBF58476D1CE4E5B9ull;
+    }
+    uint64_t tail = 0;
+    // memcpy() requires a valid pointer even for zero bytes, and aData may be null when aSize is 0
+    if(aSize != i) std::memcpy(&tail, bytes + i, aSize - i);
+    hash ^= tail * kMultiplier;
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return(hash);
+}
+
 uint32_t total_descriptor_count(const std::vector<VkDescriptorPoolSize>& aPoolSizes){
     uint32_t sum = 0;
     for(const VkDescriptorPoolSize& size : aPoolSizes){
@@ -135,76 +203,99 @@ std::pair<std::vector<VkSpecializationMapEntry>, std::vector<uint8_t>> concat_sp
     return(std::make_pair(std::move(entries), std::move(data)));
 }
 
-VkCommandBuffer QueueClosure::beginOneSubmitCommands(VkCommandPool aCommandPool){
-    // Create a one off command pool internally
-    if(aCommandPool == VK_NULL_HANDLE){
-        _mCmdPoolInternal = true;
-        VkCommandPoolCreateInfo poolCreate = {};
-        poolCreate.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        poolCreate.queueFamilyIndex = mFamilyIdx;
-        poolCreate.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-        VkResult poolCreateResult = vkCreateCommandPool(_mDevicePair.device, &poolCreate, nullptr, &_mCommandPool);
-        assert(poolCreateResult == VK_SUCCESS);
-        aCommandPool = _mCommandPool;
-    }
-    
-    VkCommandBufferAllocateInfo allocInfo = {};
+static VkBufferMemoryBarrier buffer_ownership_barrier(VkBuffer aBuffer, uint32_t aSrcFamily, uint32_t aDstFamily, VkDeviceSize aOffset, VkDeviceSize aSize){
+    VkBufferMemoryBarrier barrier = {};
     {
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandBufferCount = 1;
-        allocInfo.commandPool = aCommandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = aSrcFamily == aDstFamily ? VK_QUEUE_FAMILY_IGNORED : aSrcFamily;
+        barrier.dstQueueFamilyIndex = aSrcFamily == aDstFamily ? VK_QUEUE_FAMILY_IGNORED : aDstFamily;
+        barrier.buffer = aBuffer;
+        barrier.offset = aOffset;
+        barrier.size = aSize;
     }
+    return(barrier);
+}
 
-    VkCommandBufferBeginInfo beginInfo = {};
+static VkImageMemoryBarrier image_ownership_barrier(
+    VkImage aImage, const VkImageSubresourceRange& aRange,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkImageLayout aOldLayout, VkImageLayout aNewLayout
+){
+    VkImageMemoryBarrier barrier = {};
     {
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = aOldLayout;
+        barrier.newLayout = aNewLayout;
+        barrier.srcQueueFamilyIndex = aSrcFamily == aDstFamily ? VK_QUEUE_FAMILY_IGNORED : aSrcFamily;
+        barrier.dstQueueFamilyIndex = aSrcFamily == aDstFamily ? VK_QUEUE_FAMILY_IGNORED : aDstFamily;
+        barrier.image = aImage;
+        barrier.subresourceRange = aRange;
     }
+    return(barrier);
+}
 
-    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
-    ASSERT_VK_SUCCESS(vkAllocateCommandBuffers(_mDevicePair.device, &allocInfo, &cmdBuffer) );
-    ASSERT_VK_SUCCESS(vkBeginCommandBuffer(cmdBuffer, &beginInfo) );
-
-    return(cmdBuffer);
+void cmd_release_buffer_ownership(
+    VkCommandBuffer aCmdBuffer, VkBuffer aBuffer,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkPipelineStageFlags aSrcStage, VkAccessFlags aSrcAccess,
+    VkDeviceSize aOffset, VkDeviceSize aSize
+){
+    if(aSrcFamily == aDstFamily) return;
+    VkBufferMemoryBarrier barrier = buffer_ownership_barrier(aBuffer, aSrcFamily, aDstFamily, aOffset, aSize);
+    barrier.srcAccessMask = aSrcAccess;
+    // The destination half of a release is ignored; the semaphore to the acquiring queue carries the dependency
+    vkCmdPipelineBarrier(aCmdBuffer, aSrcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 }
 
-VkResult QueueClosure::finishOneSubmitCommands(const VkCommandBuffer& aCmdBuffer, VkFence aFence, bool aShouldWait){
-    return finishOneSubmitCommands(aCmdBuffer, {}, {}, aFence, aShouldWait);
+void cmd_acquire_buffer_ownership(
+    VkCommandBuffer aCmdBuffer, VkBuffer aBuffer,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkPipelineStageFlags aDstStage, VkAccessFlags aDstAccess,
+    VkDeviceSize aOffset, VkDeviceSize aSize
+){
+    VkBufferMemoryBarrier barrier = buffer_ownership_barrier(aBuffer, aSrcFamily, aDstFamily, aOffset, aSize);
+    barrier.dstAccessMask = aDstAccess;
+    VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if(aSrcFamily == aDstFamily){
+        // No release happened, so this barrier must order against prior work itself
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        srcStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+    vkCmdPipelineBarrier(aCmdBuffer, srcStage, aDstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 }
 
-VkResult QueueClosure::finishOneSubmitCommands(
-    const VkCommandBuffer& aCmdBuffer,
-    const std::vector<VkSemaphore>& aWaitSemaphores,
-    const std::vector<VkSemaphore>& aSignalSemaphores,
-    VkFence aFence,
-    bool aShouldWait
+void cmd_release_image_ownership(
+    VkCommandBuffer aCmdBuffer, VkImage aImage, const VkImageSubresourceRange& aRange,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkImageLayout aOldLayout, VkImageLayout aNewLayout,
+    VkPipelineStageFlags aSrcStage, VkAccessFlags aSrcAccess
 ){
-    ASSERT_VK_SUCCESS(vkEndCommandBuffer(aCmdBuffer));
-    
-    VkSubmitInfo submission = sSingleSubmitTemplate;
-    submission.commandBufferCount = 1;
-    submission.pCommandBuffers = &aCmdBuffer;
-    submission.waitSemaphoreCount = static_cast<uint32_t>(aWaitSemaphores.size());
-    submission.pWaitSemaphores = aWaitSemaphores.data();
-    submission.signalSemaphoreCount = static_cast<uint32_t>(aSignalSemaphores.size());
-    submission.pSignalSemaphores = aSignalSemaphores.data();
-    
-    VkResult submitResult = vkQueueSubmit(mQueue, 1, &submission, aFence);
-    if(submitResult == VK_SUCCESS && aShouldWait && aFence == VK_NULL_HANDLE) vkQueueWaitIdle(mQueue);
-    _cleanupSubmit(aCmdBuffer);
-    return(submitResult);
+    if(aSrcFamily == aDstFamily) return;
+    VkImageMemoryBarrier barrier = image_ownership_barrier(aImage, aRange, aSrcFamily, aDstFamily, aOldLayout, aNewLayout);
+    barrier.srcAccessMask = aSrcAccess;
+    vkCmdPipelineBarrier(aCmdBuffer, aSrcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
-void QueueClosure::_cleanupSubmit(const VkCommandBuffer& aCmdBuffer){
-    if(aCmdBuffer != VK_NULL_HANDLE && _mCmdPoolInternal){
-        vkFreeCommandBuffers(_mDevicePair.device, _mCommandPool, 1, &aCmdBuffer);
-    }
-    if(_mCommandPool != VK_NULL_HANDLE){
-        vkDestroyCommandPool(_mDevicePair.device, _mCommandPool, nullptr);
-        _mCommandPool = VK_NULL_HANDLE;
+void cmd_acquire_image_ownership(
+    VkCommandBuffer aCmdBuffer, VkImage aImage, const VkImageSubresourceRange& aRange,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkImageLayout aOldLayout, VkImageLayout aNewLayout,
+    VkPipelineStageFlags aDstStage, VkAccessFlags aDstAccess
+){
+    VkImageMemoryBarrier barrier = image_ownership_barrier(aImage, aRange, aSrcFamily, aDstFamily, aOldLayout, aNewLayout);
+    barrier.dstAccessMask = aDstAccess;
+    VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if(aSrcFamily == aDstFamily){
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        srcStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
     }
-    _mCmdPoolInternal = false;
+    vkCmdPipelineBarrier(aCmdBuffer, srcStage, aDstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
 const char* vk_result_str(VkResult r){
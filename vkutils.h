@@ -5,12 +5,23 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <exception>
 #include <stdexcept>
 #include <algorithm>
 #include <iostream>
 #include <functional>
 #include <cassert>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <numeric>
+#include <cstring>
+#include <type_traits>
 #include <vk_mem_alloc.h>
 #include "VulkanDevices.h"
 
@@ -115,6 +126,30 @@ std::pair<std::vector<VkSpecializationMapEntry>, std::vector<uint8_t>> concat_sp
 
 VkPhysicalDevice select_physical_device(const std::vector<VkPhysicalDevice>& aDevices);
 
+/// Vulkan version usable for physical device queries on `aPhysicalDevice`: the lower of the device's
+/// apiVersion and the instance's. The instance version is VULKAN_BASE_VK_API_VERSION, as for VmaHost,
+/// or 1.0 when that isn't defined.
+uint32_t effective_api_version(VkPhysicalDevice aPhysicalDevice);
+
+/// vkGetPhysicalDeviceProperties2 when effective_api_version() is 1.1 or newer. Otherwise the
+/// VK_KHR_get_physical_device_properties2 entry point of the instance given to VmaHost::setVkInstance(),
+/// which is only found when that extension was enabled on it.
+/// \returns nullptr if neither is available
+PFN_vkGetPhysicalDeviceProperties2 get_physical_device_properties2_func(VkPhysicalDevice aPhysicalDevice);
+
+/// Like get_physical_device_properties2_func(), for vkGetPhysicalDeviceFeatures2
+PFN_vkGetPhysicalDeviceFeatures2 get_physical_device_features2_func(VkPhysicalDevice aPhysicalDevice);
+
+/// Like get_physical_device_properties2_func(), for vkGetPhysicalDeviceExternalBufferProperties from
+/// Vulkan 1.1 or VK_KHR_external_memory_capabilities
+PFN_vkGetPhysicalDeviceExternalBufferProperties get_physical_device_external_buffer_properties_func(VkPhysicalDevice aPhysicalDevice);
+
+/// Device entry point `aCoreName`, or `aExtensionName` when the core command isn't available. The core
+/// name is only tried when the instance version (see effective_api_version()) has it, since
+/// vkGetDeviceProcAddr may still return core commands the instance didn't request.
+/// \returns nullptr if neither is available
+PFN_vkVoidFunction get_device_func(VkDevice aDevice, uint32_t aCoreVersion, const char* aCoreName, const char* aExtensionName);
+
 /// @brief Returns cstr name of the given VkResult enum value. 
 const char* vk_result_str(VkResult r);
 
@@ -122,51 +157,113 @@ VkFormat select_depth_format(const VkPhysicalDevice& aPhysDev, const VkFormat& a
 
 VkShaderModule load_shader_module(const VkDevice& aDevice, const std::string& aFilePath);
 VkShaderModule create_shader_module(const VkDevice& aDevice, const std::vector<uint8_t>& aByteCode, bool silent = false);
+VkShaderModule create_shader_module(const VkDevice& aDevice, const void* aByteCode, size_t aSize, bool silent = false);
+
+/// Fast non-cryptographic 64-bit hash of a byte range
+uint64_t hash_bytes(const void* aData, size_t aSize, uint64_t aSeed = 0);
+
+/// Records the release half of a queue family ownership transfer of a buffer range from `aSrcFamily` to `aDstFamily`.
+///
+/// Must be recorded into a command buffer executed on `aSrcFamily`, and followed by a matching
+/// cmd_acquire_buffer_ownership() on `aDstFamily` that waits on a semaphore signaled after the release.
+/// Records nothing when the two families are the same.
+/// \param aSrcStage Stages that last accessed the buffer on the source queue
+/// \param aSrcAccess Writes on the source queue that must be made available
+void cmd_release_buffer_ownership(
+    VkCommandBuffer aCmdBuffer, VkBuffer aBuffer,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkPipelineStageFlags aSrcStage, VkAccessFlags aSrcAccess,
+    VkDeviceSize aOffset = 0, VkDeviceSize aSize = VK_WHOLE_SIZE
+);
+
+/// Records the acquire half of a queue family ownership transfer of a buffer range from `aSrcFamily` to `aDstFamily`.
+///
+/// Must be recorded into a command buffer executed on `aDstFamily`. When the two families are the same
+/// a plain barrier is recorded instead, so callers may use one code path whether or not the device
+/// has dedicated async queues.
+/// \param aDstStage Stages that will access the buffer on the destination queue
+/// \param aDstAccess Accesses on the destination queue the buffer must be visible to
+void cmd_acquire_buffer_ownership(
+    VkCommandBuffer aCmdBuffer, VkBuffer aBuffer,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkPipelineStageFlags aDstStage, VkAccessFlags aDstAccess,
+    VkDeviceSize aOffset = 0, VkDeviceSize aSize = VK_WHOLE_SIZE
+);
+
+/// Image counterpart of cmd_release_buffer_ownership(). The layout transition from `aOldLayout` to
+/// `aNewLayout` is part of the transfer, and must be given identically to the acquire.
+void cmd_release_image_ownership(
+    VkCommandBuffer aCmdBuffer, VkImage aImage, const VkImageSubresourceRange& aRange,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkImageLayout aOldLayout, VkImageLayout aNewLayout,
+    VkPipelineStageFlags aSrcStage, VkAccessFlags aSrcAccess
+);
+
+/// Image counterpart of cmd_acquire_buffer_ownership(). Performs the layout transition itself when
+/// the two families are the same.
+void cmd_acquire_image_ownership(
+    VkCommandBuffer aCmdBuffer, VkImage aImage, const VkImageSubresourceRange& aRange,
+    uint32_t aSrcFamily, uint32_t aDstFamily,
+    VkImageLayout aOldLayout, VkImageLayout aNewLayout,
+    VkPipelineStageFlags aDstStage, VkAccessFlags aDstAccess
+);
+
+// Inline include fence and semaphore pools
+#include "vkutils_SyncPools.inl"
+
+// Inline include queue submission components
+#include "vkutils_QueueClosure.inl"
 
-class QueueClosure
-{
- public:
-    QueueClosure(const VulkanDeviceHandlePair& aDevicePair, uint32_t aFamily, VkQueue aQueue)
-    : mQueue(aQueue), mFamilyIdx(aFamily), _mDevicePair(aDevicePair) {}
-
-    ~QueueClosure(){_cleanupSubmit();}
-
-    VkQueue getQueue() const {return(mQueue);}
-    uint32_t getFamily() const {return(mFamilyIdx);}
-    const VulkanDeviceHandlePair& getDevicePair() const {return(_mDevicePair);}
-
-    VkCommandBuffer beginOneSubmitCommands(VkCommandPool aCommandPool = VK_NULL_HANDLE);
-    VkResult finishOneSubmitCommands(const VkCommandBuffer& aCmdBuffer, VkFence aFence = VK_NULL_HANDLE, bool aShouldWait = true);
-    VkResult finishOneSubmitCommands(
-        const VkCommandBuffer& aCmdBuffer,
-        const std::vector<VkSemaphore>& aWaitSemaphores,
-        const std::vector<VkSemaphore>& aSignalSemaphores,
-        VkFence aFence = VK_NULL_HANDLE,
-        bool aShouldWait = true
-    );
-
- protected:
-    void _cleanupSubmit(const VkCommandBuffer& aCmdBuffer = VK_NULL_HANDLE);
-    VkQueue mQueue = VK_NULL_HANDLE;
-    uint32_t mFamilyIdx;
-
- private:
-    VulkanDeviceHandlePair _mDevicePair;
-    mutable bool _mCmdPoolInternal = false;
-    mutable VkCommandPool _mCommandPool = VK_NULL_HANDLE;
-};
-
-const static VkSubmitInfo sSingleSubmitTemplate {
-    /* sType = */ VK_STRUCTURE_TYPE_SUBMIT_INFO,
-    /* pNext = */ nullptr,
-    /* waitSemaphoreCount = */ 0,
-    /* pWaitSemaphores = */ nullptr,
-    /* pWaitDstStageMask = */ 0,
-    /* commandBufferCount = */ 1,
-    /* pCommandBuffers = */ nullptr,
-    /* signalSemaphoreCount = */ 0,
-    /* pSignalSemaphores = */ nullptr
-};
+// Inline include submission batching components
+#include "vkutils_SubmitBatcher.inl"
+
+// Inline include timeline semaphore submission components
+#include "vkutils_QueueTimeline.inl"
+
+// Inline include threaded submission components
+#include "vkutils_QueueSubmissionService.inl"
+
+// Inline include staging upload components
+#include "vkutils_StagingUploader.inl"
+
+// Inline include readback components
+#include "vkutils_ReadbackStream.inl"
+
+// Inline include file streaming components
+#include "vkutils_FileStreamLoader.inl"
+
+// Inline include host memory import components
+#include "vkutils_HostImportedBuffer.inl"
+
+// Inline include uniform ring components
+#include "vkutils_UniformRing.inl"
+
+// Inline include mega buffer components
+#include "vkutils_MegaBuffer.inl"
+
+// Inline include transient arena components
+#include "vkutils_TransientArena.inl"
+
+// Inline include SPIR-V reflection components
+#include "vkutils_ShaderReflection.inl"
+
+// Inline include shader module caching components
+#include "vkutils_ShaderModuleCache.inl"
+
+// Inline include pipeline layout caching components
+#include "vkutils_PipelineLayoutCache.inl"
+
+// Inline include descriptor allocation components
+#include "vkutils_DescriptorAllocator.inl"
+
+// Inline include descriptor update template components
+#include "vkutils_DescriptorUpdateTemplate.inl"
+
+// Inline include bindless descriptor components
+#include "vkutils_BindlessTable.inl"
+
+// Inline include push descriptor components
+#include "vkutils_PushDescriptorRecorder.inl"
 
 // Inline include render pipeline components
 #include "vkutils_VulkanRenderPipeline.inl"
@@ -174,6 +271,9 @@ const static VkSubmitInfo sSingleSubmitTemplate {
 // Inline include compute pipeline components
 #include "vkutils_VulkanComputePipeline.inl"
 
+// Inline include batched pipeline creation components
+#include "vkutils_VulkanPipelineBatch.inl"
+
 
 } // end namespace vkutils
 
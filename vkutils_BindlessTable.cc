@@ -0,0 +1,202 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+namespace{
+
+constexpr VkDescriptorType kBindlessDescriptorTypes[] = {
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+};
+
+constexpr VkDescriptorBindingFlags kBindlessBindingFlags =
+    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+    VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+    VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+} // end anonymous namespace
+
+BindlessTable::BindlessTable(
+    const VulkanDeviceHandlePair& aDevicePair,
+    const BindlessTableCapacity& aCapacity,
+    VkShaderStageFlags aStages,
+    uint32_t aFrameCount
+)
+:   _mDevice(aDevicePair.device)
+{
+    PFN_vkGetPhysicalDeviceProperties2 getProperties2 = get_physical_device_properties2_func(aDevicePair.physicalDevice);
+    if(getProperties2 == nullptr){
+        throw std::runtime_error("Attempted to create a bindless table without vkGetPhysicalDeviceProperties2 available!");
+    }
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProps = {};
+    indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 props = {};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props.pNext = &indexingProps;
+    getProperties2(aDevicePair.physicalDevice, &props);
+
+    const uint32_t capacities[kTypeCount] = {
+        std::min({aCapacity.mStorageBuffers, indexingProps.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexingProps.maxDescriptorSetUpdateAfterBindStorageBuffers}),
+        std::min({aCapacity.mSampledImages, indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProps.maxDescriptorSetUpdateAfterBindSampledImages,
+                  indexingProps.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProps.maxDescriptorSetUpdateAfterBindSamplers}),
+        std::min({aCapacity.mStorageImages, indexingProps.maxPerStageDescriptorUpdateAfterBindStorageImages, indexingProps.maxDescriptorSetUpdateAfterBindStorageImages})
+    };
+
+    // Zero sized bindings are legal but can't be allocated from, so they're left out of the layout
+    _mDescription.mFlags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for(uint32_t type = 0; type < kTypeCount; ++type){
+        _mSlots[type].mCapacity = capacities[type];
+        _mSlots[type].mGenerations.resize(capacities[type], 0);
+        _mSlots[type].mRetired.resize(std::max<uint32_t>(aFrameCount, 1));
+        if(capacities[type] == 0) continue;
+
+        VkDescriptorSetLayoutBinding binding;
+        {
+            binding.binding = type;
+            binding.descriptorType = kBindlessDescriptorTypes[type];
+            binding.descriptorCount = capacities[type];
+            binding.stageFlags = aStages;
+            binding.pImmutableSamplers = nullptr;
+        }
+        _mDescription.mBindings.push_back(binding);
+        _mDescription.mBindingFlags.push_back(kBindlessBindingFlags);
+        poolSizes.push_back({kBindlessDescriptorTypes[type], capacities[type]});
+    }
+    if(poolSizes.empty()) throw std::runtime_error("Attempted to create a bindless table without any descriptors!");
+
+    VkResult result = PipelineLayoutCache::forDevice(_mDevice)->getSetLayout(_mDescription, _mSetLayoutRef);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create bindless descriptor set layout! (" + std::string(vk_result_str(result)) + ")");
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo;
+    {
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+    }
+    result = vkCreateDescriptorPool(_mDevice, &poolInfo, nullptr, &_mPool);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create bindless descriptor pool! (" + std::string(vk_result_str(result)) + ")");
+    }
+
+    VkDescriptorSetLayout setLayout = _mSetLayoutRef.get();
+    VkDescriptorSetAllocateInfo allocInfo;
+    {
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.descriptorPool = _mPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &setLayout;
+    }
+    result = vkAllocateDescriptorSets(_mDevice, &allocInfo, &_mSet);
+    if(result != VK_SUCCESS){
+        vkDestroyDescriptorPool(_mDevice, _mPool, nullptr);
+        throw std::runtime_error("Failed to allocate bindless descriptor set! (" + std::string(vk_result_str(result)) + ")");
+    }
+}
+
+BindlessTable::~BindlessTable(){
+    // Frees the set along with the pool
+    vkDestroyDescriptorPool(_mDevice, _mPool, nullptr);
+}
+
+BindlessHandle BindlessTable::addStorageBuffer(VkBuffer aBuffer, VkDeviceSize aOffset, VkDeviceSize aRange){
+    VkDescriptorBufferInfo bufferInfo = {aBuffer, aOffset, aRange};
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_add(BindlessResourceType::StorageBuffer, nullptr, &bufferInfo));
+}
+
+BindlessHandle BindlessTable::addSampledImage(VkImageView aView, VkSampler aSampler, VkImageLayout aLayout){
+    VkDescriptorImageInfo imageInfo = {aSampler, aView, aLayout};
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_add(BindlessResourceType::SampledImage, &imageInfo, nullptr));
+}
+
+BindlessHandle BindlessTable::addStorageImage(VkImageView aView, VkImageLayout aLayout){
+    VkDescriptorImageInfo imageInfo = {VK_NULL_HANDLE, aView, aLayout};
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_add(BindlessResourceType::StorageImage, &imageInfo, nullptr));
+}
+
+BindlessHandle BindlessTable::_add(BindlessResourceType aType, const VkDescriptorImageInfo* aImageInfo, const VkDescriptorBufferInfo* aBufferInfo){
+    const uint32_t type = static_cast<uint32_t>(aType);
+    SlotList& slots = _mSlots[type];
+
+    BindlessHandle handle;
+    handle.mType = aType;
+    if(!slots.mFree.empty()){
+        handle.mIndex = slots.mFree.back();
+        slots.mFree.pop_back();
+    }else if(slots.mHighWater < slots.mCapacity){
+        handle.mIndex = slots.mHighWater++;
+    }else{
+        return(handle);
+    }
+    handle.mGeneration = slots.mGenerations[handle.mIndex];
+
+    VkWriteDescriptorSet write;
+    {
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.pNext = nullptr;
+        write.dstSet = _mSet;
+        write.dstBinding = type;
+        write.dstArrayElement = handle.mIndex;
+        write.descriptorCount = 1;
+        write.descriptorType = kBindlessDescriptorTypes[type];
+        write.pImageInfo = aImageInfo;
+        write.pBufferInfo = aBufferInfo;
+        write.pTexelBufferView = nullptr;
+    }
+    vkUpdateDescriptorSets(_mDevice, 1, &write, 0, nullptr);
+
+    return(handle);
+}
+
+void BindlessTable::release(const BindlessHandle& aHandle){
+    if(!aHandle.isValid()) return;
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    SlotList& slots = _mSlots[static_cast<uint32_t>(aHandle.mType)];
+    if(aHandle.mIndex >= slots.mHighWater || slots.mGenerations[aHandle.mIndex] != aHandle.mGeneration) return;
+
+    // The descriptor is left in place; partially bound bindings don't require it to stay valid
+    ++slots.mGenerations[aHandle.mIndex];
+    slots.mRetired[_mFrame].push_back(aHandle.mIndex);
+}
+
+bool BindlessTable::isLive(const BindlessHandle& aHandle) const{
+    if(!aHandle.isValid()) return(false);
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    const SlotList& slots = _mSlots[static_cast<uint32_t>(aHandle.mType)];
+    return(aHandle.mIndex < slots.mHighWater && slots.mGenerations[aHandle.mIndex] == aHandle.mGeneration);
+}
+
+void BindlessTable::nextFrame(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mFrame = (_mFrame + 1) % static_cast<uint32_t>(_mSlots[0].mRetired.size());
+    for(SlotList& slots : _mSlots){
+        std::vector<uint32_t>& retired = slots.mRetired[_mFrame];
+        slots.mFree.insert(slots.mFree.end(), retired.begin(), retired.end());
+        retired.clear();
+    }
+}
+
+void BindlessTable::bind(VkCommandBuffer aCommandBuffer, VkPipelineBindPoint aBindPoint, VkPipelineLayout aLayout, uint32_t aSet) const{
+    vkCmdBindDescriptorSets(aCommandBuffer, aBindPoint, aLayout, aSet, 1, &_mSet, 0, nullptr);
+}
+
+uint32_t BindlessTable::getUsedCount(BindlessResourceType aType) const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    const SlotList& slots = _mSlots[static_cast<uint32_t>(aType)];
+    return(slots.mHighWater - static_cast<uint32_t>(slots.mFree.size()));
+}
+
+} // end namespace vkutils
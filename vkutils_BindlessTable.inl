@@ -0,0 +1,119 @@
+#include <vulkan/vulkan.h>
+
+/// Kinds of resources a BindlessTable holds, each in its own binding of the table's set
+enum class BindlessResourceType : uint32_t
+{
+    StorageBuffer = 0,
+    SampledImage = 1,   ///< Image view and sampler, as VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+    StorageImage = 2
+};
+
+/// Slot of a resource in a BindlessTable. Shaders index the binding for mType with mIndex.
+struct BindlessHandle
+{
+    static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+    BindlessResourceType mType = BindlessResourceType::StorageBuffer;
+    uint32_t mIndex = kInvalidIndex;
+    uint32_t mGeneration = 0; ///< Distinguishes reuses of the same slot
+
+    bool isValid() const {return(mIndex != kInvalidIndex);}
+};
+
+/// Array sizes of a BindlessTable's bindings. Each is clamped to the device's update-after-bind limits.
+struct BindlessTableCapacity
+{
+    uint32_t mStorageBuffers = 16384;
+    uint32_t mSampledImages = 16384;
+    uint32_t mStorageImages = 4096;
+};
+
+/// One large descriptor set holding every storage buffer, sampled image and storage image in use, so
+/// that a frame binds a single set and shaders select resources by index.
+///
+/// The set has one binding per BindlessResourceType, numbered by the type's value and created with
+/// VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT, VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT and
+/// VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT. Resources can therefore be added while the set is bound
+/// or in use by the GPU, and unused slots never need valid descriptors. The device must have been
+/// created with bindless descriptors enabled, see VulkanPhysicalDevice::createLogicalDevice().
+///
+/// Released slots are reused only after `aFrameCount` calls to nextFrame(), so the GPU is no longer
+/// reading them once they're overwritten. Safe to use from any thread.
+class BindlessTable
+{
+ public:
+    /// \param aStages Shader stages that may access the table
+    /// \param aFrameCount Frames in flight, i.e. calls to nextFrame() before a released slot is reused
+    /// \throw std::runtime_error If the layout, pool or set can't be created
+    BindlessTable(
+        const VulkanDeviceHandlePair& aDevicePair,
+        const BindlessTableCapacity& aCapacity = {},
+        VkShaderStageFlags aStages = VK_SHADER_STAGE_ALL,
+        uint32_t aFrameCount = 2
+    );
+    ~BindlessTable();
+
+    BindlessTable(const BindlessTable&) = delete;
+    BindlessTable& operator=(const BindlessTable&) = delete;
+
+    /// Writes a buffer into a free slot
+    /// \returns An invalid handle if the storage buffer binding is full
+    BindlessHandle addStorageBuffer(VkBuffer aBuffer, VkDeviceSize aOffset = 0, VkDeviceSize aRange = VK_WHOLE_SIZE);
+
+    /// \returns An invalid handle if the sampled image binding is full
+    BindlessHandle addSampledImage(VkImageView aView, VkSampler aSampler, VkImageLayout aLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    /// \returns An invalid handle if the storage image binding is full
+    BindlessHandle addStorageImage(VkImageView aView, VkImageLayout aLayout = VK_IMAGE_LAYOUT_GENERAL);
+
+    /// Returns the slot of `aHandle` for reuse once the frames currently in flight are done. Handles
+    /// that are invalid or were already released are ignored.
+    void release(const BindlessHandle& aHandle);
+
+    /// True if `aHandle` refers to a slot that hasn't been released since
+    bool isLive(const BindlessHandle& aHandle) const;
+
+    /// Advances the frame, making slots released `aFrameCount` frames ago available again
+    void nextFrame();
+
+    /// Binds the table as set `aSet` of `aLayout`, which must have been created with getLayoutDescription() there
+    void bind(VkCommandBuffer aCommandBuffer, VkPipelineBindPoint aBindPoint, VkPipelineLayout aLayout, uint32_t aSet) const;
+
+    VkDescriptorSet getSet() const {return(_mSet);}
+    VkDescriptorSetLayout getSetLayout() const {return(_mSetLayoutRef.get());}
+
+    /// Layout of the table's set. Pipelines built with it in their layout description, e.g. through
+    /// VulkanComputePipelineBuilder::useBindlessTable(), share the table's set layout handle.
+    const DescriptorSetLayoutDescription& getLayoutDescription() const {return(_mDescription);}
+
+    uint32_t getCapacity(BindlessResourceType aType) const {return(_mSlots[static_cast<uint32_t>(aType)].mCapacity);}
+
+    /// Number of occupied slots of `aType`, including released slots still waiting for reuse
+    uint32_t getUsedCount(BindlessResourceType aType) const;
+
+ protected:
+    static constexpr uint32_t kTypeCount = 3;
+
+    struct SlotList
+    {
+        uint32_t mCapacity = 0;
+        uint32_t mHighWater = 0;                    // Slots below this have been handed out at least once
+        std::vector<uint32_t> mFree;
+        std::vector<uint32_t> mGenerations;
+        std::vector<std::vector<uint32_t>> mRetired; // Released slots per frame, reused when that frame comes around again
+    };
+
+    /// Takes a free slot and writes one descriptor to it. Must hold _mMutex.
+    BindlessHandle _add(BindlessResourceType aType, const VkDescriptorImageInfo* aImageInfo, const VkDescriptorBufferInfo* aBufferInfo);
+
+ private:
+    VkDevice _mDevice = VK_NULL_HANDLE;
+    DescriptorSetLayoutDescription _mDescription;
+    DescriptorSetLayoutRef _mSetLayoutRef;
+    VkDescriptorPool _mPool = VK_NULL_HANDLE;
+    VkDescriptorSet _mSet = VK_NULL_HANDLE;
+
+    mutable std::mutex _mMutex;
+    uint32_t _mFrame = 0;
+    SlotList _mSlots[kTypeCount];
+};
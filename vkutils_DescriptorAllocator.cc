@@ -0,0 +1,245 @@
+#include "vkutils.h"
+#include <cmath>
+
+namespace vkutils{
+
+namespace{
+
+/// A thread's current pool within one allocator
+struct DescriptorThreadState
+{
+    uint64_t mAllocatorId = 0;
+    std::weak_ptr<const char> mAllocatorAlive;
+    uint64_t mEpoch = 0;
+    VkDescriptorPool mPool = VK_NULL_HANDLE;
+    uint32_t mPoolSets = 0;
+};
+
+std::atomic<uint64_t> sNextAllocatorId(1);
+
+// Allocators are identified by id rather than address so that a new allocator reusing the
+// address of a destroyed one never sees its stale state
+thread_local std::vector<DescriptorThreadState> tDescriptorStates;
+
+DescriptorThreadState& thread_state(uint64_t aAllocatorId, const std::shared_ptr<const char>& aAlive){
+    for(size_t i = 0; i < tDescriptorStates.size();){
+        if(tDescriptorStates[i].mAllocatorId == aAllocatorId) return(tDescriptorStates[i]);
+        // Drops the states of destroyed allocators as they're passed over
+        if(tDescriptorStates[i].mAllocatorAlive.expired()){
+            tDescriptorStates[i] = std::move(tDescriptorStates.back());
+            tDescriptorStates.pop_back();
+        }else{
+            ++i;
+        }
+    }
+    tDescriptorStates.emplace_back();
+    tDescriptorStates.back().mAllocatorId = aAllocatorId;
+    tDescriptorStates.back().mAllocatorAlive = aAlive;
+    return(tDescriptorStates.back());
+}
+
+} // end anonymous namespace
+
+DescriptorAllocator::DescriptorAllocator(
+    VkDevice aDevice,
+    uint32_t aFrameCount,
+    std::vector<DescriptorPoolRatio> aRatios,
+    uint32_t aInitialPoolSets,
+    uint32_t aMaxPoolSets,
+    VkDescriptorPoolCreateFlags aPoolFlags
+)
+:   _mDevice(aDevice),
+    _mId(sNextAllocatorId++),
+    _mAlive(std::make_shared<const char>(0)),
+    _mRatios(aRatios.empty() ? defaultRatios() : std::move(aRatios)),
+    _mInitialPoolSets(std::max<uint32_t>(aInitialPoolSets, 1)),
+    _mMaxPoolSets(std::max(aMaxPoolSets, std::max<uint32_t>(aInitialPoolSets, 1))),
+    _mPoolFlags(aPoolFlags),
+    _mFramePools(std::max<uint32_t>(aFrameCount, 1))
+{}
+
+DescriptorAllocator::~DescriptorAllocator(){
+    for(const std::vector<Pool>& framePools : _mFramePools){
+        for(const Pool& pool : framePools){
+            vkDestroyDescriptorPool(_mDevice, pool.mPool, nullptr);
+        }
+    }
+    for(const Pool& pool : _mFreePools){
+        vkDestroyDescriptorPool(_mDevice, pool.mPool, nullptr);
+    }
+}
+
+std::vector<DescriptorPoolRatio> DescriptorAllocator::defaultRatios(){
+    std::vector<DescriptorPoolRatio> ratios = {
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f},
+        {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f}
+    };
+    return(ratios);
+}
+
+VkResult DescriptorAllocator::allocate(uint32_t aCount, const VkDescriptorSetLayout* aLayouts, VkDescriptorSet* aSetsOut, const void* aNext){
+    if(aCount == 0) return(VK_SUCCESS);
+
+    DescriptorThreadState& state = thread_state(_mId, _mAlive);
+    const uint64_t epoch = _mEpoch.load(std::memory_order_acquire);
+    if(state.mEpoch != epoch){
+        // The pool was reset or belongs to an older frame
+        state.mEpoch = epoch;
+        state.mPool = VK_NULL_HANDLE;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo;
+    {
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = aNext;
+        allocInfo.descriptorPool = state.mPool;
+        allocInfo.descriptorSetCount = aCount;
+        allocInfo.pSetLayouts = aLayouts;
+    }
+
+    VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+    if(state.mPool != VK_NULL_HANDLE){
+        result = vkAllocateDescriptorSets(_mDevice, &allocInfo, aSetsOut);
+    }
+
+    if((result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) && _isUnservable(aCount, aLayouts)){
+        return(VK_ERROR_OUT_OF_POOL_MEMORY);
+    }
+
+    // Grows once, and if even a fresh pool can't hold the batch, tries once more at the largest size
+    for(int attempt = 0; attempt < 2 && (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL); ++attempt){
+        uint32_t poolSets = _mInitialPoolSets;
+        if(attempt != 0){
+            if(state.mPoolSets >= std::max(_mMaxPoolSets, aCount)) break;
+            poolSets = _mMaxPoolSets;
+        }else if(state.mPool != VK_NULL_HANDLE){
+            poolSets = std::min(_mMaxPoolSets, state.mPoolSets * 2);
+            _mPoolGrowths.fetch_add(1, std::memory_order_relaxed);
+        }
+        poolSets = std::max(poolSets, aCount);
+
+        result = _acquirePool(poolSets, state.mPool);
+        if(result != VK_SUCCESS){
+            state.mPool = VK_NULL_HANDLE;
+            return(result);
+        }
+        state.mPoolSets = poolSets;
+        allocInfo.descriptorPool = state.mPool;
+        result = vkAllocateDescriptorSets(_mDevice, &allocInfo, aSetsOut);
+    }
+
+    if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL){
+        // The ratios can't provide what these layouts need, e.g. a descriptor type they leave out
+        _markUnservable(aCount, aLayouts);
+        return(VK_ERROR_OUT_OF_POOL_MEMORY);
+    }
+
+    if(result == VK_SUCCESS) _mSetsAllocated.fetch_add(aCount, std::memory_order_relaxed);
+    return(result);
+}
+
+VkResult DescriptorAllocator::_acquirePool(uint32_t aSets, VkDescriptorPool& aPoolOut){
+    std::lock_guard<std::mutex> lock(_mMutex);
+
+    auto best = _mFreePools.end();
+    for(auto it = _mFreePools.begin(); it != _mFreePools.end(); ++it){
+        if(it->mMaxSets >= aSets && (best == _mFreePools.end() || it->mMaxSets < best->mMaxSets)) best = it;
+    }
+    if(best != _mFreePools.end()){
+        aPoolOut = best->mPool;
+        _mFramePools[_mFrame].push_back(*best);
+        _mFreePools.erase(best);
+        return(VK_SUCCESS);
+    }
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    poolSizes.reserve(_mRatios.size());
+    for(const DescriptorPoolRatio& ratio : _mRatios){
+        uint32_t count = static_cast<uint32_t>(std::ceil(ratio.mPerSet * static_cast<float>(aSets)));
+        if(count != 0) poolSizes.push_back({ratio.mType, count});
+    }
+
+    VkDescriptorPoolCreateInfo createInfo;
+    {
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = _mPoolFlags;
+        createInfo.maxSets = aSets;
+        createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        createInfo.pPoolSizes = poolSizes.data();
+    }
+
+    VkResult result = vkCreateDescriptorPool(_mDevice, &createInfo, nullptr, &aPoolOut);
+    if(result == VK_SUCCESS){
+        _mFramePools[_mFrame].push_back({aPoolOut, aSets});
+        ++_mPoolsCreated;
+    }
+    return(result);
+}
+
+bool DescriptorAllocator::_isUnservable(uint32_t aCount, const VkDescriptorSetLayout* aLayouts) const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    if(_mUnservableLayouts.empty()) return(false);
+    for(uint32_t i = 0; i < aCount; ++i){
+        if(_mUnservableLayouts.count(aLayouts[i]) != 0) return(true);
+    }
+    return(false);
+}
+
+void DescriptorAllocator::_markUnservable(uint32_t aCount, const VkDescriptorSetLayout* aLayouts){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    // A single layout is blamed when the batch holds just one; otherwise the failure can't be pinned down
+    if(aCount == 1) _mUnservableLayouts.insert(aLayouts[0]);
+}
+
+uint32_t DescriptorAllocator::nextFrame(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mFrame = (_mFrame + 1) % static_cast<uint32_t>(_mFramePools.size());
+    for(const Pool& pool : _mFramePools[_mFrame]){
+        vkResetDescriptorPool(_mDevice, pool.mPool, 0);
+        _mFreePools.push_back(pool);
+    }
+    _mFramePools[_mFrame].clear();
+    ++_mFrameResets;
+    _mEpoch.fetch_add(1, std::memory_order_release);
+    return(_mFrame);
+}
+
+void DescriptorAllocator::resetAll(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    for(std::vector<Pool>& framePools : _mFramePools){
+        for(const Pool& pool : framePools){
+            vkResetDescriptorPool(_mDevice, pool.mPool, 0);
+            _mFreePools.push_back(pool);
+        }
+        framePools.clear();
+    }
+    _mUnservableLayouts.clear();
+    ++_mFrameResets;
+    _mEpoch.fetch_add(1, std::memory_order_release);
+}
+
+DescriptorAllocatorStats DescriptorAllocator::stats() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    DescriptorAllocatorStats stats;
+    stats.mSetsAllocated = _mSetsAllocated.load(std::memory_order_relaxed);
+    stats.mPoolGrowths = _mPoolGrowths.load(std::memory_order_relaxed);
+    stats.mFrameResets = _mFrameResets;
+    stats.mPoolsCreated = _mPoolsCreated;
+    stats.mPoolsFree = _mFreePools.size();
+    for(const std::vector<Pool>& framePools : _mFramePools){
+        stats.mPoolsInUse += framePools.size();
+    }
+    return(stats);
+}
+
+} // end namespace vkutils
@@ -0,0 +1,121 @@
+#include <vulkan/vulkan.h>
+
+/// Number of descriptors of one type a pool reserves for each set it can hold
+struct DescriptorPoolRatio
+{
+    VkDescriptorType mType;
+    float mPerSet;
+};
+
+/// Counters for a DescriptorAllocator
+struct DescriptorAllocatorStats
+{
+    uint64_t mSetsAllocated = 0;
+    uint64_t mPoolGrowths = 0;  ///< Times a thread's pool ran out and was replaced by a larger one
+    uint64_t mFrameResets = 0;
+    size_t mPoolsCreated = 0;
+    size_t mPoolsInUse = 0;     ///< Pools holding sets of a frame that hasn't been reset yet
+    size_t mPoolsFree = 0;      ///< Reset pools waiting to be reused
+};
+
+/// Allocates descriptor sets from a growing list of pools, recycled a frame at a time.
+///
+/// Every thread allocates from its own current pool, so allocation takes no locks unless the pool is
+/// exhausted. When vkAllocateDescriptorSets reports VK_ERROR_OUT_OF_POOL_MEMORY or
+/// VK_ERROR_FRAGMENTED_POOL, the thread moves on to a pool twice the size of the last, up to a limit,
+/// taken from previously reset pools where possible.
+///
+/// Pools belong to the frame they were first used in. nextFrame() advances to the next of
+/// `aFrameCount` frame slots and resets all pools used the last time that slot was current, freeing
+/// every set allocated from them at once. nextFrame() and resetAll() must not run concurrently with
+/// allocation, and the GPU must be done with the sets being freed.
+///
+/// Pools only hold the descriptor types named in the ratios. A single-set request that fails even in a
+/// fresh pool of the largest size, e.g. because its layout uses a type the ratios leave out such as
+/// VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK, marks the layout as unservable. Later requests for it fail
+/// with VK_ERROR_OUT_OF_POOL_MEMORY without creating pools, until resetAll().
+class DescriptorAllocator
+{
+ public:
+    /// \param aFrameCount Frames in flight; sets survive this many calls to nextFrame()
+    /// \param aRatios Descriptors reserved per set in each pool. Empty selects defaultRatios().
+    /// \param aInitialPoolSets Sets in the first pool a thread uses each frame
+    /// \param aMaxPoolSets Limit for pool growth. Batches larger than this still get a pool that fits.
+    /// \param aPoolFlags Flags for created pools, e.g. VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT
+    explicit DescriptorAllocator(
+        VkDevice aDevice,
+        uint32_t aFrameCount = 2,
+        std::vector<DescriptorPoolRatio> aRatios = {},
+        uint32_t aInitialPoolSets = 64,
+        uint32_t aMaxPoolSets = 4096,
+        VkDescriptorPoolCreateFlags aPoolFlags = 0
+    );
+    ~DescriptorAllocator();
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    /// Allocates `aCount` sets in a single vkAllocateDescriptorSets call.
+    /// \param aNext Optional extension chain, e.g. VkDescriptorSetVariableDescriptorCountAllocateInfo
+    VkResult allocate(uint32_t aCount, const VkDescriptorSetLayout* aLayouts, VkDescriptorSet* aSetsOut, const void* aNext = nullptr);
+
+    VkResult allocate(VkDescriptorSetLayout aLayout, VkDescriptorSet& aSetOut, const void* aNext = nullptr){
+        return(allocate(1, &aLayout, &aSetOut, aNext));
+    }
+
+    /// Allocates one set per layout, resizing `aSetsOut` to match
+    VkResult allocate(const std::vector<VkDescriptorSetLayout>& aLayouts, std::vector<VkDescriptorSet>& aSetsOut, const void* aNext = nullptr){
+        aSetsOut.resize(aLayouts.size());
+        return(allocate(static_cast<uint32_t>(aLayouts.size()), aLayouts.data(), aSetsOut.data(), aNext));
+    }
+
+    /// Moves to the next frame slot, resetting the pools used the last time it was current
+    /// \returns The new frame index
+    uint32_t nextFrame();
+
+    /// Resets every pool, freeing all sets from all frames
+    void resetAll();
+
+    uint32_t getFrameIndex() const {return(_mFrame);}
+    DescriptorAllocatorStats stats() const;
+
+    /// Ratios covering every core descriptor type, weighted toward images and buffers
+    static std::vector<DescriptorPoolRatio> defaultRatios();
+
+ protected:
+    struct Pool
+    {
+        VkDescriptorPool mPool;
+        uint32_t mMaxSets;
+    };
+
+    /// Takes the smallest free pool with room for `aSets` sets, or creates one, and assigns it to the current frame
+    VkResult _acquirePool(uint32_t aSets, VkDescriptorPool& aPoolOut);
+
+    bool _isUnservable(uint32_t aCount, const VkDescriptorSetLayout* aLayouts) const;
+    void _markUnservable(uint32_t aCount, const VkDescriptorSetLayout* aLayouts);
+
+ private:
+    VkDevice _mDevice = VK_NULL_HANDLE;
+    const uint64_t _mId;
+    // Expires with the allocator, letting threads drop their state for it
+    const std::shared_ptr<const char> _mAlive;
+    std::vector<DescriptorPoolRatio> _mRatios;
+    uint32_t _mInitialPoolSets;
+    uint32_t _mMaxPoolSets;
+    VkDescriptorPoolCreateFlags _mPoolFlags;
+
+    // Bumped whenever pools are reset, invalidating every thread's current pool
+    std::atomic<uint64_t> _mEpoch = {1};
+
+    mutable std::mutex _mMutex;
+    uint32_t _mFrame = 0;
+    std::vector<std::vector<Pool>> _mFramePools;
+    std::vector<Pool> _mFreePools;
+    std::unordered_set<VkDescriptorSetLayout> _mUnservableLayouts;
+    size_t _mPoolsCreated = 0;
+    uint64_t _mFrameResets = 0;
+
+    std::atomic<uint64_t> _mSetsAllocated = {0};
+    std::atomic<uint64_t> _mPoolGrowths = {0};
+};
@@ -0,0 +1,224 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+namespace{
+
+constexpr size_t kFieldAlignment = 8;
+
+size_t align_field(size_t aOffset){
+    return((aOffset + kFieldAlignment - 1) & ~(kFieldAlignment - 1));
+}
+
+} // end anonymous namespace
+
+DescriptorUpdateTemplateDispatch DescriptorUpdateTemplateDispatch::load(VkDevice aDevice){
+    DescriptorUpdateTemplateDispatch dispatch;
+    dispatch.mCreate = reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplate>(
+        get_device_func(aDevice, VK_API_VERSION_1_1, "vkCreateDescriptorUpdateTemplate", "vkCreateDescriptorUpdateTemplateKHR")
+    );
+    dispatch.mDestroy = reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplate>(
+        get_device_func(aDevice, VK_API_VERSION_1_1, "vkDestroyDescriptorUpdateTemplate", "vkDestroyDescriptorUpdateTemplateKHR")
+    );
+    dispatch.mUpdate = reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplate>(
+        get_device_func(aDevice, VK_API_VERSION_1_1, "vkUpdateDescriptorSetWithTemplate", "vkUpdateDescriptorSetWithTemplateKHR")
+    );
+    return(dispatch);
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(VkDevice aDevice, const DescriptorSetLayoutDescription& aDescription)
+:   _mDevice(aDevice)
+{
+    VkResult result = PipelineLayoutCache::forDevice(aDevice)->getSetLayout(aDescription, _mSetLayoutRef);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create descriptor set layout for update template! (" + std::string(vk_result_str(result)) + ")");
+    }
+    _create(_mSetLayoutRef.get(), aDescription);
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(VkDevice aDevice, const PipelineLayoutDescription& aDescription, uint32_t aSet)
+:   _mDevice(aDevice)
+{
+    if(aSet >= aDescription.mSetLayouts.size()){
+        throw std::runtime_error("Descriptor set " + std::to_string(aSet) + " is not part of the pipeline layout description");
+    }
+
+    VkResult result = PipelineLayoutCache::forDevice(aDevice)->getSetLayout(aDescription.mSetLayouts[aSet], _mSetLayoutRef);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create descriptor set layout for update template! (" + std::string(vk_result_str(result)) + ")");
+    }
+    _create(_mSetLayoutRef.get(), aDescription.mSetLayouts[aSet]);
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(VkDevice aDevice, VkDescriptorSetLayout aLayout, const DescriptorSetLayoutDescription& aDescription)
+:   _mDevice(aDevice)
+{
+    _create(aLayout, aDescription);
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(VkDevice aDevice, VkPipelineLayout aPushLayout, VkPipelineBindPoint aBindPoint, uint32_t aSet, const DescriptorSetLayoutDescription& aDescription)
+:   _mDevice(aDevice),
+    _mPushLayout(aPushLayout),
+    _mPushSet(aSet)
+{
+    _create(VK_NULL_HANDLE, aDescription, aBindPoint);
+}
+
+DescriptorUpdateTemplate::~DescriptorUpdateTemplate(){
+    _destroy();
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(DescriptorUpdateTemplate&& aOther) noexcept{
+    *this = std::move(aOther);
+}
+
+DescriptorUpdateTemplate& DescriptorUpdateTemplate::operator=(DescriptorUpdateTemplate&& aOther) noexcept{
+    if(this != &aOther){
+        _destroy();
+        _mDevice = aOther._mDevice;
+        _mDispatch = aOther._mDispatch;
+        _mTemplate = aOther._mTemplate;
+        _mSetLayout = aOther._mSetLayout;
+        _mPushLayout = aOther._mPushLayout;
+        _mPushSet = aOther._mPushSet;
+        _mSetLayoutRef = std::move(aOther._mSetLayoutRef);
+        _mEntries = std::move(aOther._mEntries);
+        _mDataSize = aOther._mDataSize;
+
+        aOther._mTemplate = VK_NULL_HANDLE;
+        aOther._mSetLayout = VK_NULL_HANDLE;
+        aOther._mPushLayout = VK_NULL_HANDLE;
+        aOther._mDataSize = 0;
+    }
+    return(*this);
+}
+
+size_t DescriptorUpdateTemplate::descriptorSize(VkDescriptorType aType){
+    switch(aType){
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            return(sizeof(VkDescriptorImageInfo));
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+            return(sizeof(VkDescriptorBufferInfo));
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return(sizeof(VkBufferView));
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+            return(sizeof(VkAccelerationStructureKHR));
+        case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT:
+            return(1);
+        default:
+            return(0);
+    }
+}
+
+std::vector<VkDescriptorUpdateTemplateEntry> DescriptorUpdateTemplate::packedEntries(const DescriptorSetLayoutDescription& aDescription, size_t* aDataSizeOut){
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(aDescription.mBindings.size());
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings = aDescription.mBindings;
+    std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b){
+        return(a.binding < b.binding);
+    });
+
+    size_t offset = 0;
+    for(const VkDescriptorSetLayoutBinding& binding : bindings){
+        if(binding.descriptorCount == 0) continue;
+        // Immutable samplers are baked into the layout, and writing them is invalid
+        if(binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER && binding.pImmutableSamplers != nullptr) continue;
+
+        size_t elementSize = descriptorSize(binding.descriptorType);
+        if(elementSize == 0){
+            throw std::runtime_error("Descriptor type " + std::to_string(binding.descriptorType) + " of binding " + std::to_string(binding.binding) + " can't be written by an update template");
+        }
+
+        VkDescriptorUpdateTemplateEntry entry;
+        {
+            entry.dstBinding = binding.binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = binding.descriptorCount;
+            entry.descriptorType = binding.descriptorType;
+            entry.offset = offset;
+            entry.stride = elementSize;
+        }
+        entries.push_back(entry);
+
+        offset = align_field(offset + elementSize * binding.descriptorCount);
+    }
+
+    if(aDataSizeOut != nullptr) *aDataSizeOut = offset;
+    return(entries);
+}
+
+size_t DescriptorUpdateTemplate::offsetOf(uint32_t aBinding) const{
+    for(const VkDescriptorUpdateTemplateEntry& entry : _mEntries){
+        if(entry.dstBinding == aBinding) return(entry.offset);
+    }
+    throw std::runtime_error("Binding " + std::to_string(aBinding) + " is not written by the update template");
+}
+
+void DescriptorUpdateTemplate::update(VkDescriptorSet aSet, const void* aData, size_t aDataSize) const{
+    if(isPushTemplate()) throw std::runtime_error("Attempted to update a descriptor set with a push descriptor template");
+    if(aDataSize < _mDataSize) throw std::runtime_error("Descriptor data is smaller than the update template's layout");
+    _mDispatch.mUpdate(_mDevice, aSet, _mTemplate, aData);
+}
+
+void DescriptorUpdateTemplate::update(uint32_t aCount, const VkDescriptorSet* aSets, const void* aData, size_t aStride) const{
+    if(isPushTemplate()) throw std::runtime_error("Attempted to update a descriptor set with a push descriptor template");
+    if(aStride < _mDataSize) throw std::runtime_error("Descriptor data stride is smaller than the update template's layout");
+    const uint8_t* data = static_cast<const uint8_t*>(aData);
+    for(uint32_t i = 0; i < aCount; ++i){
+        _mDispatch.mUpdate(_mDevice, aSets[i], _mTemplate, data + i * aStride);
+    }
+}
+
+void DescriptorUpdateTemplate::_create(VkDescriptorSetLayout aLayout, const DescriptorSetLayoutDescription& aDescription, VkPipelineBindPoint aBindPoint){
+    _mDispatch = DescriptorUpdateTemplateDispatch::load(_mDevice);
+    if(!_mDispatch.isValid()){
+        throw std::runtime_error("Attempted to create a descriptor update template on a device without Vulkan 1.1 or VK_KHR_descriptor_update_template!");
+    }
+    _mSetLayout = aLayout;
+    _mEntries = packedEntries(aDescription, &_mDataSize);
+    if(_mEntries.empty()){
+        throw std::runtime_error("Descriptor set " + std::to_string(aDescription.mSet) + " has no bindings an update template can write");
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo createInfo;
+    {
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = 0;
+        createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(_mEntries.size());
+        createInfo.pDescriptorUpdateEntries = _mEntries.data();
+        // Set layouts are ignored by push templates, and the remaining members by descriptor set templates
+        createInfo.templateType = isPushTemplate() ? VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR : VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        createInfo.descriptorSetLayout = aLayout;
+        createInfo.pipelineBindPoint = aBindPoint;
+        createInfo.pipelineLayout = _mPushLayout;
+        createInfo.set = _mPushSet;
+    }
+
+    VkResult result = _mDispatch.mCreate(_mDevice, &createInfo, nullptr, &_mTemplate);
+    if(result != VK_SUCCESS){
+        _mTemplate = VK_NULL_HANDLE;
+        throw std::runtime_error("Failed to create descriptor update template! (" + std::string(vk_result_str(result)) + ")");
+    }
+}
+
+void DescriptorUpdateTemplate::_destroy(){
+    if(_mTemplate != VK_NULL_HANDLE){
+        _mDispatch.mDestroy(_mDevice, _mTemplate, nullptr);
+        _mTemplate = VK_NULL_HANDLE;
+    }
+    _mSetLayoutRef.reset();
+    _mSetLayout = VK_NULL_HANDLE;
+    _mPushLayout = VK_NULL_HANDLE;
+}
+
+} // end namespace vkutils
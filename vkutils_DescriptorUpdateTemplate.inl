@@ -0,0 +1,130 @@
+#include <vulkan/vulkan.h>
+
+/// Descriptor update template entry points, resolved through get_device_func() so that Vulkan 1.0
+/// devices with VK_KHR_descriptor_update_template work as well as Vulkan 1.1 ones.
+struct DescriptorUpdateTemplateDispatch
+{
+    PFN_vkCreateDescriptorUpdateTemplate mCreate = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplate mDestroy = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplate mUpdate = nullptr;
+
+    bool isValid() const {return(mCreate && mDestroy && mUpdate);}
+
+    /// Returns an invalid dispatch if neither the core nor the KHR entry points are available
+    static DescriptorUpdateTemplateDispatch load(VkDevice aDevice);
+};
+
+/// Writes all descriptors of a set with one vkUpdateDescriptorSetWithTemplate call, reading them
+/// from a packed struct of handles instead of an array of VkWriteDescriptorSet.
+///
+/// The layout of the packed data follows from a DescriptorSetLayoutDescription. It holds one field
+/// per binding, in ascending binding order. Each field is an array of `descriptorCount` elements of
+///  - VkDescriptorImageInfo for samplers, images and input attachments
+///  - VkDescriptorBufferInfo for uniform and storage buffers, dynamic or not
+///  - VkBufferView for texel buffers
+///  - VkAccelerationStructureKHR for acceleration structures
+///  - bytes for inline uniform blocks, where `descriptorCount` is the block size
+/// Fields start at 8 byte boundaries. Every element type above is 8 byte aligned, so a plain struct
+/// declaring the fields in the same order has the same layout. Sampler bindings with immutable
+/// samplers have no field, since they can't be written.
+class DescriptorUpdateTemplate
+{
+ public:
+    DescriptorUpdateTemplate() = default;
+
+    /// Creates a template for sets with the layout in `aDescription`, taking the set layout from the
+    /// device's PipelineLayoutCache. Pipelines built from the same description use the same handle.
+    /// Every constructor throws if the device has neither Vulkan 1.1 nor VK_KHR_descriptor_update_template.
+    /// \throw std::runtime_error If the set layout or the template can't be created
+    DescriptorUpdateTemplate(VkDevice aDevice, const DescriptorSetLayoutDescription& aDescription);
+
+    /// Creates a template for set `aSet` of a pipeline layout description, e.g. the mLayoutDescription
+    /// of a construction set
+    /// \throw std::runtime_error If `aSet` is not part of the description, or creation fails
+    DescriptorUpdateTemplate(VkDevice aDevice, const PipelineLayoutDescription& aDescription, uint32_t aSet);
+
+    /// Creates a template for sets of `aLayout`, which must have been created from `aDescription`
+    /// \throw std::runtime_error If the template can't be created
+    DescriptorUpdateTemplate(VkDevice aDevice, VkDescriptorSetLayout aLayout, const DescriptorSetLayoutDescription& aDescription);
+
+    /// Creates a template for pushing set `aSet` of `aPushLayout` with PushDescriptorRecorder::push(). The layout
+    /// must have been created with `aDescription` as its push descriptor set. Such templates can't update()
+    /// descriptor sets.
+    /// \throw std::runtime_error If the template can't be created
+    DescriptorUpdateTemplate(VkDevice aDevice, VkPipelineLayout aPushLayout, VkPipelineBindPoint aBindPoint, uint32_t aSet, const DescriptorSetLayoutDescription& aDescription);
+
+    ~DescriptorUpdateTemplate();
+
+    DescriptorUpdateTemplate(DescriptorUpdateTemplate&& aOther) noexcept;
+    DescriptorUpdateTemplate& operator=(DescriptorUpdateTemplate&& aOther) noexcept;
+    DescriptorUpdateTemplate(const DescriptorUpdateTemplate&) = delete;
+    DescriptorUpdateTemplate& operator=(const DescriptorUpdateTemplate&) = delete;
+
+    bool isValid() const {return(_mTemplate != VK_NULL_HANDLE);}
+    VkDescriptorUpdateTemplate get() const {return(_mTemplate);}
+    VkDescriptorSetLayout getSetLayout() const {return(_mSetLayout);}
+
+    bool isPushTemplate() const {return(_mPushLayout != VK_NULL_HANDLE);}
+    VkPipelineLayout getPushLayout() const {return(_mPushLayout);}
+    uint32_t getPushSet() const {return(_mPushSet);}
+
+    /// Bytes the template reads from the packed data of one set
+    size_t getDataSize() const {return(_mDataSize);}
+    const std::vector<VkDescriptorUpdateTemplateEntry>& getEntries() const {return(_mEntries);}
+
+    /// Offset of the field for `aBinding` in the packed data
+    /// \throw std::runtime_error If the template doesn't write `aBinding`
+    size_t offsetOf(uint32_t aBinding) const;
+
+    /// Writes every descriptor of `aSet` from `aData`
+    /// \throw std::runtime_error If DataType is smaller than the packed data the template reads, or this is
+    ///                            a push template
+    template<typename DataType>
+    void update(VkDescriptorSet aSet, const DataType& aData) const {
+        static_assert(std::is_trivially_copyable<DataType>::value, "Descriptor data must be a plain struct of handles");
+        update(aSet, &aData, sizeof(DataType));
+    }
+
+    /// \throw std::runtime_error If `aDataSize` is smaller than getDataSize(), or this is a push template
+    void update(VkDescriptorSet aSet, const void* aData, size_t aDataSize) const;
+
+    /// Writes `aCount` sets, reading the data for set i at `aData + i * aStride`
+    /// \throw std::runtime_error If `aStride` is smaller than getDataSize(), or this is a push template
+    void update(uint32_t aCount, const VkDescriptorSet* aSets, const void* aData, size_t aStride) const;
+
+    /// Writes aSets[i] from aData[i]
+    /// \throw std::runtime_error If the vectors differ in size, or DataType is too small
+    template<typename DataType>
+    void update(const std::vector<VkDescriptorSet>& aSets, const std::vector<DataType>& aData) const {
+        static_assert(std::is_trivially_copyable<DataType>::value, "Descriptor data must be a plain struct of handles");
+        if(aSets.size() != aData.size()) throw std::runtime_error("Descriptor set and data counts differ in template update");
+        if(sizeof(DataType) < _mDataSize) throw std::runtime_error("Descriptor data is smaller than the update template's layout");
+        update(static_cast<uint32_t>(aSets.size()), aSets.data(), aData.data(), sizeof(DataType));
+    }
+
+    /// Entries reading the packed layout described above. Offsets are relative to the start of the data.
+    /// \param aDataSizeOut Receives the size of the packed data if not null
+    /// \throw std::runtime_error If a binding has a descriptor type templates can't write
+    static std::vector<VkDescriptorUpdateTemplateEntry> packedEntries(const DescriptorSetLayoutDescription& aDescription, size_t* aDataSizeOut = nullptr);
+
+    /// Size of one element of the packed data for descriptors of `aType`, or 0 if unsupported
+    static size_t descriptorSize(VkDescriptorType aType);
+
+ protected:
+    void _create(VkDescriptorSetLayout aLayout, const DescriptorSetLayoutDescription& aDescription, VkPipelineBindPoint aBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+    void _destroy();
+
+ private:
+    VkDevice _mDevice = VK_NULL_HANDLE;
+    DescriptorUpdateTemplateDispatch _mDispatch;
+    VkDescriptorUpdateTemplate _mTemplate = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _mSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout _mPushLayout = VK_NULL_HANDLE;
+    uint32_t _mPushSet = 0;
+
+    // Keeps the cached set layout alive for templates created from a description
+    DescriptorSetLayoutRef _mSetLayoutRef;
+
+    std::vector<VkDescriptorUpdateTemplateEntry> _mEntries;
+    size_t _mDataSize = 0;
+};
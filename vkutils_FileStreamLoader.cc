@@ -0,0 +1,147 @@
+#include "vkutils.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace vkutils{
+
+MappedFile::MappedFile(const std::string& aPath) : _mPath(aPath) {
+    int fd = open(aPath.c_str(), O_RDONLY);
+    if(fd < 0){
+        perror(aPath.c_str());
+        throw std::runtime_error("Failed to open file '" + aPath + "' for mapping!");
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0){
+        close(fd);
+        throw std::runtime_error("Failed to stat file '" + aPath + "'!");
+    }
+    _mSize = static_cast<size_t>(fileStat.st_size);
+
+    // Empty files can't be mapped, but are still valid
+    if(_mSize != 0){
+        void* mapping = mmap(nullptr, _mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED){
+            close(fd);
+            throw std::runtime_error("Failed to map file '" + aPath + "'!");
+        }
+        _mData = mapping;
+        // Mostly read front to back
+        madvise(_mData, _mSize, MADV_SEQUENTIAL);
+    }
+    // The mapping keeps the file referenced
+    close(fd);
+}
+
+MappedFile::~MappedFile(){
+    _unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& aOther) noexcept
+: _mData(aOther._mData), _mSize(aOther._mSize), _mPath(std::move(aOther._mPath))
+{
+    aOther._mData = nullptr;
+    aOther._mSize = 0;
+    aOther._mPath.clear();
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& aOther) noexcept{
+    if(this != &aOther){
+        _unmap();
+        _mData = aOther._mData;
+        _mSize = aOther._mSize;
+        _mPath = std::move(aOther._mPath);
+        aOther._mData = nullptr;
+        aOther._mSize = 0;
+        aOther._mPath.clear();
+    }
+    return(*this);
+}
+
+void MappedFile::prefetch(size_t aOffset, size_t aSize) const{
+    if(_mData == nullptr || aOffset >= _mSize) return;
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = aOffset - aOffset % pageSize;
+    size_t end = std::min(_mSize, aOffset + std::min(aSize, _mSize - aOffset));
+    madvise(static_cast<uint8_t*>(_mData) + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::release(size_t aOffset, size_t aSize) const{
+    if(_mData == nullptr || aOffset >= _mSize) return;
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    // Only whole pages inside the range may be dropped
+    size_t begin = (aOffset + pageSize - 1) / pageSize * pageSize;
+    size_t end = std::min(_mSize, aOffset + std::min(aSize, _mSize - aOffset));
+    if(end != _mSize) end -= end % pageSize;
+    if(begin >= end) return;
+    madvise(static_cast<uint8_t*>(_mData) + begin, end - begin, MADV_DONTNEED);
+}
+
+void MappedFile::_unmap(){
+    if(_mData != nullptr){
+        munmap(_mData, _mSize);
+        _mData = nullptr;
+    }
+}
+
+double FileStreamStats::throughputMegabytesPerSecond() const{
+    double seconds = std::chrono::duration<double>(mElapsed).count();
+    if(seconds <= 0.0) return(0.0);
+    return(static_cast<double>(mBytesLoaded) / (1024.0 * 1024.0) / seconds);
+}
+
+FileStreamLoader::FileStreamLoader(const QueueClosure& aClosure, VkDeviceSize aChunkSize)
+: _mChunkSize(std::max<VkDeviceSize>(aChunkSize, 1)), _mUploader(aClosure, 2 * _mChunkSize) {}
+
+UploadTicket FileStreamLoader::loadBuffer(
+    const MappedFile& aFile, VkBuffer aDstBuffer, VkDeviceSize aDstOffset,
+    size_t aFileOffset, size_t aSize
+){
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(aFileOffset > aFile.size()) throw std::runtime_error("File offset is past the end of '" + aFile.path() + "'!");
+    const size_t end = aFileOffset + std::min(aSize, aFile.size() - aFileOffset);
+
+    UploadTicket ticket;
+    uint64_t chunks = 0;
+    size_t offset = aFileOffset;
+    aFile.prefetch(offset, _mChunkSize);
+    while(offset < end){
+        size_t chunk = static_cast<size_t>(std::min<VkDeviceSize>(_mChunkSize, end - offset));
+        // Start reading the next chunk in while this one is faulted in and staged
+        aFile.prefetch(offset + chunk, _mChunkSize);
+
+        BufferUploadRequest request;
+        {
+            request.mData = aFile.data() + offset;
+            request.mSize = chunk;
+            request.mDstBuffer = aDstBuffer;
+            request.mDstOffset = aDstOffset + (offset - aFileOffset);
+        }
+        // Blocks only while both halves of the staging area are still being copied from
+        ticket = _mUploader.upload({request});
+
+        aFile.release(offset, chunk);
+        offset += chunk;
+        ++chunks;
+    }
+
+    std::lock_guard<std::mutex> lock(_mStatsMutex);
+    _mStats.mBytesLoaded += end - aFileOffset;
+    _mStats.mChunks += chunks;
+    _mStats.mElapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return(ticket);
+}
+
+UploadTicket FileStreamLoader::loadBuffer(const std::string& aPath, VkBuffer aDstBuffer, VkDeviceSize aDstOffset){
+    MappedFile file(aPath);
+    return(loadBuffer(file, aDstBuffer, aDstOffset));
+}
+
+FileStreamStats FileStreamLoader::stats() const{
+    std::lock_guard<std::mutex> lock(_mStatsMutex);
+    return(_mStats);
+}
+
+} // end namespace vkutils
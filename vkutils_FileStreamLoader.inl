@@ -0,0 +1,81 @@
+#include <vulkan/vulkan.h>
+
+/// Read-only memory mapping of a whole file
+class MappedFile
+{
+ public:
+    MappedFile() = default;
+
+    /// \throw std::runtime_error If the file can't be opened or mapped
+    explicit MappedFile(const std::string& aPath);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& aOther) noexcept;
+    MappedFile& operator=(MappedFile&& aOther) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isValid() const {return(_mData != nullptr || !_mPath.empty());}
+    const uint8_t* data() const {return(static_cast<const uint8_t*>(_mData));}
+    size_t size() const {return(_mSize);}
+    const std::string& path() const {return(_mPath);}
+
+    /// Hints that the given range will be read soon, so the kernel can start reading it in
+    void prefetch(size_t aOffset, size_t aSize) const;
+
+    /// Hints that the given range has been consumed, so its pages can be dropped from this process
+    void release(size_t aOffset, size_t aSize) const;
+
+ private:
+    void _unmap();
+
+    void* _mData = nullptr;
+    size_t _mSize = 0;
+    std::string _mPath;
+};
+
+/// Counters for a FileStreamLoader
+struct FileStreamStats
+{
+    uint64_t mBytesLoaded = 0;
+    uint64_t mChunks = 0;
+    std::chrono::nanoseconds mElapsed = std::chrono::nanoseconds(0); ///< Time spent inside loadBuffer()
+
+    double throughputMegabytesPerSecond() const;
+};
+
+/// Streams files into device buffers through a double-buffered staging area.
+///
+/// Files are memory mapped and copied chunk by chunk straight from the mapping into one half of a
+/// StagingUploader ring while the GPU copies the previous chunk out of the other half. Page faults
+/// for each chunk therefore overlap the transfer of the one before it, and host memory used for
+/// staging stays bounded by twice the chunk size regardless of the file's size.
+class FileStreamLoader
+{
+ public:
+    /// \param aChunkSize Bytes staged and copied per submission
+    /// \throw std::runtime_error If the staging area can't be allocated
+    explicit FileStreamLoader(const QueueClosure& aClosure, VkDeviceSize aChunkSize = 8ull << 20);
+
+    /// Copies `aSize` bytes of `aFile` starting at `aFileOffset` into `aDstBuffer` at `aDstOffset`.
+    /// Returns once the last chunk is submitted; `aFile` may be unmapped as soon as it does.
+    /// \returns A ticket that completes once every chunk has been copied
+    UploadTicket loadBuffer(
+        const MappedFile& aFile, VkBuffer aDstBuffer, VkDeviceSize aDstOffset = 0,
+        size_t aFileOffset = 0, size_t aSize = SIZE_MAX
+    );
+
+    /// Maps the file at `aPath` and copies all of it into `aDstBuffer` at `aDstOffset`
+    /// \throw std::runtime_error If the file can't be mapped
+    UploadTicket loadBuffer(const std::string& aPath, VkBuffer aDstBuffer, VkDeviceSize aDstOffset = 0);
+
+    VkDeviceSize getChunkSize() const {return(_mChunkSize);}
+    FileStreamStats stats() const;
+
+ private:
+    VkDeviceSize _mChunkSize;
+    StagingUploader _mUploader;
+
+    mutable std::mutex _mStatsMutex;
+    FileStreamStats _mStats;
+};
@@ -0,0 +1,242 @@
+#include "vkutils.h"
+#include "VmaHost.h"
+#include <unistd.h>
+
+namespace vkutils{
+
+HostImportedBuffer::HostImportedBuffer(
+    const QueueClosure& aClosure, void* aHostPointer, VkDeviceSize aSize,
+    VkBufferUsageFlags aUsage, StagingUploader* aFallbackUploader,
+    VkDeviceSize aAllocationSize
+) : _mClosure(new QueueClosure(aClosure)), _mHostPointer(aHostPointer), _mSize(aSize),
+    _mAllocationSize(aAllocationSize != 0 ? aAllocationSize : aSize)
+{
+    _init(aUsage, aFallbackUploader);
+}
+
+HostImportedBuffer::HostImportedBuffer(
+    const QueueClosure& aClosure, const MappedFile& aFile,
+    VkBufferUsageFlags aUsage, StagingUploader* aFallbackUploader
+) : _mClosure(new QueueClosure(aClosure)), _mHostPointer(aFile.data()), _mSize(aFile.size()),
+    _mHandleType(VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_MAPPED_FOREIGN_MEMORY_BIT_EXT)
+{
+    // mmap() maps whole pages, so the mapping extends to the end of the file's last page
+    const VkDeviceSize pageSize = static_cast<VkDeviceSize>(sysconf(_SC_PAGESIZE));
+    _mAllocationSize = (_mSize + pageSize - 1) / pageSize * pageSize;
+    _init(aUsage, aFallbackUploader);
+}
+
+HostImportedBuffer::~HostImportedBuffer(){
+    _destroy();
+}
+
+HostImportedBuffer::HostImportedBuffer(HostImportedBuffer&& aOther) noexcept{
+    *this = std::move(aOther);
+}
+
+HostImportedBuffer& HostImportedBuffer::operator=(HostImportedBuffer&& aOther) noexcept{
+    if(this != &aOther){
+        _destroy();
+        _mClosure = std::move(aOther._mClosure);
+        _mHostPointer = aOther._mHostPointer;
+        _mSize = aOther._mSize;
+        _mAllocationSize = aOther._mAllocationSize;
+        _mHandleType = aOther._mHandleType;
+        _mBuffer = aOther._mBuffer;
+        _mImportedMemory = aOther._mImportedMemory;
+        _mAllocator = aOther._mAllocator;
+        _mAllocation = aOther._mAllocation;
+        _mUploader = aOther._mUploader;
+        _mReadyTicket = aOther._mReadyTicket;
+
+        aOther._mBuffer = VK_NULL_HANDLE;
+        aOther._mImportedMemory = VK_NULL_HANDLE;
+        aOther._mAllocation = nullptr;
+        aOther._mReadyTicket = UploadTicket();
+    }
+    return(*this);
+}
+
+UploadTicket HostImportedBuffer::sync(VkDeviceSize aOffset, VkDeviceSize aSize){
+    if(isImported() || !isValid() || aOffset >= _mSize) return(UploadTicket());
+
+    BufferUploadRequest request;
+    {
+        request.mData = static_cast<const uint8_t*>(_mHostPointer) + aOffset;
+        request.mSize = std::min(aSize, _mSize - aOffset);
+        request.mDstBuffer = _mBuffer;
+        request.mDstOffset = aOffset;
+    }
+
+    if(_mUploader != nullptr){
+        _mReadyTicket = _mUploader->upload({request});
+    }else{
+        StagingUploader uploader(*_mClosure, std::min<VkDeviceSize>(request.mSize, 64ull << 20));
+        uploader.upload({request}).wait();
+        _mReadyTicket = UploadTicket();
+    }
+    return(_mReadyTicket);
+}
+
+bool HostImportedBuffer::supportsImport(VkDevice aDevice){
+    return(vkGetDeviceProcAddr(aDevice, "vkGetMemoryHostPointerPropertiesEXT") != nullptr);
+}
+
+VkDeviceSize HostImportedBuffer::importAlignment(VkPhysicalDevice aPhysicalDevice){
+    PFN_vkGetPhysicalDeviceProperties2 getProperties2 = get_physical_device_properties2_func(aPhysicalDevice);
+    if(getProperties2 == nullptr) return(0);
+
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties = {};
+    hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties2 = {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &hostProperties;
+    getProperties2(aPhysicalDevice, &properties2);
+    return(hostProperties.minImportedHostPointerAlignment);
+}
+
+void HostImportedBuffer::_init(VkBufferUsageFlags aUsage, StagingUploader* aFallbackUploader){
+    if(_mHostPointer == nullptr || _mSize == 0) throw std::runtime_error("Attempted to wrap an empty host allocation!");
+    if(!_tryImport(aUsage)){
+        _createFallback(aUsage, aFallbackUploader);
+    }
+}
+
+bool HostImportedBuffer::_tryImport(VkBufferUsageFlags aUsage){
+    const VulkanDeviceHandlePair& devicePair = _mClosure->getDevicePair();
+    PFN_vkGetMemoryHostPointerPropertiesEXT getPointerProperties = reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+        vkGetDeviceProcAddr(devicePair.device, "vkGetMemoryHostPointerPropertiesEXT")
+    );
+    if(getPointerProperties == nullptr) return(false);
+
+    // The imported range is the size rounded up to the alignment, and must not run past the allocation
+    const VkDeviceSize alignment = importAlignment(devicePair.physicalDevice);
+    if(alignment == 0 || reinterpret_cast<uintptr_t>(_mHostPointer) % alignment != 0) return(false);
+    const VkDeviceSize importSize = (_mSize + alignment - 1) / alignment * alignment;
+    if(importSize > _mAllocationSize) return(false);
+
+    PFN_vkGetPhysicalDeviceExternalBufferProperties getExternalProperties = get_physical_device_external_buffer_properties_func(devicePair.physicalDevice);
+    if(getExternalProperties == nullptr) return(false);
+
+    VkPhysicalDeviceExternalBufferInfo externalBufferInfo = {};
+    {
+        externalBufferInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_BUFFER_INFO;
+        externalBufferInfo.pNext = nullptr;
+        externalBufferInfo.flags = 0;
+        externalBufferInfo.usage = aUsage;
+        externalBufferInfo.handleType = _mHandleType;
+    }
+    VkExternalBufferProperties externalProperties = {};
+    externalProperties.sType = VK_STRUCTURE_TYPE_EXTERNAL_BUFFER_PROPERTIES;
+    getExternalProperties(devicePair.physicalDevice, &externalBufferInfo, &externalProperties);
+    if(!(externalProperties.externalMemoryProperties.externalMemoryFeatures & VK_EXTERNAL_MEMORY_FEATURE_IMPORTABLE_BIT)) return(false);
+
+    VkMemoryHostPointerPropertiesEXT pointerProperties = {};
+    pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    VkResult result = getPointerProperties(devicePair.device, _mHandleType, _mHostPointer, &pointerProperties);
+    if(result != VK_SUCCESS) return(false);
+
+    VkExternalMemoryBufferCreateInfo externalInfo = {};
+    {
+        externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+        externalInfo.pNext = nullptr;
+        externalInfo.handleTypes = _mHandleType;
+    }
+
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = &externalInfo;
+        bufferInfo.flags = 0;
+        bufferInfo.size = _mSize;
+        bufferInfo.usage = aUsage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    if(vkCreateBuffer(devicePair.device, &bufferInfo, nullptr, &_mBuffer) != VK_SUCCESS){
+        _mBuffer = VK_NULL_HANDLE;
+        return(false);
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(devicePair.device, _mBuffer, &requirements);
+    uint32_t typeBits = requirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+    if(typeBits == 0 || requirements.size > importSize){
+        vkDestroyBuffer(devicePair.device, _mBuffer, nullptr);
+        _mBuffer = VK_NULL_HANDLE;
+        return(false);
+    }
+    uint32_t memoryTypeIdx = 0;
+    while(!(typeBits & (1u << memoryTypeIdx))) ++memoryTypeIdx;
+
+    VkImportMemoryHostPointerInfoEXT importInfo = {};
+    {
+        importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+        importInfo.pNext = nullptr;
+        importInfo.handleType = _mHandleType;
+        importInfo.pHostPointer = const_cast<void*>(_mHostPointer);
+    }
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    {
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.pNext = &importInfo;
+        allocateInfo.allocationSize = importSize;
+        allocateInfo.memoryTypeIndex = memoryTypeIdx;
+    }
+
+    result = vkAllocateMemory(devicePair.device, &allocateInfo, nullptr, &_mImportedMemory);
+    if(result == VK_SUCCESS) result = vkBindBufferMemory(devicePair.device, _mBuffer, _mImportedMemory, 0);
+    if(result != VK_SUCCESS){
+        std::cerr << "Warning: Failed to import host memory (" << vk_result_str(result) << "), falling back to a staged copy" << std::endl;
+        if(_mImportedMemory != VK_NULL_HANDLE) vkFreeMemory(devicePair.device, _mImportedMemory, nullptr);
+        vkDestroyBuffer(devicePair.device, _mBuffer, nullptr);
+        _mImportedMemory = VK_NULL_HANDLE;
+        _mBuffer = VK_NULL_HANDLE;
+        return(false);
+    }
+    return(true);
+}
+
+void HostImportedBuffer::_createFallback(VkBufferUsageFlags aUsage, StagingUploader* aUploader){
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = nullptr;
+        bufferInfo.flags = 0;
+        bufferInfo.size = _mSize;
+        bufferInfo.usage = aUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    {
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    }
+
+    _mAllocator = VmaHost::getAllocator(_mClosure->getDevicePair());
+    VkResult result = vmaCreateBuffer(_mAllocator, &bufferInfo, &allocInfo, &_mBuffer, &_mAllocation, nullptr);
+    if(result != VK_SUCCESS){
+        _mBuffer = VK_NULL_HANDLE;
+        throw std::runtime_error("Failed to create fallback buffer for host memory! (" + std::string(vk_result_str(result)) + ")");
+    }
+
+    _mUploader = aUploader;
+    sync();
+}
+
+void HostImportedBuffer::_destroy(){
+    if(_mBuffer == VK_NULL_HANDLE) return;
+    if(isImported()){
+        VkDevice device = _mClosure->getDevicePair().device;
+        vkDestroyBuffer(device, _mBuffer, nullptr);
+        vkFreeMemory(device, _mImportedMemory, nullptr);
+        _mImportedMemory = VK_NULL_HANDLE;
+    }else{
+        _mReadyTicket.wait();
+        vmaDestroyBuffer(_mAllocator, _mBuffer, _mAllocation);
+        _mAllocation = nullptr;
+    }
+    _mBuffer = VK_NULL_HANDLE;
+}
+
+} // end namespace vkutils
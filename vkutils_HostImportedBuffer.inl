@@ -0,0 +1,89 @@
+#include <vulkan/vulkan.h>
+
+/// VkBuffer that aliases existing host memory through VK_EXT_external_memory_host.
+///
+/// When the memory can be imported the GPU reads and writes it in place, with no copy at all.
+/// Otherwise (extension not enabled, misaligned pointer or size, no compatible memory type) the buffer
+/// falls back to device-local memory filled through a StagingUploader, and sync() must be called
+/// to push later host changes to it.
+///
+/// Imported memory must stay allocated, and must not be freed or unmapped, until the buffer is
+/// destroyed. Host writes to it must be ordered against GPU access like any other host-visible memory.
+class HostImportedBuffer
+{
+ public:
+    HostImportedBuffer() = default;
+
+    /// \param aHostPointer Memory to wrap. It is imported only if aligned to importAlignment().
+    /// \param aFallbackUploader Uploader used when the memory can't be imported. If null, a temporary one
+    ///                          is used and the constructor blocks until the copy completes.
+    /// \param aAllocationSize Size of the allocation starting at `aHostPointer`, or 0 if it is `aSize`. The
+    ///                        import covers `aSize` rounded up to importAlignment(), so memory is only
+    ///                        imported when that fits in the allocation.
+    /// \throw std::runtime_error If neither importing nor the fallback buffer succeed
+    HostImportedBuffer(
+        const QueueClosure& aClosure, void* aHostPointer, VkDeviceSize aSize,
+        VkBufferUsageFlags aUsage, StagingUploader* aFallbackUploader = nullptr,
+        VkDeviceSize aAllocationSize = 0
+    );
+
+    /// Wraps a file mapping for read-only use by the GPU. `aFile` must outlive the buffer.
+    ///
+    /// The mapping is imported as VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_MAPPED_FOREIGN_MEMORY_BIT_EXT, since
+    /// it isn't an ordinary host allocation, and spans the file's pages. Drivers that won't import it get
+    /// the staged fallback. The GPU must not write to the buffer either way.
+    HostImportedBuffer(
+        const QueueClosure& aClosure, const MappedFile& aFile,
+        VkBufferUsageFlags aUsage, StagingUploader* aFallbackUploader = nullptr
+    );
+
+    /// Waits for a pending fallback copy, then frees the buffer
+    ~HostImportedBuffer();
+
+    HostImportedBuffer(HostImportedBuffer&& aOther) noexcept;
+    HostImportedBuffer& operator=(HostImportedBuffer&& aOther) noexcept;
+    HostImportedBuffer(const HostImportedBuffer&) = delete;
+    HostImportedBuffer& operator=(const HostImportedBuffer&) = delete;
+
+    bool isValid() const {return(_mBuffer != VK_NULL_HANDLE);}
+    VkBuffer getBuffer() const {return(_mBuffer);}
+    VkDeviceSize getSize() const {return(_mSize);}
+
+    /// True if the buffer aliases the host memory; false if it holds a staged copy
+    bool isImported() const {return(_mImportedMemory != VK_NULL_HANDLE);}
+
+    /// Completes once the buffer holds the host data. Already complete for imported buffers.
+    const UploadTicket& getReadyTicket() const {return(_mReadyTicket);}
+
+    /// Makes host writes to the given range visible through the buffer. A no-op for imported buffers;
+    /// re-stages the range for fallback buffers.
+    UploadTicket sync(VkDeviceSize aOffset = 0, VkDeviceSize aSize = VK_WHOLE_SIZE);
+
+    /// True if `aDevice` was created with VK_EXT_external_memory_host enabled
+    static bool supportsImport(VkDevice aDevice);
+
+    /// minImportedHostPointerAlignment of the device, or 0 if it can't be queried
+    static VkDeviceSize importAlignment(VkPhysicalDevice aPhysicalDevice);
+
+ protected:
+    void _init(VkBufferUsageFlags aUsage, StagingUploader* aFallbackUploader);
+    bool _tryImport(VkBufferUsageFlags aUsage);
+    void _createFallback(VkBufferUsageFlags aUsage, StagingUploader* aUploader);
+    void _destroy();
+
+ private:
+    // Device and queue for re-staging. Held by pointer since QueueClosure has no empty state
+    std::unique_ptr<QueueClosure> _mClosure;
+    const void* _mHostPointer = nullptr;
+    VkDeviceSize _mSize = 0;
+    VkDeviceSize _mAllocationSize = 0;
+    VkExternalMemoryHandleTypeFlagBits _mHandleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    VkBuffer _mBuffer = VK_NULL_HANDLE;
+
+    VkDeviceMemory _mImportedMemory = VK_NULL_HANDLE;
+
+    VmaAllocator _mAllocator = nullptr;
+    VmaAllocation _mAllocation = nullptr;
+    StagingUploader* _mUploader = nullptr;
+    UploadTicket _mReadyTicket;
+};
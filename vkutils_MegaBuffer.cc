@@ -0,0 +1,216 @@
+#include "vkutils.h"
+#include "VmaHost.h"
+
+namespace vkutils{
+
+MegaBuffer::MegaBuffer(
+    const VulkanDeviceHandlePair& aDevicePair,
+    VkDeviceSize aBlockSize,
+    VkBufferUsageFlags aUsage,
+    VmaMemoryUsage aMemoryUsage,
+    uint32_t aMaxBlocks
+)
+:   _mAllocator(VmaHost::getAllocator(aDevicePair)),
+    _mBlockSize(aBlockSize),
+    _mUsage(aUsage),
+    _mMemoryUsage(aMemoryUsage),
+    _mMaxBlocks(std::max<uint32_t>(aMaxBlocks, 1))
+{
+    if(aBlockSize == 0) throw std::runtime_error("Attempted to create a mega buffer with no capacity!");
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    VkResult result = _createBlockLocked();
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create mega buffer block! (" + std::string(vk_result_str(result)) + ")");
+    }
+}
+
+MegaBuffer::~MegaBuffer(){
+    for(Block& block : _mBlocks){
+        _destroyBlock(block);
+    }
+}
+
+VkResult MegaBuffer::_createBlockLocked(){
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = nullptr;
+        bufferInfo.flags = 0;
+        bufferInfo.size = _mBlockSize;
+        bufferInfo.usage = _mUsage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    {
+        allocInfo.usage = _mMemoryUsage;
+        if(_mMemoryUsage != VMA_MEMORY_USAGE_GPU_ONLY){
+            allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        }
+    }
+
+    Block block;
+    VmaAllocationInfo allocation = {};
+    VkResult result = vmaCreateBuffer(_mAllocator, &bufferInfo, &allocInfo, &block.mBuffer, &block.mAllocation, &allocation);
+    if(result != VK_SUCCESS) return(result);
+    block.mMapped = static_cast<uint8_t*>(allocation.pMappedData);
+
+    VmaVirtualBlockCreateInfo virtualInfo = {};
+    {
+        virtualInfo.size = _mBlockSize;
+        virtualInfo.flags = 0;
+        virtualInfo.pAllocationCallbacks = nullptr;
+    }
+    result = vmaCreateVirtualBlock(&virtualInfo, &block.mVirtualBlock);
+    if(result != VK_SUCCESS){
+        vmaDestroyBuffer(_mAllocator, block.mBuffer, block.mAllocation);
+        return(result);
+    }
+
+    // Reuse the slot of a trimmed block if there is one
+    for(Block& slot : _mBlocks){
+        if(slot.mBuffer == VK_NULL_HANDLE){
+            slot = block;
+            return(VK_SUCCESS);
+        }
+    }
+    _mBlocks.push_back(block);
+    return(VK_SUCCESS);
+}
+
+void MegaBuffer::_destroyBlock(Block& aBlock){
+    if(aBlock.mBuffer == VK_NULL_HANDLE) return;
+    // Ranges may still be outstanding when the whole mega buffer is destroyed
+    vmaClearVirtualBlock(aBlock.mVirtualBlock);
+    vmaDestroyVirtualBlock(aBlock.mVirtualBlock);
+    vmaDestroyBuffer(_mAllocator, aBlock.mBuffer, aBlock.mAllocation);
+    aBlock = Block();
+}
+
+MegaBufferRange MegaBuffer::allocate(VkDeviceSize aSize, VkDeviceSize aAlignment){
+    MegaBufferRange range;
+    if(aSize == 0 || aSize > _mBlockSize) return(range);
+
+    VmaVirtualAllocationCreateInfo createInfo = {};
+    {
+        createInfo.size = aSize;
+        createInfo.alignment = std::max<VkDeviceSize>(aAlignment, 1);
+        createInfo.flags = 0;
+        createInfo.pUserData = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    for(size_t attempt = 0; attempt < 2; ++attempt){
+        for(size_t i = 0; i < _mBlocks.size(); ++i){
+            Block& block = _mBlocks[i];
+            if(block.mBuffer == VK_NULL_HANDLE) continue;
+            if(vmaVirtualAllocate(block.mVirtualBlock, &createInfo, &range.mAllocation, &range.mOffset) == VK_SUCCESS){
+                range.mBuffer = block.mBuffer;
+                range.mSize = aSize;
+                range.mMapped = block.mMapped != nullptr ? block.mMapped + range.mOffset : nullptr;
+                range.mBlockIndex = static_cast<uint32_t>(i);
+                return(range);
+            }
+        }
+
+        // Every block is full, so grow by one and try again
+        if(attempt != 0 || _blockCountLocked() >= _mMaxBlocks) break;
+        if(_createBlockLocked() != VK_SUCCESS) break;
+    }
+    return(MegaBufferRange());
+}
+
+MegaBufferRange MegaBuffer::allocateElements(uint32_t aCount, VkDeviceSize aElementSize){
+    if(aElementSize == 0) return(MegaBufferRange());
+
+    const VkDeviceSize size = VkDeviceSize(aCount) * aElementSize;
+    if((aElementSize & (aElementSize - 1)) == 0) return(allocate(size, aElementSize));
+
+    // Other sizes can't be expressed as a virtual block alignment, so over-allocate and round the offset up
+    MegaBufferRange range = allocate(size + aElementSize - 1, 1);
+    if(range.isValid()){
+        const VkDeviceSize padding = (aElementSize - range.mOffset % aElementSize) % aElementSize;
+        range.mOffset += padding;
+        range.mSize = size;
+        if(range.mMapped != nullptr) range.mMapped = static_cast<uint8_t*>(range.mMapped) + padding;
+    }
+    return(range);
+}
+
+void MegaBuffer::free(MegaBufferRange& aRange){
+    if(!aRange.isValid()) return;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        // trim() may have dropped the block of a range handed out before clear()
+        if(aRange.mBlockIndex < _mBlocks.size() && _mBlocks[aRange.mBlockIndex].mBuffer == aRange.mBuffer){
+            vmaVirtualFree(_mBlocks[aRange.mBlockIndex].mVirtualBlock, aRange.mAllocation);
+        }
+    }
+    aRange = MegaBufferRange();
+}
+
+VkResult MegaBuffer::flush(const MegaBufferRange& aRange){
+    if(!aRange.isValid()) return(VK_SUCCESS);
+    std::lock_guard<std::mutex> lock(_mMutex);
+    if(aRange.mBlockIndex >= _mBlocks.size() || _mBlocks[aRange.mBlockIndex].mBuffer != aRange.mBuffer) return(VK_SUCCESS);
+    return(vmaFlushAllocation(_mAllocator, _mBlocks[aRange.mBlockIndex].mAllocation, aRange.mOffset, aRange.mSize));
+}
+
+void MegaBuffer::clear(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    for(Block& block : _mBlocks){
+        if(block.mBuffer != VK_NULL_HANDLE) vmaClearVirtualBlock(block.mVirtualBlock);
+    }
+}
+
+void MegaBuffer::trim(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    for(size_t i = 1; i < _mBlocks.size(); ++i){
+        if(_mBlocks[i].mBuffer != VK_NULL_HANDLE && vmaIsVirtualBlockEmpty(_mBlocks[i].mVirtualBlock)){
+            _destroyBlock(_mBlocks[i]);
+        }
+    }
+    while(_mBlocks.size() > 1 && _mBlocks.back().mBuffer == VK_NULL_HANDLE){
+        _mBlocks.pop_back();
+    }
+}
+
+size_t MegaBuffer::getBlockCount() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_blockCountLocked());
+}
+
+size_t MegaBuffer::_blockCountLocked() const{
+    return(std::count_if(_mBlocks.begin(), _mBlocks.end(), [](const Block& aBlock){return(aBlock.mBuffer != VK_NULL_HANDLE);}));
+}
+
+VkBuffer MegaBuffer::getBuffer(size_t aIndex) const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(aIndex < _mBlocks.size() ? _mBlocks[aIndex].mBuffer : VK_NULL_HANDLE);
+}
+
+MegaBufferStats MegaBuffer::stats() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    MegaBufferStats stats;
+    for(const Block& block : _mBlocks){
+        if(block.mBuffer == VK_NULL_HANDLE) continue;
+
+        VmaDetailedStatistics blockStats = {};
+        vmaCalculateVirtualBlockStatistics(block.mVirtualBlock, &blockStats);
+        ++stats.mBlockCount;
+        stats.mRangeCount += blockStats.statistics.allocationCount;
+        stats.mCapacity += blockStats.statistics.blockBytes;
+        stats.mUsedBytes += blockStats.statistics.allocationBytes;
+        stats.mFreeRegionCount += blockStats.unusedRangeCount;
+        if(blockStats.unusedRangeCount != 0){
+            const VkDeviceSize blockFree = blockStats.statistics.blockBytes - blockStats.statistics.allocationBytes;
+            stats.mLargestFreeRegion = std::max(stats.mLargestFreeRegion, blockStats.unusedRangeSizeMax);
+            stats.mFragmentedBytes += blockFree - blockStats.unusedRangeSizeMax;
+        }
+    }
+    stats.mFreeBytes = stats.mCapacity - stats.mUsedBytes;
+    return(stats);
+}
+
+} // end namespace vkutils
@@ -0,0 +1,122 @@
+#include <vulkan/vulkan.h>
+
+/// Range of a MegaBuffer handed out by allocate()
+struct MegaBufferRange
+{
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    VkDeviceSize mOffset = 0;
+    VkDeviceSize mSize = 0;
+    void* mMapped = nullptr;    ///< Host pointer to the range for host visible mega buffers, otherwise null
+
+    bool isValid() const {return(mBuffer != VK_NULL_HANDLE);}
+
+    /// Offset in elements of `aElementSize`, e.g. the firstIndex or vertexOffset of a draw. Exact for
+    /// ranges from allocateElements() with the same element size.
+    uint32_t elementOffset(VkDeviceSize aElementSize) const {return(static_cast<uint32_t>(mOffset / aElementSize));}
+
+ protected:
+    friend class MegaBuffer;
+    uint32_t mBlockIndex = 0;
+    VmaVirtualAllocation mAllocation = VK_NULL_HANDLE;
+};
+
+/// Occupancy of a MegaBuffer
+struct MegaBufferStats
+{
+    size_t mBlockCount = 0;
+    uint32_t mRangeCount = 0;
+    VkDeviceSize mCapacity = 0;         ///< Total size of all blocks
+    VkDeviceSize mUsedBytes = 0;        ///< Including padding for alignment
+    VkDeviceSize mFreeBytes = 0;
+    uint32_t mFreeRegionCount = 0;      ///< Separate runs of free space across all blocks
+    VkDeviceSize mLargestFreeRegion = 0;
+    VkDeviceSize mFragmentedBytes = 0;  ///< Free bytes outside the largest free region of their own block
+
+    /// 0 when each block's free space is one contiguous run, approaching 1 as free space splinters
+    double fragmentation() const {return(mFreeBytes == 0 ? 0.0 : static_cast<double>(mFragmentedBytes) / static_cast<double>(mFreeBytes));}
+};
+
+/// Hands out ranges of a few large buffers in place of many small buffers.
+///
+/// Each block is one VkBuffer allocated through VmaHost, managed by a VMA virtual block that tracks
+/// which ranges are taken. Blocks are created on demand up to a limit, and freed ranges are reused by
+/// later allocations. Meshes stored in the same block share a single vertex and index buffer binding,
+/// with their ranges selected through the firstIndex and vertexOffset of each draw.
+///
+/// Safe to use from any thread. Freed ranges may be reused immediately, so the GPU must be done with
+/// a range before it is freed.
+class MegaBuffer
+{
+ public:
+    /// \param aBlockSize Size of each buffer. Larger allocations fail.
+    /// \param aUsage Usage of every block, e.g. VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+    /// \param aMemoryUsage Where blocks live. Anything other than VMA_MEMORY_USAGE_GPU_ONLY is mapped persistently.
+    /// \param aMaxBlocks Blocks created at most
+    /// \throw std::runtime_error If the first block can't be created
+    MegaBuffer(
+        const VulkanDeviceHandlePair& aDevicePair,
+        VkDeviceSize aBlockSize,
+        VkBufferUsageFlags aUsage,
+        VmaMemoryUsage aMemoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+        uint32_t aMaxBlocks = 8
+    );
+    ~MegaBuffer();
+
+    MegaBuffer(const MegaBuffer&) = delete;
+    MegaBuffer& operator=(const MegaBuffer&) = delete;
+
+    /// Reserves `aSize` bytes at a multiple of `aAlignment`, which must be a power of two
+    /// \returns An invalid range if no block has room and no more blocks can be created
+    MegaBufferRange allocate(VkDeviceSize aSize, VkDeviceSize aAlignment = 16);
+
+    /// Reserves `aCount` elements at an offset that is a multiple of `aElementSize`, which need not be a
+    /// power of two, so that elementOffset() can address the range in draws
+    MegaBufferRange allocateElements(uint32_t aCount, VkDeviceSize aElementSize);
+
+    /// Returns `aRange` for reuse and invalidates it. Invalid ranges are ignored.
+    void free(MegaBufferRange& aRange);
+
+    /// Makes host writes to `aRange` visible to the device. Needed only for host visible blocks whose
+    /// memory isn't HOST_COHERENT; VMA ignores the call otherwise.
+    /// \returns The result of vmaFlushAllocation, or VK_SUCCESS for an invalid range
+    VkResult flush(const MegaBufferRange& aRange);
+
+    /// Frees every range at once. Ranges handed out before must not be freed afterwards.
+    void clear();
+
+    /// Destroys empty blocks other than the first
+    void trim();
+
+    size_t getBlockCount() const;
+    VkDeviceSize getBlockSize() const {return(_mBlockSize);}
+
+    /// Buffer of block `aIndex`, or VK_NULL_HANDLE if there is no such block
+    VkBuffer getBuffer(size_t aIndex) const;
+
+    MegaBufferStats stats() const;
+
+ protected:
+    struct Block
+    {
+        VkBuffer mBuffer = VK_NULL_HANDLE;
+        VmaAllocation mAllocation = nullptr;
+        VmaVirtualBlock mVirtualBlock = nullptr;
+        uint8_t* mMapped = nullptr;
+    };
+
+    /// Creates a block and adds it to _mBlocks. Must hold _mMutex.
+    VkResult _createBlockLocked();
+    void _destroyBlock(Block& aBlock);
+    size_t _blockCountLocked() const;
+
+ private:
+    VmaAllocator _mAllocator = nullptr;
+    VkDeviceSize _mBlockSize = 0;
+    VkBufferUsageFlags _mUsage = 0;
+    VmaMemoryUsage _mMemoryUsage = VMA_MEMORY_USAGE_GPU_ONLY;
+    uint32_t _mMaxBlocks = 0;
+
+    mutable std::mutex _mMutex;
+    // Destroyed blocks leave a null entry so the block index of live ranges stays valid
+    std::vector<Block> _mBlocks;
+};
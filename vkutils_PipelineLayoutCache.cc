@@ -0,0 +1,272 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+namespace{
+
+// Marks key words that identify an object by address or handle instead of by structure
+constexpr uint32_t kIdentityTag = 0xFFFFFFFF;
+
+template<typename HandleType>
+void append_handle(std::vector<uint32_t>& aKey, HandleType aHandle){
+    uint64_t value = 0;
+    std::memcpy(&value, &aHandle, sizeof(aHandle));
+    aKey.push_back(static_cast<uint32_t>(value));
+    aKey.push_back(static_cast<uint32_t>(value >> 32));
+}
+
+std::vector<uint32_t> set_layout_key(const VkDescriptorSetLayoutCreateInfo& aCreateInfo){
+    std::vector<uint32_t> key;
+    key.reserve(2 + aCreateInfo.bindingCount * 6);
+    key.push_back(aCreateInfo.flags);
+
+    const VkDescriptorBindingFlags* bindingFlags = nullptr;
+    for(const VkBaseInStructure* next = static_cast<const VkBaseInStructure*>(aCreateInfo.pNext); next != nullptr; next = next->pNext){
+        if(next->sType == VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO){
+            const VkDescriptorSetLayoutBindingFlagsCreateInfo* flagsInfo = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo*>(next);
+            if(flagsInfo->bindingCount == aCreateInfo.bindingCount) bindingFlags = flagsInfo->pBindingFlags;
+        }else{
+            key.push_back(kIdentityTag);
+            append_handle(key, next);
+        }
+    }
+
+    // Binding order in the create info doesn't affect the layout
+    std::vector<uint32_t> order(aCreateInfo.bindingCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&aCreateInfo](uint32_t a, uint32_t b){
+        return(aCreateInfo.pBindings[a].binding < aCreateInfo.pBindings[b].binding);
+    });
+
+    key.push_back(aCreateInfo.bindingCount);
+    for(uint32_t index : order){
+        const VkDescriptorSetLayoutBinding& binding = aCreateInfo.pBindings[index];
+        key.push_back(binding.binding);
+        key.push_back(static_cast<uint32_t>(binding.descriptorType));
+        key.push_back(binding.descriptorCount);
+        key.push_back(binding.stageFlags);
+        key.push_back(bindingFlags != nullptr ? bindingFlags[index] : 0);
+        key.push_back(binding.pImmutableSamplers != nullptr ? 1 : 0);
+        if(binding.pImmutableSamplers != nullptr){
+            for(uint32_t i = 0; i < binding.descriptorCount; ++i){
+                append_handle(key, binding.pImmutableSamplers[i]);
+            }
+        }
+    }
+    return(key);
+}
+
+} // end anonymous namespace
+
+CachedDescriptorSetLayout::~CachedDescriptorSetLayout(){
+    mCache->_forgetSetLayout(mKey, mLayout);
+    vkDestroyDescriptorSetLayout(mCache->getDevice(), mLayout, nullptr);
+}
+
+CachedPipelineLayout::~CachedPipelineLayout(){
+    mCache->_forgetPipelineLayout(mKey);
+    vkDestroyPipelineLayout(mCache->getDevice(), mLayout, nullptr);
+}
+
+std::shared_ptr<PipelineLayoutCache> PipelineLayoutCache::forDevice(VkDevice aDevice){
+    static std::mutex sRegistryMutex;
+    static std::unordered_map<VkDevice, std::weak_ptr<PipelineLayoutCache>> sRegistry;
+
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    // Prunes caches that have been released, including those of destroyed devices
+    for(auto iter = sRegistry.begin(); iter != sRegistry.end();){
+        if(iter->second.expired() && iter->first != aDevice) iter = sRegistry.erase(iter);
+        else ++iter;
+    }
+
+    std::shared_ptr<PipelineLayoutCache> cache = sRegistry[aDevice].lock();
+    if(cache == nullptr){
+        cache = std::make_shared<PipelineLayoutCache>(aDevice);
+        sRegistry[aDevice] = cache;
+    }
+    return(cache);
+}
+
+VkResult PipelineLayoutCache::getSetLayout(const VkDescriptorSetLayoutCreateInfo& aCreateInfo, DescriptorSetLayoutRef& aLayoutOut){
+    Key key = set_layout_key(aCreateInfo);
+
+    // Declared outside the lock, since releasing the last reference to an entry takes the lock again
+    std::shared_ptr<CachedDescriptorSetLayout> entry;
+    VkResult result = VK_SUCCESS;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        auto finder = _mSetLayouts.find(key);
+        if(finder != _mSetLayouts.end()) entry = finder->second.lock();
+
+        if(entry != nullptr){
+            ++_mHits;
+        }else{
+            VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+            result = vkCreateDescriptorSetLayout(_mDevice, &aCreateInfo, nullptr, &layout);
+            if(result == VK_SUCCESS){
+                entry = std::make_shared<CachedDescriptorSetLayout>();
+                {
+                    entry->mCache = shared_from_this();
+                    entry->mLayout = layout;
+                    entry->mKey = key;
+                }
+                _mSetLayouts[std::move(key)] = entry;
+                _mSetLayoutsByHandle[layout] = entry;
+                ++_mMisses;
+            }
+        }
+    }
+
+    if(result == VK_SUCCESS) aLayoutOut = DescriptorSetLayoutRef(entry);
+    return(result);
+}
+
+VkResult PipelineLayoutCache::getSetLayout(const DescriptorSetLayoutDescription& aDescription, DescriptorSetLayoutRef& aLayoutOut){
+    std::vector<VkDescriptorBindingFlags> bindingFlags(aDescription.mBindings.size());
+    bool hasBindingFlags = false;
+    for(size_t i = 0; i < bindingFlags.size(); ++i){
+        bindingFlags[i] = aDescription.getBindingFlags(i);
+        hasBindingFlags |= bindingFlags[i] != 0;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo;
+    {
+        flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        flagsInfo.pNext = nullptr;
+        flagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        flagsInfo.pBindingFlags = bindingFlags.data();
+    }
+
+    VkDescriptorSetLayoutCreateInfo createInfo;
+    {
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        createInfo.pNext = hasBindingFlags ? &flagsInfo : nullptr;
+        createInfo.flags = aDescription.mFlags;
+        createInfo.bindingCount = static_cast<uint32_t>(aDescription.mBindings.size());
+        createInfo.pBindings = aDescription.mBindings.data();
+    }
+    return(getSetLayout(createInfo, aLayoutOut));
+}
+
+VkResult PipelineLayoutCache::getPipelineLayout(const VkPipelineLayoutCreateInfo& aCreateInfo, PipelineLayoutRef& aLayoutOut){
+    std::vector<std::shared_ptr<CachedDescriptorSetLayout>> ownedSetLayouts;
+    std::shared_ptr<CachedPipelineLayout> entry;
+    VkResult result = VK_SUCCESS;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+
+        Key key;
+        key.push_back(aCreateInfo.flags);
+        if(aCreateInfo.pNext != nullptr){
+            key.push_back(kIdentityTag);
+            append_handle(key, aCreateInfo.pNext);
+        }
+
+        // Nest the structure of set layouts this cache made, so equal layouts match regardless of handle
+        key.push_back(aCreateInfo.setLayoutCount);
+        for(uint32_t i = 0; i < aCreateInfo.setLayoutCount; ++i){
+            std::shared_ptr<CachedDescriptorSetLayout> setLayout;
+            auto finder = _mSetLayoutsByHandle.find(aCreateInfo.pSetLayouts[i]);
+            if(finder != _mSetLayoutsByHandle.end()) setLayout = finder->second.lock();
+
+            if(setLayout != nullptr){
+                key.push_back(static_cast<uint32_t>(setLayout->mKey.size()));
+                key.insert(key.end(), setLayout->mKey.begin(), setLayout->mKey.end());
+                ownedSetLayouts.push_back(std::move(setLayout));
+            }else{
+                key.push_back(kIdentityTag);
+                append_handle(key, aCreateInfo.pSetLayouts[i]);
+            }
+        }
+
+        std::vector<VkPushConstantRange> ranges(aCreateInfo.pPushConstantRanges, aCreateInfo.pPushConstantRanges + aCreateInfo.pushConstantRangeCount);
+        std::sort(ranges.begin(), ranges.end(), [](const VkPushConstantRange& a, const VkPushConstantRange& b){
+            return(a.offset != b.offset ? a.offset < b.offset : a.stageFlags < b.stageFlags);
+        });
+        key.push_back(static_cast<uint32_t>(ranges.size()));
+        for(const VkPushConstantRange& range : ranges){
+            key.push_back(range.stageFlags);
+            key.push_back(range.offset);
+            key.push_back(range.size);
+        }
+
+        auto finder = _mPipelineLayouts.find(key);
+        if(finder != _mPipelineLayouts.end()) entry = finder->second.lock();
+
+        if(entry != nullptr){
+            ++_mHits;
+        }else{
+            VkPipelineLayout layout = VK_NULL_HANDLE;
+            result = vkCreatePipelineLayout(_mDevice, &aCreateInfo, nullptr, &layout);
+            if(result == VK_SUCCESS){
+                entry = std::make_shared<CachedPipelineLayout>();
+                {
+                    entry->mCache = shared_from_this();
+                    entry->mLayout = layout;
+                    entry->mKey = key;
+                    entry->mSetLayouts = ownedSetLayouts;
+                }
+                _mPipelineLayouts[std::move(key)] = entry;
+                ++_mMisses;
+            }
+        }
+    }
+
+    if(result == VK_SUCCESS) aLayoutOut = PipelineLayoutRef(entry);
+    return(result);
+}
+
+VkResult PipelineLayoutCache::getPipelineLayout(const PipelineLayoutDescription& aDescription, PipelineLayoutRef& aLayoutOut){
+    std::vector<DescriptorSetLayoutRef> setLayoutRefs(aDescription.mSetLayouts.size());
+    std::vector<VkDescriptorSetLayout> setLayouts(aDescription.mSetLayouts.size());
+    for(size_t i = 0; i < setLayouts.size(); ++i){
+        VkResult result = getSetLayout(aDescription.mSetLayouts[i], setLayoutRefs[i]);
+        if(result != VK_SUCCESS) return(result);
+        setLayouts[i] = setLayoutRefs[i].get();
+    }
+
+    VkPipelineLayoutCreateInfo createInfo;
+    {
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = 0;
+        createInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        createInfo.pSetLayouts = setLayouts.data();
+        createInfo.pushConstantRangeCount = static_cast<uint32_t>(aDescription.mPushConstantRanges.size());
+        createInfo.pPushConstantRanges = aDescription.mPushConstantRanges.data();
+    }
+    return(getPipelineLayout(createInfo, aLayoutOut));
+}
+
+PipelineLayoutCacheStats PipelineLayoutCache::stats() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    PipelineLayoutCacheStats stats;
+    stats.mHits = _mHits;
+    stats.mMisses = _mMisses;
+    for(const auto& entry : _mSetLayouts){
+        if(!entry.second.expired()) ++stats.mLiveSetLayouts;
+    }
+    for(const auto& entry : _mPipelineLayouts){
+        if(!entry.second.expired()) ++stats.mLivePipelineLayouts;
+    }
+    return(stats);
+}
+
+void PipelineLayoutCache::_forgetSetLayout(const Key& aKey, VkDescriptorSetLayout aLayout){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    auto finder = _mSetLayouts.find(aKey);
+    if(finder != _mSetLayouts.end() && finder->second.expired()){
+        _mSetLayouts.erase(finder);
+    }
+    _mSetLayoutsByHandle.erase(aLayout);
+}
+
+void PipelineLayoutCache::_forgetPipelineLayout(const Key& aKey){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    auto finder = _mPipelineLayouts.find(aKey);
+    if(finder != _mPipelineLayouts.end() && finder->second.expired()){
+        _mPipelineLayouts.erase(finder);
+    }
+}
+
+} // end namespace vkutils
@@ -0,0 +1,141 @@
+#include <vulkan/vulkan.h>
+
+class PipelineLayoutCache;
+
+/// Descriptor set layout owned by a PipelineLayoutCache, destroyed once the last reference to it is gone
+struct CachedDescriptorSetLayout
+{
+    std::shared_ptr<PipelineLayoutCache> mCache;
+    VkDescriptorSetLayout mLayout = VK_NULL_HANDLE;
+    std::vector<uint32_t> mKey;
+
+    ~CachedDescriptorSetLayout();
+};
+
+/// Pipeline layout owned by a PipelineLayoutCache, destroyed once the last reference to it is gone
+struct CachedPipelineLayout
+{
+    std::shared_ptr<PipelineLayoutCache> mCache;
+    VkPipelineLayout mLayout = VK_NULL_HANDLE;
+    std::vector<uint32_t> mKey;
+
+    // Set layouts the layout was created with that the cache also owns, kept alive alongside it
+    std::vector<std::shared_ptr<CachedDescriptorSetLayout>> mSetLayouts;
+
+    ~CachedPipelineLayout();
+};
+
+/// Reference counted handle to a cached descriptor set layout
+class DescriptorSetLayoutRef
+{
+ public:
+    DescriptorSetLayoutRef() = default;
+
+    bool isValid() const {return(_mEntry != nullptr);}
+    VkDescriptorSetLayout get() const {return(_mEntry ? _mEntry->mLayout : VK_NULL_HANDLE);}
+    void reset() {_mEntry.reset();}
+
+    operator VkDescriptorSetLayout() const {return(get());}
+
+ protected:
+    friend class PipelineLayoutCache;
+    explicit DescriptorSetLayoutRef(std::shared_ptr<CachedDescriptorSetLayout> aEntry) : _mEntry(std::move(aEntry)) {}
+
+ private:
+    std::shared_ptr<CachedDescriptorSetLayout> _mEntry;
+};
+
+/// Reference counted handle to a cached pipeline layout
+class PipelineLayoutRef
+{
+ public:
+    PipelineLayoutRef() = default;
+
+    bool isValid() const {return(_mEntry != nullptr);}
+    VkPipelineLayout get() const {return(_mEntry ? _mEntry->mLayout : VK_NULL_HANDLE);}
+    void reset() {_mEntry.reset();}
+
+    operator VkPipelineLayout() const {return(get());}
+
+    bool operator==(const PipelineLayoutRef& aOther) const {return(_mEntry == aOther._mEntry);}
+    bool operator!=(const PipelineLayoutRef& aOther) const {return(_mEntry != aOther._mEntry);}
+
+ protected:
+    friend class PipelineLayoutCache;
+    explicit PipelineLayoutRef(std::shared_ptr<CachedPipelineLayout> aEntry) : _mEntry(std::move(aEntry)) {}
+
+ private:
+    std::shared_ptr<CachedPipelineLayout> _mEntry;
+};
+
+/// Lookup counters for a PipelineLayoutCache
+struct PipelineLayoutCacheStats
+{
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+    size_t mLiveSetLayouts = 0;
+    size_t mLivePipelineLayouts = 0;
+};
+
+/// Per-device cache of descriptor set layouts and pipeline layouts, keyed by their structure.
+///
+/// Create infos are hashed by content rather than by address: bindings are compared in binding
+/// order along with descriptor binding flags and immutable samplers, and the set layouts a pipeline
+/// layout refers to are compared by their own structure when the cache created them. Structurally
+/// identical requests therefore share one handle, which also makes the resulting pipelines layout
+/// compatible so bound descriptor sets stay valid across them.
+///
+/// Handles are reference counted and destroyed as soon as the last reference is released. Every
+/// live handle keeps the cache alive, but the device must outlive them all. Safe to use from any thread.
+class PipelineLayoutCache : public std::enable_shared_from_this<PipelineLayoutCache>
+{
+ public:
+    explicit PipelineLayoutCache(VkDevice aDevice) : _mDevice(aDevice) {}
+
+    PipelineLayoutCache(const PipelineLayoutCache&) = delete;
+    PipelineLayoutCache& operator=(const PipelineLayoutCache&) = delete;
+
+    /// Returns the cache shared by all users of `aDevice`, creating it if no cache for the device is alive
+    static std::shared_ptr<PipelineLayoutCache> forDevice(VkDevice aDevice);
+
+    VkDevice getDevice() const {return(_mDevice);}
+
+    /// Finds or creates a set layout structurally equal to `aCreateInfo`. Extension structures other
+    /// than VkDescriptorSetLayoutBindingFlagsCreateInfo are compared by address.
+    VkResult getSetLayout(const VkDescriptorSetLayoutCreateInfo& aCreateInfo, DescriptorSetLayoutRef& aLayoutOut);
+
+    /// Finds or creates the set layout for `aDescription`. Its set number is ignored.
+    VkResult getSetLayout(const DescriptorSetLayoutDescription& aDescription, DescriptorSetLayoutRef& aLayoutOut);
+
+    /// Finds or creates a pipeline layout structurally equal to `aCreateInfo`. Set layouts not created
+    /// by this cache are compared by handle, and must outlive the returned layout.
+    VkResult getPipelineLayout(const VkPipelineLayoutCreateInfo& aCreateInfo, PipelineLayoutRef& aLayoutOut);
+
+    /// Finds or creates the pipeline layout for `aDescription`, along with its set layouts
+    VkResult getPipelineLayout(const PipelineLayoutDescription& aDescription, PipelineLayoutRef& aLayoutOut);
+
+    PipelineLayoutCacheStats stats() const;
+
+ protected:
+    friend struct CachedDescriptorSetLayout;
+    friend struct CachedPipelineLayout;
+
+    using Key = std::vector<uint32_t>;
+    struct KeyHash
+    {
+        size_t operator()(const Key& aKey) const noexcept {return(static_cast<size_t>(hash_bytes(aKey.data(), aKey.size() * sizeof(uint32_t))));}
+    };
+
+    void _forgetSetLayout(const Key& aKey, VkDescriptorSetLayout aLayout);
+    void _forgetPipelineLayout(const Key& aKey);
+
+ private:
+    VkDevice _mDevice = VK_NULL_HANDLE;
+
+    mutable std::mutex _mMutex;
+    std::unordered_map<Key, std::weak_ptr<CachedDescriptorSetLayout>, KeyHash> _mSetLayouts;
+    std::unordered_map<VkDescriptorSetLayout, std::weak_ptr<CachedDescriptorSetLayout>> _mSetLayoutsByHandle;
+    std::unordered_map<Key, std::weak_ptr<CachedPipelineLayout>, KeyHash> _mPipelineLayouts;
+    uint64_t _mHits = 0;
+    uint64_t _mMisses = 0;
+};
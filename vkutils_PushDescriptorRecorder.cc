@@ -0,0 +1,143 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+namespace{
+
+enum class InfoKind{Buffer, Image, TexelBuffer, Unsupported};
+
+/// Which info array a push descriptor of type `aType` reads. Dynamic buffers, inline uniform blocks and
+/// acceleration structures can't be pushed through VkDescriptorBufferInfo/VkDescriptorImageInfo writes.
+inline InfoKind info_kind(VkDescriptorType aType){
+    switch(aType){
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            return(InfoKind::Buffer);
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return(InfoKind::TexelBuffer);
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            return(InfoKind::Image);
+        default:
+            return(InfoKind::Unsupported);
+    }
+}
+
+} // end anonymous namespace
+
+PushDescriptorRecorder::PushDescriptorRecorder(VkDevice aDevice)
+:   _mPushDescriptorSet(reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(vkGetDeviceProcAddr(aDevice, "vkCmdPushDescriptorSetKHR"))),
+    _mPushDescriptorSetWithTemplate(reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(vkGetDeviceProcAddr(aDevice, "vkCmdPushDescriptorSetWithTemplateKHR")))
+{
+    if(_mPushDescriptorSet == nullptr){
+        throw std::runtime_error("Attempted to create a push descriptor recorder for a device without " VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME "!");
+    }
+}
+
+PushDescriptorRecorder& PushDescriptorRecorder::clear(){
+    _mWrites.clear();
+    _mInfoIndices.clear();
+    _mBufferInfos.clear();
+    _mImageInfos.clear();
+    _mTexelViews.clear();
+    return(*this);
+}
+
+PushDescriptorRecorder& PushDescriptorRecorder::buffer(uint32_t aBinding, VkDescriptorType aType, VkBuffer aBuffer, VkDeviceSize aOffset, VkDeviceSize aRange, uint32_t aArrayElement){
+    if(info_kind(aType) != InfoKind::Buffer){
+        throw std::runtime_error("Push descriptor buffers must be uniform or storage buffers; dynamic buffers can't be pushed");
+    }
+    _mBufferInfos.push_back({aBuffer, aOffset, aRange});
+    _addWrite(aBinding, aType, aArrayElement, _mBufferInfos.size() - 1);
+    return(*this);
+}
+
+PushDescriptorRecorder& PushDescriptorRecorder::image(uint32_t aBinding, VkDescriptorType aType, VkImageView aView, VkImageLayout aLayout, VkSampler aSampler, uint32_t aArrayElement){
+    if(info_kind(aType) != InfoKind::Image) throw std::runtime_error("Push descriptor images must be samplers, sampled, storage or input attachment images");
+    _mImageInfos.push_back({aSampler, aView, aLayout});
+    _addWrite(aBinding, aType, aArrayElement, _mImageInfos.size() - 1);
+    return(*this);
+}
+
+PushDescriptorRecorder& PushDescriptorRecorder::texelBuffer(uint32_t aBinding, VkDescriptorType aType, VkBufferView aView, uint32_t aArrayElement){
+    if(info_kind(aType) != InfoKind::TexelBuffer) throw std::runtime_error("Push descriptor texel buffers must be uniform or storage texel buffers");
+    _mTexelViews.push_back(aView);
+    _addWrite(aBinding, aType, aArrayElement, _mTexelViews.size() - 1);
+    return(*this);
+}
+
+void PushDescriptorRecorder::_addWrite(uint32_t aBinding, VkDescriptorType aType, uint32_t aArrayElement, size_t aInfoIndex){
+    if(info_kind(aType) == InfoKind::Unsupported){
+        throw std::runtime_error("Descriptor type " + std::to_string(aType) + " can't be pushed");
+    }
+    VkWriteDescriptorSet write;
+    {
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.pNext = nullptr;
+        write.dstSet = VK_NULL_HANDLE; // Ignored when pushing
+        write.dstBinding = aBinding;
+        write.dstArrayElement = aArrayElement;
+        write.descriptorCount = 1;
+        write.descriptorType = aType;
+        write.pImageInfo = nullptr;
+        write.pBufferInfo = nullptr;
+        write.pTexelBufferView = nullptr;
+    }
+    _mWrites.push_back(write);
+    _mInfoIndices.push_back(aInfoIndex);
+}
+
+void PushDescriptorRecorder::push(VkCommandBuffer aCommandBuffer, VkPipelineBindPoint aBindPoint, VkPipelineLayout aLayout, uint32_t aSet){
+    if(_mWrites.empty()) return;
+
+    for(size_t i = 0; i < _mWrites.size(); ++i){
+        VkWriteDescriptorSet& write = _mWrites[i];
+        // Types were checked by the setters, so each write's index is into the matching info array
+        switch(info_kind(write.descriptorType)){
+            case InfoKind::Buffer:
+                write.pBufferInfo = &_mBufferInfos[_mInfoIndices[i]];
+                break;
+            case InfoKind::TexelBuffer:
+                write.pTexelBufferView = &_mTexelViews[_mInfoIndices[i]];
+                break;
+            case InfoKind::Image:
+                write.pImageInfo = &_mImageInfos[_mInfoIndices[i]];
+                break;
+            default:
+                throw std::runtime_error("Descriptor type " + std::to_string(write.descriptorType) + " can't be pushed");
+        }
+    }
+
+    _mPushDescriptorSet(aCommandBuffer, aBindPoint, aLayout, aSet, static_cast<uint32_t>(_mWrites.size()), _mWrites.data());
+    clear();
+}
+
+void PushDescriptorRecorder::push(VkCommandBuffer aCommandBuffer, const DescriptorUpdateTemplate& aTemplate, const void* aData, size_t aDataSize) const{
+    if(!aTemplate.isPushTemplate()) throw std::runtime_error("Attempted to push descriptors with a template made for descriptor sets!");
+    if(aDataSize < aTemplate.getDataSize()) throw std::runtime_error("Descriptor data is smaller than the update template's layout");
+    if(_mPushDescriptorSetWithTemplate == nullptr) throw std::runtime_error("Pushing descriptors with templates is not supported by the device!");
+    _mPushDescriptorSetWithTemplate(aCommandBuffer, aTemplate.get(), aTemplate.getPushLayout(), aTemplate.getPushSet(), aData);
+}
+
+bool PushDescriptorRecorder::supportsPushDescriptors(VkDevice aDevice){
+    return(vkGetDeviceProcAddr(aDevice, "vkCmdPushDescriptorSetKHR") != nullptr);
+}
+
+uint32_t PushDescriptorRecorder::maxPushDescriptors(VkPhysicalDevice aPhysicalDevice){
+    PFN_vkGetPhysicalDeviceProperties2 getProperties2 = get_physical_device_properties2_func(aPhysicalDevice);
+    if(getProperties2 == nullptr) return(0);
+
+    VkPhysicalDevicePushDescriptorPropertiesKHR pushProperties = {};
+    pushProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+    VkPhysicalDeviceProperties2 properties2 = {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &pushProperties;
+    getProperties2(aPhysicalDevice, &properties2);
+    return(pushProperties.maxPushDescriptors);
+}
+
+} // end namespace vkutils
@@ -0,0 +1,75 @@
+#include <vulkan/vulkan.h>
+
+/// Records descriptors straight into command buffers through VK_KHR_push_descriptor, for pipelines whose
+/// construction set names a push descriptor set in mPushDescriptorSet. No descriptor sets are allocated
+/// or updated, which suits small dispatches and draws whose bindings change every time.
+///
+/// Bindings are gathered with the builder-style setters and recorded together by push(). The gathered
+/// writes and their storage are reused between pushes, so recording allocates nothing once warmed up.
+/// A recorder is meant to be used by one thread at a time.
+class PushDescriptorRecorder
+{
+ public:
+    PushDescriptorRecorder() = default;
+
+    /// \throw std::runtime_error If VK_KHR_push_descriptor isn't enabled on `aDevice`
+    explicit PushDescriptorRecorder(VkDevice aDevice);
+
+    bool isValid() const {return(_mPushDescriptorSet != nullptr);}
+
+    /// Discards gathered bindings that haven't been pushed
+    PushDescriptorRecorder& clear();
+
+    /// Dynamic buffer types can't be pushed, nor can types that don't match the setter.
+    /// \throw std::runtime_error If `aType` doesn't match the setter
+    PushDescriptorRecorder& buffer(uint32_t aBinding, VkDescriptorType aType, VkBuffer aBuffer, VkDeviceSize aOffset = 0, VkDeviceSize aRange = VK_WHOLE_SIZE, uint32_t aArrayElement = 0);
+    PushDescriptorRecorder& image(uint32_t aBinding, VkDescriptorType aType, VkImageView aView, VkImageLayout aLayout, VkSampler aSampler = VK_NULL_HANDLE, uint32_t aArrayElement = 0);
+    PushDescriptorRecorder& texelBuffer(uint32_t aBinding, VkDescriptorType aType, VkBufferView aView, uint32_t aArrayElement = 0);
+
+    PushDescriptorRecorder& uniformBuffer(uint32_t aBinding, VkBuffer aBuffer, VkDeviceSize aOffset = 0, VkDeviceSize aRange = VK_WHOLE_SIZE){
+        return(buffer(aBinding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, aBuffer, aOffset, aRange));
+    }
+    PushDescriptorRecorder& storageBuffer(uint32_t aBinding, VkBuffer aBuffer, VkDeviceSize aOffset = 0, VkDeviceSize aRange = VK_WHOLE_SIZE){
+        return(buffer(aBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, aBuffer, aOffset, aRange));
+    }
+    PushDescriptorRecorder& sampledImage(uint32_t aBinding, VkImageView aView, VkSampler aSampler, VkImageLayout aLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL){
+        return(image(aBinding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aView, aLayout, aSampler));
+    }
+    PushDescriptorRecorder& storageImage(uint32_t aBinding, VkImageView aView, VkImageLayout aLayout = VK_IMAGE_LAYOUT_GENERAL){
+        return(image(aBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, aView, aLayout));
+    }
+
+    /// Records the gathered bindings as set `aSet` of `aLayout`, then clears them
+    void push(VkCommandBuffer aCommandBuffer, VkPipelineBindPoint aBindPoint, VkPipelineLayout aLayout, uint32_t aSet);
+
+    /// Records the set described by push template `aTemplate` from packed data, without gathering bindings
+    /// \throw std::runtime_error If `aTemplate` is not a push template or `aDataSize` is smaller than its data
+    void push(VkCommandBuffer aCommandBuffer, const DescriptorUpdateTemplate& aTemplate, const void* aData, size_t aDataSize) const;
+
+    template<typename DataType>
+    void push(VkCommandBuffer aCommandBuffer, const DescriptorUpdateTemplate& aTemplate, const DataType& aData) const {
+        static_assert(std::is_trivially_copyable<DataType>::value, "Descriptor data must be a plain struct of handles");
+        push(aCommandBuffer, aTemplate, &aData, sizeof(DataType));
+    }
+
+    /// True if `aDevice` was created with VK_KHR_push_descriptor enabled
+    static bool supportsPushDescriptors(VkDevice aDevice);
+
+    /// maxPushDescriptors of the device, or 0 if it can't be queried
+    static uint32_t maxPushDescriptors(VkPhysicalDevice aPhysicalDevice);
+
+ protected:
+    /// Adds a write for one descriptor. Its info pointer is filled in by push(), since the info vectors may grow.
+    /// \throw std::runtime_error If `aType` can't be pushed
+    void _addWrite(uint32_t aBinding, VkDescriptorType aType, uint32_t aArrayElement, size_t aInfoIndex);
+
+ private:
+    PFN_vkCmdPushDescriptorSetKHR _mPushDescriptorSet = nullptr;
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR _mPushDescriptorSetWithTemplate = nullptr;
+
+    std::vector<VkWriteDescriptorSet> _mWrites;
+    std::vector<size_t> _mInfoIndices;
+    std::vector<VkDescriptorBufferInfo> _mBufferInfos;
+    std::vector<VkDescriptorImageInfo> _mImageInfos;
+    std::vector<VkBufferView> _mTexelViews;
+};
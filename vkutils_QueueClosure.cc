@@ -0,0 +1,488 @@
+#include "vkutils.h"
+#include <iostream>
+
+namespace vkutils{
+
+// Number of command buffers allocated at once when a thread's pool runs dry
+constexpr uint32_t kCommandBufferAllocBatch = 4;
+
+SubmissionFuture::SubmissionFuture(VkResult aSubmitResult) : _mState(std::make_shared<SubmissionState>()) {
+    _mState->mResult = aSubmitResult;
+    _mState->mComplete = true;
+}
+
+bool SubmissionFuture::poll() const{
+    if(_mState == nullptr || _mState->mComplete) return(true);
+    std::shared_ptr<CommandBufferRecycler> recycler = _mState->mRecycler.lock();
+    if(recycler == nullptr) return(true);
+    recycler->retireCompleted();
+    return(_mState->mComplete);
+}
+
+VkResult SubmissionFuture::wait(uint64_t aTimeout) const{
+    if(_mState == nullptr) return(VK_SUCCESS);
+    if(_mState->mComplete) return(_mState->mResult);
+    if(_mState->mFlush) _mState->mFlush();
+    std::shared_ptr<CommandBufferRecycler> recycler = _mState->mRecycler.lock();
+    if(recycler == nullptr) return(_mState->mResult);
+    return(recycler->waitFor(_mState, aTimeout));
+}
+
+void SubmissionFuture::then(std::function<void()> aCallback) const{
+    std::shared_ptr<CommandBufferRecycler> recycler = _mState ? _mState->mRecycler.lock() : nullptr;
+    if(recycler == nullptr || _mState->mComplete){
+        aCallback();
+        return;
+    }
+    recycler->addCallback(_mState, std::move(aCallback));
+}
+
+CommandBufferRecycler::~CommandBufferRecycler(){
+    std::vector<VkFence> pending;
+    pending.reserve(_mInFlight.size());
+    for(const InFlightSubmission& inFlight : _mInFlight){
+        if(inFlight.mSync->mFence != VK_NULL_HANDLE){
+            pending.push_back(inFlight.mSync->mFence);
+        }else{
+            inFlight.mSync->mTimelineDispatch.wait(_mDevice, inFlight.mSync->mTimelinePoint, UINT64_MAX);
+        }
+    }
+    if(!pending.empty()){
+        vkWaitForFences(_mDevice, static_cast<uint32_t>(pending.size()), pending.data(), VK_TRUE, UINT64_MAX);
+    }
+
+    std::vector<std::function<void()>> callbacks;
+    for(InFlightSubmission& inFlight : _mInFlight){
+        for(const std::shared_ptr<SubmissionState>& state : inFlight.mStates){
+            _completeLocked(*state, callbacks);
+        }
+        for(VkSemaphore semaphore : inFlight.mPooledWaits){
+            _mSemaphorePool->release(semaphore);
+        }
+        _recycleFenceLocked(*inFlight.mSync);
+    }
+    // Fences of retired submissions whose waiters never came back to recycle them. They have signaled.
+    for(const std::shared_ptr<TrackedSync>& sync : _mWaitedSyncs){
+        _recycleFenceLocked(*sync);
+    }
+    for(std::function<void()>& callback : callbacks){
+        callback();
+    }
+
+    // Destroying a pool frees every command buffer allocated from it
+    for(auto& entry : _mThreadPools){
+        vkDestroyCommandPool(_mDevice, entry.second->mPool, nullptr);
+    }
+    for(const std::unique_ptr<ThreadCommandPool>& pool : _mOrphanedPools){
+        vkDestroyCommandPool(_mDevice, pool->mPool, nullptr);
+    }
+}
+
+CommandBufferRecycler::ThreadExitHook::~ThreadExitHook(){
+    const std::thread::id threadId = std::this_thread::get_id();
+    for(const std::weak_ptr<CommandBufferRecycler>& weakRecycler : mRecyclers){
+        if(std::shared_ptr<CommandBufferRecycler> recycler = weakRecycler.lock()){
+            recycler->_releaseThreadPool(threadId);
+        }
+    }
+}
+
+VkCommandBuffer CommandBufferRecycler::acquire(){
+    ThreadCommandPool& pool = _threadPool();
+
+    bool resetPool = false;
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        _retireCompletedLocked(callbacks);
+        if(!pool.mRetired.empty() && (pool.mOutstanding == 0 || pool.mFree.empty())){
+            // With nothing recording or pending, the whole pool can be reset in one call. Otherwise
+            // retired buffers are reset implicitly by vkBeginCommandBuffer.
+            resetPool = (pool.mOutstanding == 0);
+            pool.mFree.insert(pool.mFree.end(), pool.mRetired.begin(), pool.mRetired.end());
+            pool.mRetired.clear();
+        }
+        ++pool.mOutstanding;
+    }
+
+    for(std::function<void()>& callback : callbacks){
+        callback();
+    }
+
+    if(resetPool){
+        ASSERT_VK_SUCCESS(vkResetCommandPool(_mDevice, pool.mPool, 0));
+    }
+
+    if(pool.mFree.empty()){
+        VkCommandBufferAllocateInfo allocInfo = {};
+        {
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandBufferCount = kCommandBufferAllocBatch;
+            allocInfo.commandPool = pool.mPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        }
+
+        std::vector<VkCommandBuffer> allocated(kCommandBufferAllocBatch, VK_NULL_HANDLE);
+        VkResult result = vkAllocateCommandBuffers(_mDevice, &allocInfo, allocated.data());
+
+        std::lock_guard<std::mutex> lock(_mMutex);
+        if(result != VK_SUCCESS){
+            --pool.mOutstanding;
+            throw std::runtime_error("Failed to allocate command buffers! (" + std::string(vk_result_str(result)) + ")");
+        }
+        for(VkCommandBuffer cmdBuffer : allocated){
+            _mOwners.insert({cmdBuffer, &pool});
+        }
+        pool.mFree.insert(pool.mFree.end(), allocated.begin(), allocated.end());
+    }
+
+    VkCommandBuffer cmdBuffer = pool.mFree.back();
+    pool.mFree.pop_back();
+    return(cmdBuffer);
+}
+
+SubmissionFuture CommandBufferRecycler::track(VkCommandBuffer aCmdBuffer, VkFence aFence, const std::vector<VkSemaphore>& aWaitSemaphores){
+    std::shared_ptr<SubmissionState> state = createState();
+    track(std::vector<VkCommandBuffer>{aCmdBuffer}, aFence, aWaitSemaphores, {state});
+    return(SubmissionFuture(state));
+}
+
+void CommandBufferRecycler::track(
+    const std::vector<VkCommandBuffer>& aCmdBuffers,
+    VkFence aFence,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<std::shared_ptr<SubmissionState>>& aStates
+){
+    std::shared_ptr<TrackedSync> sync = std::make_shared<TrackedSync>();
+    sync->mFence = aFence;
+    _track(aCmdBuffers, sync, aWaitSemaphores, aStates);
+}
+
+void CommandBufferRecycler::track(
+    const std::vector<VkCommandBuffer>& aCmdBuffers,
+    const TimelinePoint& aPoint,
+    const TimelineSemaphoreDispatch& aDispatch,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<std::shared_ptr<SubmissionState>>& aStates
+){
+    std::shared_ptr<TrackedSync> sync = std::make_shared<TrackedSync>();
+    sync->mTimelinePoint = aPoint;
+    sync->mTimelineDispatch = aDispatch;
+    _track(aCmdBuffers, sync, aWaitSemaphores, aStates);
+}
+
+std::shared_ptr<SubmissionState> CommandBufferRecycler::createState(){
+    std::shared_ptr<SubmissionState> state = std::make_shared<SubmissionState>();
+    state->mRecycler = weak_from_this();
+    return(state);
+}
+
+void CommandBufferRecycler::abandon(const std::shared_ptr<SubmissionState>& aState, VkResult aResult){
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        aState->mResult = aResult;
+        _completeLocked(*aState, callbacks);
+    }
+    for(std::function<void()>& callback : callbacks){
+        callback();
+    }
+}
+
+void CommandBufferRecycler::retire(VkCommandBuffer aCmdBuffer){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _retireLocked(aCmdBuffer);
+}
+
+void CommandBufferRecycler::retireCompleted(){
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        _retireCompletedLocked(callbacks);
+    }
+    for(std::function<void()>& callback : callbacks){
+        callback();
+    }
+}
+
+VkResult CommandBufferRecycler::waitFor(const std::shared_ptr<SubmissionState>& aState, uint64_t aTimeout){
+    std::shared_ptr<TrackedSync> sync;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        if(aState->mComplete) return(aState->mResult);
+        if(aState->mSync == nullptr) return(VK_NOT_READY);
+        sync = aState->mSync;
+        // Keeps the fence from being reset and reused while this thread waits on it
+        ++sync->mWaiters;
+    }
+
+    VkResult waitResult = VK_SUCCESS;
+    if(sync->mFence != VK_NULL_HANDLE){
+        waitResult = vkWaitForFences(_mDevice, 1, &sync->mFence, VK_TRUE, aTimeout);
+    }else{
+        waitResult = sync->mTimelineDispatch.wait(_mDevice, sync->mTimelinePoint, aTimeout);
+    }
+
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        --sync->mWaiters;
+        if(waitResult == VK_SUCCESS) _retireCompletedLocked(callbacks);
+        if(sync->mRetired && sync->mWaiters == 0){
+            _recycleFenceLocked(*sync);
+            _mWaitedSyncs.erase(std::remove(_mWaitedSyncs.begin(), _mWaitedSyncs.end(), sync), _mWaitedSyncs.end());
+        }
+    }
+    for(std::function<void()>& callback : callbacks){
+        callback();
+    }
+
+    return(aState->mComplete ? aState->mResult : waitResult);
+}
+
+void CommandBufferRecycler::addCallback(const std::shared_ptr<SubmissionState>& aState, std::function<void()> aCallback){
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        if(!aState->mComplete){
+            aState->mCallbacks.push_back(std::move(aCallback));
+            return;
+        }
+    }
+    aCallback();
+}
+
+CommandBufferRecycler::ThreadCommandPool& CommandBufferRecycler::_threadPool(){
+    const std::thread::id threadId = std::this_thread::get_id();
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        auto finder = _mThreadPools.find(threadId);
+        if(finder != _mThreadPools.end()) return(*finder->second);
+    }
+
+    // Only the calling thread ever creates its own pool, so creating it outside the lock is safe
+    VkCommandPoolCreateInfo poolCreate = {};
+    {
+        poolCreate.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCreate.queueFamilyIndex = _mFamilyIdx;
+        poolCreate.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    }
+
+    std::unique_ptr<ThreadCommandPool> pool = std::make_unique<ThreadCommandPool>();
+    if(vkCreateCommandPool(_mDevice, &poolCreate, nullptr, &pool->mPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create transient command pool!");
+    }
+
+    // Releases the pool when this thread exits, before another thread can be given the same id
+    static thread_local ThreadExitHook tExitHook;
+    tExitHook.mRecyclers.erase(
+        std::remove_if(tExitHook.mRecyclers.begin(), tExitHook.mRecyclers.end(), [](const std::weak_ptr<CommandBufferRecycler>& aRecycler){
+            return(aRecycler.expired());
+        }),
+        tExitHook.mRecyclers.end()
+    );
+    tExitHook.mRecyclers.push_back(weak_from_this());
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    ThreadCommandPool& poolRef = *pool;
+    _mThreadPools.insert({threadId, std::move(pool)});
+    return(poolRef);
+}
+
+void CommandBufferRecycler::_releaseThreadPool(std::thread::id aThread){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    auto finder = _mThreadPools.find(aThread);
+    if(finder == _mThreadPools.end()) return;
+
+    ThreadCommandPool& pool = *finder->second;
+    pool.mOrphaned = true;
+    _mOrphanedPools.push_back(std::move(finder->second));
+    _mThreadPools.erase(finder);
+    if(pool.mOutstanding == 0) _destroyOrphanLocked(pool);
+}
+
+void CommandBufferRecycler::_destroyOrphanLocked(ThreadCommandPool& aPool){
+    for(VkCommandBuffer cmdBuffer : aPool.mFree){
+        _mOwners.erase(cmdBuffer);
+    }
+    for(VkCommandBuffer cmdBuffer : aPool.mRetired){
+        _mOwners.erase(cmdBuffer);
+    }
+    vkDestroyCommandPool(_mDevice, aPool.mPool, nullptr);
+
+    auto finder = std::find_if(_mOrphanedPools.begin(), _mOrphanedPools.end(), [&aPool](const std::unique_ptr<ThreadCommandPool>& aOrphan){
+        return(aOrphan.get() == &aPool);
+    });
+    if(finder != _mOrphanedPools.end()) _mOrphanedPools.erase(finder);
+}
+
+void CommandBufferRecycler::_track(
+    const std::vector<VkCommandBuffer>& aCmdBuffers,
+    const std::shared_ptr<TrackedSync>& aSync,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<std::shared_ptr<SubmissionState>>& aStates
+){
+    InFlightSubmission inFlight;
+    {
+        inFlight.mCmdBuffers = aCmdBuffers;
+        inFlight.mStates = aStates;
+        inFlight.mSync = aSync;
+        for(VkSemaphore semaphore : aWaitSemaphores){
+            if(_mSemaphorePool->owns(semaphore)) inFlight.mPooledWaits.push_back(semaphore);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    for(const std::shared_ptr<SubmissionState>& state : aStates){
+        state->mSync = aSync;
+    }
+    _mInFlight.push_back(std::move(inFlight));
+}
+
+bool CommandBufferRecycler::_isSignaled(const TrackedSync& aSync) const{
+    if(aSync.mFence != VK_NULL_HANDLE) return(vkGetFenceStatus(_mDevice, aSync.mFence) == VK_SUCCESS);
+    return(aSync.mTimelineDispatch.counterValue(_mDevice, aSync.mTimelinePoint.mSemaphore) >= aSync.mTimelinePoint.mValue);
+}
+
+void CommandBufferRecycler::_retireLocked(VkCommandBuffer aCmdBuffer){
+    auto finder = _mOwners.find(aCmdBuffer);
+    if(finder == _mOwners.end()) return;
+    ThreadCommandPool& owner = *finder->second;
+    owner.mRetired.push_back(aCmdBuffer);
+    assert(owner.mOutstanding > 0);
+    --owner.mOutstanding;
+    if(owner.mOrphaned && owner.mOutstanding == 0) _destroyOrphanLocked(owner);
+}
+
+void CommandBufferRecycler::_retireCompletedLocked(std::vector<std::function<void()>>& aCallbacksOut){
+    size_t i = 0;
+    while(i < _mInFlight.size()){
+        InFlightSubmission& inFlight = _mInFlight[i];
+        if(_isSignaled(*inFlight.mSync)){
+            for(VkCommandBuffer cmdBuffer : inFlight.mCmdBuffers){
+                _retireLocked(cmdBuffer);
+            }
+            for(const std::shared_ptr<SubmissionState>& state : inFlight.mStates){
+                _completeLocked(*state, aCallbacksOut);
+            }
+            // The waits have been consumed, so the semaphores are unsignaled and safe to hand out again
+            for(VkSemaphore semaphore : inFlight.mPooledWaits){
+                _mSemaphorePool->release(semaphore);
+            }
+            inFlight.mSync->mRetired = true;
+            if(inFlight.mSync->mWaiters == 0){
+                _recycleFenceLocked(*inFlight.mSync);
+            }else if(inFlight.mSync->mFence != VK_NULL_HANDLE){
+                // The last waiter recycles the fence, or the destructor if none returns
+                _mWaitedSyncs.push_back(inFlight.mSync);
+            }
+
+            if(i + 1 < _mInFlight.size()) inFlight = std::move(_mInFlight.back());
+            _mInFlight.pop_back();
+        }else{
+            ++i;
+        }
+    }
+}
+
+void CommandBufferRecycler::_completeLocked(SubmissionState& aState, std::vector<std::function<void()>>& aCallbacksOut){
+    aState.mComplete = true;
+    for(std::function<void()>& callback : aState.mCallbacks){
+        aCallbacksOut.push_back(std::move(callback));
+    }
+    aState.mCallbacks.clear();
+}
+
+void CommandBufferRecycler::_recycleFenceLocked(TrackedSync& aSync){
+    if(aSync.mFence == VK_NULL_HANDLE) return;
+    _mFencePool->release(aSync.mFence);
+    aSync.mFence = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer QueueClosure::beginOneSubmitCommands(VkCommandPool aCommandPool){
+    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+    if(aCommandPool == VK_NULL_HANDLE){
+        cmdBuffer = _mRecycler->acquire();
+    }else{
+        VkCommandBufferAllocateInfo allocInfo = {};
+        {
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandBufferCount = 1;
+            allocInfo.commandPool = aCommandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        }
+        ASSERT_VK_SUCCESS(vkAllocateCommandBuffers(_mDevicePair.device, &allocInfo, &cmdBuffer) );
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    {
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    }
+
+    ASSERT_VK_SUCCESS(vkBeginCommandBuffer(cmdBuffer, &beginInfo) );
+
+    return(cmdBuffer);
+}
+
+VkResult QueueClosure::finishOneSubmitCommands(const VkCommandBuffer& aCmdBuffer, VkFence aFence, bool aShouldWait){
+    return finishOneSubmitCommands(aCmdBuffer, {}, {}, aFence, aShouldWait);
+}
+
+VkResult QueueClosure::finishOneSubmitCommands(
+    const VkCommandBuffer& aCmdBuffer,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<VkSemaphore>& aSignalSemaphores,
+    VkFence aFence,
+    bool aShouldWait
+){
+    // A pooled fence is recycled once the work completes, so the caller can't wait on it
+    const bool pooledFence = aFence != VK_NULL_HANDLE && getFencePool()->owns(aFence);
+    SubmissionFuture future = finishOneSubmitCommandsAsync(aCmdBuffer, aWaitSemaphores, aSignalSemaphores, aFence);
+    if(aShouldWait && (aFence == VK_NULL_HANDLE || pooledFence)) return(future.wait());
+    return(future.submitResult());
+}
+
+SubmissionFuture QueueClosure::finishOneSubmitCommandsAsync(
+    const VkCommandBuffer& aCmdBuffer,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<VkSemaphore>& aSignalSemaphores,
+    VkFence aFence
+){
+    ASSERT_VK_SUCCESS(vkEndCommandBuffer(aCmdBuffer));
+
+    std::vector<VkPipelineStageFlags> waitStages(aWaitSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+    VkSubmitInfo submission = sSingleSubmitTemplate;
+    submission.commandBufferCount = 1;
+    submission.pCommandBuffers = &aCmdBuffer;
+    submission.waitSemaphoreCount = static_cast<uint32_t>(aWaitSemaphores.size());
+    submission.pWaitSemaphores = aWaitSemaphores.data();
+    submission.pWaitDstStageMask = waitStages.data();
+    submission.signalSemaphoreCount = static_cast<uint32_t>(aSignalSemaphores.size());
+    submission.pSignalSemaphores = aSignalSemaphores.data();
+
+    // A fence from the pool is handed over by the caller, so it tracks the submission itself
+    const bool pooledFence = aFence != VK_NULL_HANDLE && getFencePool()->owns(aFence);
+    VkFence trackingFence = pooledFence ? aFence : _mRecycler->acquireFence();
+    VkResult submitResult = vkQueueSubmit(mQueue, 1, &submission, aFence != VK_NULL_HANDLE ? aFence : trackingFence);
+    if(submitResult != VK_SUCCESS){
+        _mRecycler->releaseFence(trackingFence);
+        _mRecycler->retire(aCmdBuffer);
+        return(SubmissionFuture(submitResult));
+    }
+
+    if(aFence != VK_NULL_HANDLE && !pooledFence){
+        // The caller's fence may be reset or destroyed at any time, so completion is tracked with
+        // an internal fence attached to an empty submission ordered after the real one.
+        if(vkQueueSubmit(mQueue, 0, nullptr, trackingFence) != VK_SUCCESS){
+            vkQueueWaitIdle(mQueue);
+            _mRecycler->releaseFence(trackingFence);
+            _mRecycler->retire(aCmdBuffer);
+            return(SubmissionFuture(submitResult));
+        }
+    }
+
+    return(_mRecycler->track(aCmdBuffer, trackingFence, aWaitSemaphores));
+}
+
+} // end namespace vkutils
@@ -0,0 +1,281 @@
+#include <vulkan/vulkan.h>
+
+class CommandBufferRecycler;
+
+/// Fence or timeline point guarding a tracked vkQueueSubmit. Shared by the states of every
+/// submission it covers. Guarded by the owning recycler's mutex.
+struct TrackedSync
+{
+    VkFence mFence = VK_NULL_HANDLE;
+    TimelinePoint mTimelinePoint;
+    TimelineSemaphoreDispatch mTimelineDispatch;
+
+    uint32_t mWaiters = 0;
+    bool mRetired = false;
+};
+
+/// Completion state shared between a tracked submission and the futures referring to it
+struct SubmissionState
+{
+    VkResult mResult = VK_SUCCESS;
+    std::atomic<bool> mComplete = {false};
+
+    // Guarded by the owning recycler's mutex. mSync is null until the work reaches the queue.
+    std::shared_ptr<TrackedSync> mSync;
+    std::vector<std::function<void()>> mCallbacks;
+
+    std::weak_ptr<CommandBufferRecycler> mRecycler;
+
+    // Hands the work to the queue if something like a SubmitBatcher still holds it back. Set before
+    // the state is shared and never changed afterwards.
+    std::function<void()> mFlush;
+};
+
+/// Lightweight handle to the completion of a single submission.
+///
+/// Futures are cheap to copy. A default constructed future refers to no submission and is
+/// treated as already complete. Completion is detected lazily whenever a future is polled or
+/// waited on, or when the owning QueueClosure begins new work.
+class SubmissionFuture
+{
+ public:
+    SubmissionFuture() = default;
+
+    /// Creates an already completed future carrying `aSubmitResult`
+    explicit SubmissionFuture(VkResult aSubmitResult);
+
+    bool valid() const {return(_mState != nullptr);}
+
+    /// Result of the vkQueueSubmit call itself. VK_SUCCESS until the submission is known to have failed.
+    VkResult submitResult() const {return(_mState && _mState->mComplete ? _mState->mResult : VK_SUCCESS);}
+
+    /// Returns true once the submission has finished executing. Never blocks.
+    bool poll() const;
+
+    /// Blocks until the submission finishes executing or `aTimeout` nanoseconds pass. Work still held
+    /// back by a SubmitBatcher is flushed first.
+    /// \returns The submission's result once complete, VK_NOT_READY if the work has not been handed
+    ///          to the queue yet (e.g. its SubmitBatcher is gone), otherwise VK_TIMEOUT or the error
+    ///          from the wait.
+    VkResult wait(uint64_t aTimeout = UINT64_MAX) const;
+
+    /// Registers a callback invoked once the submission finishes executing. Callbacks run on whichever
+    /// thread observes completion, or immediately on the calling thread if already complete.
+    void then(std::function<void()> aCallback) const;
+
+ protected:
+    friend class CommandBufferRecycler;
+    friend class SubmitBatcher;
+    friend class QueueSubmissionService;
+    explicit SubmissionFuture(std::shared_ptr<SubmissionState> aState) : _mState(std::move(aState)) {}
+
+ private:
+    std::shared_ptr<SubmissionState> _mState;
+};
+
+/// Hands out primary command buffers from persistent, per-thread transient command pools.
+///
+/// Each thread that records commands gets its own pool, so recording never contends on a
+/// pool lock. A thread's pool is given back when the thread exits, and destroyed once its last
+/// submitted buffer retires. Buffers are tracked until the fence guarding their submission signals. Once
+/// every buffer from a pool has retired, the whole pool is reset in one call and its
+/// buffers are reused. Buffers that retire while the pool is still busy are reused
+/// individually instead.
+///
+/// Tracking fences come from the device's FencePool. Pooled semaphores waited on by a tracked
+/// submission are returned to the device's SemaphorePool once it completes.
+class CommandBufferRecycler : public std::enable_shared_from_this<CommandBufferRecycler>
+{
+ public:
+    CommandBufferRecycler(VkDevice aDevice, uint32_t aFamilyIdx)
+    : _mDevice(aDevice), _mFamilyIdx(aFamilyIdx),
+      _mFencePool(FencePool::forDevice(aDevice)), _mSemaphorePool(SemaphorePool::forDevice(aDevice)) {}
+    ~CommandBufferRecycler();
+
+    CommandBufferRecycler(const CommandBufferRecycler&) = delete;
+    CommandBufferRecycler& operator=(const CommandBufferRecycler&) = delete;
+
+    /// Returns a command buffer from the calling thread's pool that is ready to begin recording.
+    VkCommandBuffer acquire();
+
+    /// Tracks a submitted command buffer until `aFence` signals. The fence must be one obtained
+    /// from acquireFence(), and is recycled once the submission completes. Command buffers not
+    /// handed out by this recycler are tracked for completion only.
+    /// \param aWaitSemaphores Semaphores the submission waits on. Those owned by the device's
+    ///                        SemaphorePool are released to it once the submission completes.
+    SubmissionFuture track(VkCommandBuffer aCmdBuffer, VkFence aFence, const std::vector<VkSemaphore>& aWaitSemaphores = {});
+
+    /// Tracks several command buffers submitted together under a single fence, completing every
+    /// state in `aStates` once it signals. The states must come from createState().
+    void track(
+        const std::vector<VkCommandBuffer>& aCmdBuffers,
+        VkFence aFence,
+        const std::vector<VkSemaphore>& aWaitSemaphores,
+        const std::vector<std::shared_ptr<SubmissionState>>& aStates
+    );
+
+    /// Tracks several command buffers until `aPoint` is reached on its timeline semaphore, completing
+    /// every state in `aStates` once it is. The states must come from createState().
+    void track(
+        const std::vector<VkCommandBuffer>& aCmdBuffers,
+        const TimelinePoint& aPoint,
+        const TimelineSemaphoreDispatch& aDispatch,
+        const std::vector<VkSemaphore>& aWaitSemaphores,
+        const std::vector<std::shared_ptr<SubmissionState>>& aStates
+    );
+
+    /// Creates completion state for work that has not been submitted yet
+    std::shared_ptr<SubmissionState> createState();
+
+    /// Completes `aState` with `aResult` for work that never reached the queue
+    void abandon(const std::shared_ptr<SubmissionState>& aState, VkResult aResult);
+
+    /// Immediately returns a command buffer that is not pending execution
+    void retire(VkCommandBuffer aCmdBuffer);
+
+    /// Polls tracked submissions, retiring any whose fence has signaled
+    void retireCompleted();
+
+    /// Blocks until the submission behind `aState` completes or `aTimeout` nanoseconds pass
+    VkResult waitFor(const std::shared_ptr<SubmissionState>& aState, uint64_t aTimeout);
+
+    /// Registers `aCallback` to run when the submission behind `aState` completes
+    void addCallback(const std::shared_ptr<SubmissionState>& aState, std::function<void()> aCallback);
+
+    /// Returns an unsignaled fence for tracking a submission
+    VkFence acquireFence() {return(_mFencePool->acquire());}
+
+    /// Returns a fence from acquireFence() that ended up unused
+    void releaseFence(VkFence aFence) {_mFencePool->release(aFence);}
+
+    const std::shared_ptr<FencePool>& getFencePool() const {return(_mFencePool);}
+    const std::shared_ptr<SemaphorePool>& getSemaphorePool() const {return(_mSemaphorePool);}
+
+ protected:
+    struct ThreadCommandPool
+    {
+        VkCommandPool mPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> mFree; // Only touched by the owning thread
+        std::vector<VkCommandBuffer> mRetired;
+        size_t mOutstanding = 0;
+        bool mOrphaned = false; // Its thread has exited
+    };
+
+    /// Gives the exiting thread's pools back to their recyclers
+    struct ThreadExitHook
+    {
+        std::vector<std::weak_ptr<CommandBufferRecycler>> mRecyclers;
+        ~ThreadExitHook();
+    };
+
+    struct InFlightSubmission
+    {
+        std::vector<VkCommandBuffer> mCmdBuffers;
+        std::vector<std::shared_ptr<SubmissionState>> mStates;
+        std::shared_ptr<TrackedSync> mSync;
+        std::vector<VkSemaphore> mPooledWaits;
+    };
+
+    ThreadCommandPool& _threadPool();
+    void _releaseThreadPool(std::thread::id aThread);
+    void _destroyOrphanLocked(ThreadCommandPool& aPool);
+    void _track(
+        const std::vector<VkCommandBuffer>& aCmdBuffers,
+        const std::shared_ptr<TrackedSync>& aSync,
+        const std::vector<VkSemaphore>& aWaitSemaphores,
+        const std::vector<std::shared_ptr<SubmissionState>>& aStates
+    );
+    bool _isSignaled(const TrackedSync& aSync) const;
+    void _retireLocked(VkCommandBuffer aCmdBuffer);
+    void _retireCompletedLocked(std::vector<std::function<void()>>& aCallbacksOut);
+    void _completeLocked(SubmissionState& aState, std::vector<std::function<void()>>& aCallbacksOut);
+    void _recycleFenceLocked(TrackedSync& aSync);
+
+    VkDevice _mDevice = VK_NULL_HANDLE;
+    uint32_t _mFamilyIdx;
+
+    mutable std::mutex _mMutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadCommandPool>> _mThreadPools;
+    // Pools of exited threads with buffers still outstanding
+    std::vector<std::unique_ptr<ThreadCommandPool>> _mOrphanedPools;
+    std::unordered_map<VkCommandBuffer, ThreadCommandPool*> _mOwners;
+    std::vector<InFlightSubmission> _mInFlight;
+    // Retired submissions whose fence is still being waited on
+    std::vector<std::shared_ptr<TrackedSync>> _mWaitedSyncs;
+
+    std::shared_ptr<FencePool> _mFencePool;
+    std::shared_ptr<SemaphorePool> _mSemaphorePool;
+};
+
+/// Convenience wrapper for recording and submitting one-off command buffers to a queue.
+///
+/// Command buffers obtained from beginOneSubmitCommands() without an explicit pool come from a
+/// CommandBufferRecycler shared by all copies of the closure, and are recycled automatically
+/// once their submission completes. A command buffer must be finished on the thread that began it.
+///
+/// Blocking submissions wait only on their own work, never on the whole queue.
+class QueueClosure
+{
+ public:
+    QueueClosure(const VulkanDeviceHandlePair& aDevicePair, uint32_t aFamily, VkQueue aQueue)
+    : mQueue(aQueue), mFamilyIdx(aFamily), _mDevicePair(aDevicePair),
+      _mRecycler(std::make_shared<CommandBufferRecycler>(aDevicePair.device, aFamily)) {}
+
+    VkQueue getQueue() const {return(mQueue);}
+    uint32_t getFamily() const {return(mFamilyIdx);}
+    const VulkanDeviceHandlePair& getDevicePair() const {return(_mDevicePair);}
+
+    /// Pools shared by every closure on this device. Fences and semaphores passed to the finish
+    /// functions may be taken from these instead of being created per submission. Pooled fences and
+    /// wait semaphores are handed over to the closure and released back to their pool automatically.
+    const std::shared_ptr<FencePool>& getFencePool() const {return(_mRecycler->getFencePool());}
+    const std::shared_ptr<SemaphorePool>& getSemaphorePool() const {return(_mRecycler->getSemaphorePool());}
+
+    VkCommandBuffer beginOneSubmitCommands(VkCommandPool aCommandPool = VK_NULL_HANDLE);
+    VkResult finishOneSubmitCommands(const VkCommandBuffer& aCmdBuffer, VkFence aFence = VK_NULL_HANDLE, bool aShouldWait = true);
+    VkResult finishOneSubmitCommands(
+        const VkCommandBuffer& aCmdBuffer,
+        const std::vector<VkSemaphore>& aWaitSemaphores,
+        const std::vector<VkSemaphore>& aSignalSemaphores,
+        VkFence aFence = VK_NULL_HANDLE,
+        bool aShouldWait = true
+    );
+
+    /// Ends and submits `aCmdBuffer` without blocking.
+    /// \param aWaitSemaphores Semaphores to wait on. Any taken from getSemaphorePool() are released back
+    ///                        to it automatically once the submission completes.
+    /// \param aFence Optional fence to signal. The closure tracks completion independently of it. A fence
+    ///               taken from getFencePool() tracks the submission itself and is released back to the
+    ///               pool once it completes, so the caller must use the returned future, not the fence.
+    /// \returns A future that completes once the command buffer finishes executing. If submission
+    ///          fails the future is already complete and carries the error.
+    SubmissionFuture finishOneSubmitCommandsAsync(
+        const VkCommandBuffer& aCmdBuffer,
+        const std::vector<VkSemaphore>& aWaitSemaphores = {},
+        const std::vector<VkSemaphore>& aSignalSemaphores = {},
+        VkFence aFence = VK_NULL_HANDLE
+    );
+
+ protected:
+    VkQueue mQueue = VK_NULL_HANDLE;
+    uint32_t mFamilyIdx;
+
+ private:
+    friend class SubmitBatcher;
+    friend class QueueTimeline;
+    friend class QueueSubmissionService;
+    VulkanDeviceHandlePair _mDevicePair;
+    std::shared_ptr<CommandBufferRecycler> _mRecycler;
+};
+
+const static VkSubmitInfo sSingleSubmitTemplate {
+    /* sType = */ VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    /* pNext = */ nullptr,
+    /* waitSemaphoreCount = */ 0,
+    /* pWaitSemaphores = */ nullptr,
+    /* pWaitDstStageMask = */ 0,
+    /* commandBufferCount = */ 1,
+    /* pCommandBuffers = */ nullptr,
+    /* signalSemaphoreCount = */ 0,
+    /* pSignalSemaphores = */ nullptr
+};
@@ -0,0 +1,189 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+double SubmissionServiceStats::averageLatencyMicroseconds() const{
+    uint64_t handled = mSubmissions + mFailedSubmissions;
+    if(handled == 0) return(0.0);
+    return(std::chrono::duration<double, std::micro>(mTotalLatency).count() / static_cast<double>(handled));
+}
+
+double SubmissionServiceStats::submissionsPerSecond() const{
+    double seconds = std::chrono::duration<double>(mUptime).count();
+    if(seconds <= 0.0) return(0.0);
+    return(static_cast<double>(mSubmissions) / seconds);
+}
+
+QueueSubmissionService::QueueSubmissionService(const QueueClosure& aClosure, uint32_t aMaxBatchSize)
+: _mQueue(aClosure.getQueue()), _mRecycler(aClosure._mRecycler), _mMaxBatchSize(std::max(aMaxBatchSize, 1u)),
+  _mHead(&_mStub), _mTail(&_mStub), _mStartTime(std::chrono::steady_clock::now())
+{
+    _mThread = std::thread(&QueueSubmissionService::_run, this);
+}
+
+QueueSubmissionService::~QueueSubmissionService(){
+    {
+        std::lock_guard<std::mutex> lock(_mWakeMutex);
+        _mStopping = true;
+    }
+    _mWakeCondition.notify_one();
+    _mThread.join();
+
+    // Only reachable if a producer raced with destruction
+    while(PendingNode* node = _pop()){
+        _mRecycler->retire(node->mCmdBuffer);
+        _mRecycler->abandon(node->mState, VK_ERROR_UNKNOWN);
+        delete node;
+    }
+}
+
+SubmissionFuture QueueSubmissionService::submit(
+    const VkCommandBuffer& aCmdBuffer,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<VkSemaphore>& aSignalSemaphores
+){
+    ASSERT_VK_SUCCESS(vkEndCommandBuffer(aCmdBuffer));
+
+    PendingNode* node = new PendingNode();
+    {
+        node->mCmdBuffer = aCmdBuffer;
+        node->mWaitSemaphores = aWaitSemaphores;
+        node->mWaitStages.assign(aWaitSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        node->mSignalSemaphores = aSignalSemaphores;
+        node->mState = _mRecycler->createState();
+        node->mPushTime = std::chrono::steady_clock::now();
+    }
+    SubmissionFuture future(node->mState);
+
+    _push(node);
+    if(_mSleeping){
+        std::lock_guard<std::mutex> lock(_mWakeMutex);
+        _mWakeCondition.notify_one();
+    }
+    return(future);
+}
+
+SubmissionServiceStats QueueSubmissionService::stats() const{
+    SubmissionServiceStats stats;
+    {
+        stats.mSubmissions = _mSubmissions;
+        stats.mQueueSubmitCalls = _mQueueSubmitCalls;
+        stats.mFailedSubmissions = _mFailedSubmissions;
+        stats.mTotalLatency = std::chrono::nanoseconds(_mTotalLatencyNs.load());
+        stats.mMaxLatency = std::chrono::nanoseconds(_mMaxLatencyNs.load());
+        stats.mUptime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _mStartTime);
+    }
+    return(stats);
+}
+
+void QueueSubmissionService::_push(PendingNode* aNode){
+    aNode->mNext.store(nullptr, std::memory_order_relaxed);
+    PendingNode* previous = _mHead.exchange(aNode);
+    previous->mNext.store(aNode, std::memory_order_release);
+}
+
+QueueSubmissionService::PendingNode* QueueSubmissionService::_pop(){
+    PendingNode* tail = _mTail;
+    PendingNode* next = tail->mNext.load(std::memory_order_acquire);
+    if(tail == &_mStub){
+        if(next == nullptr) return(nullptr);
+        _mTail = next;
+        tail = next;
+        next = next->mNext.load(std::memory_order_acquire);
+    }
+    if(next != nullptr){
+        _mTail = next;
+        return(tail);
+    }
+
+    // `tail` is the last node. Unless a push is midway through linking, requeue the stub
+    // behind it so `tail` can be handed out.
+    if(tail != _mHead.load()) return(nullptr);
+    _push(&_mStub);
+    next = tail->mNext.load(std::memory_order_acquire);
+    if(next != nullptr){
+        _mTail = next;
+        return(tail);
+    }
+    return(nullptr);
+}
+
+void QueueSubmissionService::_run(){
+    std::vector<PendingNode*> batch;
+    batch.reserve(_mMaxBatchSize);
+    while(true){
+        while(batch.size() < _mMaxBatchSize){
+            PendingNode* node = _pop();
+            if(node == nullptr) break;
+            batch.push_back(node);
+        }
+
+        if(!batch.empty()){
+            _submitBatch(batch);
+            batch.clear();
+            continue;
+        }
+
+        if(_hasPending()){
+            // A producer is between publishing its node and linking it
+            std::this_thread::yield();
+            continue;
+        }
+        if(_mStopping) break;
+
+        std::unique_lock<std::mutex> lock(_mWakeMutex);
+        _mSleeping = true;
+        _mWakeCondition.wait(lock, [this]() -> bool {return(_mStopping || _hasPending());});
+        _mSleeping = false;
+    }
+}
+
+void QueueSubmissionService::_submitBatch(const std::vector<PendingNode*>& aBatch){
+    std::vector<VkSubmitInfo> submissions(aBatch.size(), sSingleSubmitTemplate);
+    std::vector<VkCommandBuffer> cmdBuffers;
+    std::vector<VkSemaphore> allWaits;
+    std::vector<std::shared_ptr<SubmissionState>> states;
+    cmdBuffers.reserve(aBatch.size());
+    states.reserve(aBatch.size());
+    for(size_t i = 0; i < aBatch.size(); ++i){
+        const PendingNode& node = *aBatch[i];
+        submissions[i].commandBufferCount = 1;
+        submissions[i].pCommandBuffers = &node.mCmdBuffer;
+        submissions[i].waitSemaphoreCount = static_cast<uint32_t>(node.mWaitSemaphores.size());
+        submissions[i].pWaitSemaphores = node.mWaitSemaphores.data();
+        submissions[i].pWaitDstStageMask = node.mWaitStages.data();
+        submissions[i].signalSemaphoreCount = static_cast<uint32_t>(node.mSignalSemaphores.size());
+        submissions[i].pSignalSemaphores = node.mSignalSemaphores.data();
+
+        cmdBuffers.push_back(node.mCmdBuffer);
+        allWaits.insert(allWaits.end(), node.mWaitSemaphores.begin(), node.mWaitSemaphores.end());
+        states.push_back(node.mState);
+    }
+
+    VkFence fence = _mRecycler->acquireFence();
+    VkResult result = vkQueueSubmit(_mQueue, static_cast<uint32_t>(submissions.size()), submissions.data(), fence);
+    const std::chrono::steady_clock::time_point submitTime = std::chrono::steady_clock::now();
+    ++_mQueueSubmitCalls;
+
+    if(result == VK_SUCCESS){
+        _mRecycler->track(cmdBuffers, fence, allWaits, states);
+        _mSubmissions += aBatch.size();
+    }else{
+        _mRecycler->releaseFence(fence);
+        for(size_t i = 0; i < aBatch.size(); ++i){
+            _mRecycler->retire(cmdBuffers[i]);
+            _mRecycler->abandon(states[i], result);
+        }
+        _mFailedSubmissions += aBatch.size();
+    }
+
+    for(PendingNode* node : aBatch){
+        int64_t latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(submitTime - node->mPushTime).count();
+        _mTotalLatencyNs += latencyNs;
+        // Only the owner thread writes the maximum
+        if(latencyNs > _mMaxLatencyNs.load()) _mMaxLatencyNs = latencyNs;
+        delete node;
+    }
+}
+
+} // end namespace vkutils
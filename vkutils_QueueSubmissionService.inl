@@ -0,0 +1,90 @@
+#include <vulkan/vulkan.h>
+
+/// Latency and throughput counters for a QueueSubmissionService
+struct SubmissionServiceStats
+{
+    uint64_t mSubmissions = 0;          ///< Command buffers handed to the queue
+    uint64_t mQueueSubmitCalls = 0;     ///< vkQueueSubmit calls made by the owner thread
+    uint64_t mFailedSubmissions = 0;    ///< Command buffers whose vkQueueSubmit failed
+    std::chrono::nanoseconds mTotalLatency = std::chrono::nanoseconds(0); ///< Summed time from submit() to vkQueueSubmit returning
+    std::chrono::nanoseconds mMaxLatency = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds mUptime = std::chrono::nanoseconds(0);       ///< Time since the service started
+
+    double averageLatencyMicroseconds() const;
+    double submissionsPerSecond() const;
+};
+
+/// Owns a queue on a dedicated thread so any number of threads can submit to it without a lock.
+///
+/// Producers end their command buffers and push them, along with their semaphores, onto a
+/// lock-free multi-producer single-consumer queue. The owner thread drains it and submits up to
+/// `aMaxBatchSize` entries per vkQueueSubmit. While the service runs, every submission to the
+/// queue must go through it, since VkQueue access is externally synchronized.
+///
+/// Producers only touch a mutex to wake the owner thread when it has gone idle.
+class QueueSubmissionService
+{
+ public:
+    explicit QueueSubmissionService(const QueueClosure& aClosure, uint32_t aMaxBatchSize = 64);
+
+    /// Submits everything already pushed, then stops the owner thread
+    ~QueueSubmissionService();
+
+    QueueSubmissionService(const QueueSubmissionService&) = delete;
+    QueueSubmissionService& operator=(const QueueSubmissionService&) = delete;
+
+    /// Ends `aCmdBuffer` on the calling thread and hands it to the owner thread for submission.
+    /// Wait semaphores taken from the closure's SemaphorePool are recycled once the work completes.
+    /// \returns A future for the command buffer. It reports VK_NOT_READY from wait() until the owner thread has submitted it.
+    SubmissionFuture submit(
+        const VkCommandBuffer& aCmdBuffer,
+        const std::vector<VkSemaphore>& aWaitSemaphores = {},
+        const std::vector<VkSemaphore>& aSignalSemaphores = {}
+    );
+
+    SubmissionServiceStats stats() const;
+
+ protected:
+    struct PendingNode
+    {
+        std::atomic<PendingNode*> mNext = {nullptr};
+
+        VkCommandBuffer mCmdBuffer = VK_NULL_HANDLE;
+        std::vector<VkSemaphore> mWaitSemaphores;
+        std::vector<VkPipelineStageFlags> mWaitStages;
+        std::vector<VkSemaphore> mSignalSemaphores;
+        std::shared_ptr<SubmissionState> mState;
+        std::chrono::steady_clock::time_point mPushTime;
+    };
+
+    // Intrusive MPSC queue after Dmitry Vyukov. Any thread may push; only the owner thread pops.
+    void _push(PendingNode* aNode);
+    PendingNode* _pop();
+    bool _hasPending() const {return(_mHead.load() != _mTail);}
+
+    void _run();
+    void _submitBatch(const std::vector<PendingNode*>& aBatch);
+
+ private:
+    VkQueue _mQueue = VK_NULL_HANDLE;
+    std::shared_ptr<CommandBufferRecycler> _mRecycler;
+    uint32_t _mMaxBatchSize;
+
+    PendingNode _mStub;
+    std::atomic<PendingNode*> _mHead;
+    PendingNode* _mTail;
+
+    std::atomic<bool> _mStopping = {false};
+    std::atomic<bool> _mSleeping = {false};
+    std::mutex _mWakeMutex;
+    std::condition_variable _mWakeCondition;
+
+    std::chrono::steady_clock::time_point _mStartTime;
+    std::atomic<uint64_t> _mSubmissions = {0};
+    std::atomic<uint64_t> _mQueueSubmitCalls = {0};
+    std::atomic<uint64_t> _mFailedSubmissions = {0};
+    std::atomic<int64_t> _mTotalLatencyNs = {0};
+    std::atomic<int64_t> _mMaxLatencyNs = {0};
+
+    std::thread _mThread;
+};
@@ -0,0 +1,137 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+QueueTimeline::QueueTimeline(const QueueClosure& aClosure)
+: _mClosure(aClosure), _mDispatch(TimelineSemaphoreDispatch::load(aClosure.getDevicePair().device)) {
+    if(!_mDispatch.isValid()){
+        throw std::runtime_error("Timeline semaphores are not available on this device!");
+    }
+
+    // The entry points exist whenever the device is Vulkan 1.2, whether or not the feature is supported
+    const VkPhysicalDevice physicalDevice = aClosure.getDevicePair().physicalDevice;
+    PFN_vkGetPhysicalDeviceFeatures2 getFeatures2 = get_physical_device_features2_func(physicalDevice);
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    if(getFeatures2 != nullptr){
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &timelineFeatures;
+        getFeatures2(physicalDevice, &features);
+    }
+    if(timelineFeatures.timelineSemaphore != VK_TRUE){
+        throw std::runtime_error("Attempted to create a queue timeline on a device without the timelineSemaphore feature!");
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    {
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.pNext = nullptr;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    {
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+        semaphoreInfo.flags = 0;
+    }
+
+    VkResult result = vkCreateSemaphore(_mClosure.getDevicePair().device, &semaphoreInfo, nullptr, &_mSemaphore);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create timeline semaphore! (" + std::string(vk_result_str(result)) + ")");
+    }
+}
+
+QueueTimeline::~QueueTimeline(){
+    // Everything submitted through this timeline must finish, and be retired by the closure,
+    // before the semaphore it is tracked with can be destroyed.
+    wait(_mLastSubmitted);
+    _mClosure._mRecycler->retireCompleted();
+    vkDestroySemaphore(_mClosure.getDevicePair().device, _mSemaphore, nullptr);
+}
+
+TimelinePoint QueueTimeline::submit(
+    const VkCommandBuffer& aCmdBuffer,
+    const std::vector<TimelinePoint>& aWaits,
+    const std::vector<VkSemaphore>& aBinaryWaits,
+    const std::vector<VkSemaphore>& aBinarySignals
+){
+    ASSERT_VK_SUCCESS(vkEndCommandBuffer(aCmdBuffer));
+
+    // Binary semaphores ignore their value, but the value arrays must match the semaphore arrays
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    waitSemaphores.reserve(aWaits.size() + aBinaryWaits.size());
+    waitValues.reserve(aWaits.size() + aBinaryWaits.size());
+    for(const TimelinePoint& wait : aWaits){
+        waitSemaphores.push_back(wait.mSemaphore);
+        waitValues.push_back(wait.mValue);
+    }
+    for(VkSemaphore semaphore : aBinaryWaits){
+        waitSemaphores.push_back(semaphore);
+        waitValues.push_back(0);
+    }
+    std::vector<VkPipelineStageFlags> waitStages(waitSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+    std::vector<VkSemaphore> signalSemaphores;
+    std::vector<uint64_t> signalValues;
+    signalSemaphores.reserve(aBinarySignals.size() + 1);
+    signalValues.reserve(aBinarySignals.size() + 1);
+    signalSemaphores.push_back(_mSemaphore);
+    signalValues.push_back(0);
+    for(VkSemaphore semaphore : aBinarySignals){
+        signalSemaphores.push_back(semaphore);
+        signalValues.push_back(0);
+    }
+
+    TimelinePoint signaled;
+    {
+        // Values must be signaled in increasing order, so picking a value and submitting it are one step
+        std::lock_guard<std::mutex> lock(_mSubmitMutex);
+        signaled = point(_mLastSubmitted + 1);
+        signalValues[0] = signaled.mValue;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        {
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.pNext = nullptr;
+            timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+            timelineInfo.pWaitSemaphoreValues = waitValues.data();
+            timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+            timelineInfo.pSignalSemaphoreValues = signalValues.data();
+        }
+
+        VkSubmitInfo submission = sSingleSubmitTemplate;
+        submission.pNext = &timelineInfo;
+        submission.commandBufferCount = 1;
+        submission.pCommandBuffers = &aCmdBuffer;
+        submission.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submission.pWaitSemaphores = waitSemaphores.data();
+        submission.pWaitDstStageMask = waitStages.data();
+        submission.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submission.pSignalSemaphores = signalSemaphores.data();
+
+        VkResult result = vkQueueSubmit(_mClosure.getQueue(), 1, &submission, VK_NULL_HANDLE);
+        if(result != VK_SUCCESS){
+            _mClosure._mRecycler->retire(aCmdBuffer);
+            throw std::runtime_error("Failed to submit to queue timeline! (" + std::string(vk_result_str(result)) + ")");
+        }
+        _mLastSubmitted = signaled.mValue;
+    }
+
+    const std::shared_ptr<CommandBufferRecycler>& recycler = _mClosure._mRecycler;
+    recycler->track({aCmdBuffer}, signaled, _mDispatch, aBinaryWaits, {recycler->createState()});
+    return(signaled);
+}
+
+uint64_t QueueTimeline::completedValue() const{
+    return(_mDispatch.counterValue(_mClosure.getDevicePair().device, _mSemaphore));
+}
+
+VkResult QueueTimeline::wait(uint64_t aValue, uint64_t aTimeout) const{
+    return(_mDispatch.wait(_mClosure.getDevicePair().device, point(aValue), aTimeout));
+}
+
+} // end namespace vkutils
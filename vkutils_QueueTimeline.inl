@@ -0,0 +1,64 @@
+#include <vulkan/vulkan.h>
+
+/// Monotonically increasing timeline for a single queue, backed by a timeline semaphore.
+///
+/// Every submit() signals the next value on the timeline and returns it as a TimelinePoint.
+/// Points from any queue's timeline can be passed as waits to other submissions, expressing
+/// cross-queue dependencies as (queue, value) pairs without any binary semaphores or fences.
+/// The CPU can poll or block on a point through reached() and wait().
+///
+/// Command buffers submitted through a timeline are recycled by the closure once their point
+/// is reached. The device must have been created with the timelineSemaphore feature enabled,
+/// e.g. by chaining VkPhysicalDeviceTimelineSemaphoreFeatures through createLogicalDevice().
+/// Enabled features can't be queried from a device, so construction checks that the physical
+/// device supports the feature.
+class QueueTimeline
+{
+ public:
+    /// \throw std::runtime_error If the device lacks the timelineSemaphore feature or its entry points, or the
+    ///                            semaphore can't be created
+    explicit QueueTimeline(const QueueClosure& aClosure);
+    ~QueueTimeline();
+
+    QueueTimeline(const QueueTimeline&) = delete;
+    QueueTimeline& operator=(const QueueTimeline&) = delete;
+
+    /// Ends and submits `aCmdBuffer`, signaling the next point on this timeline when it completes.
+    /// \param aWaits Points on this or other timelines that must be reached before the commands execute.
+    /// \param aBinaryWaits Binary semaphores to wait on. Pooled ones are recycled as with QueueClosure.
+    /// \param aBinarySignals Binary semaphores to signal alongside the timeline.
+    /// \returns The point reached once the command buffer finishes executing.
+    /// \throw std::runtime_error If the submission fails
+    TimelinePoint submit(
+        const VkCommandBuffer& aCmdBuffer,
+        const std::vector<TimelinePoint>& aWaits = {},
+        const std::vector<VkSemaphore>& aBinaryWaits = {},
+        const std::vector<VkSemaphore>& aBinarySignals = {}
+    );
+
+    /// Point on this timeline with the given value
+    TimelinePoint point(uint64_t aValue) const {return(TimelinePoint{_mSemaphore, aValue});}
+
+    /// Point signaled by the most recent submission
+    TimelinePoint lastSubmitted() const {return(point(_mLastSubmitted));}
+
+    /// Largest value the device has reached on this timeline
+    uint64_t completedValue() const;
+
+    bool reached(uint64_t aValue) const {return(completedValue() >= aValue);}
+
+    /// Blocks until `aValue` is reached or `aTimeout` nanoseconds pass
+    VkResult wait(uint64_t aValue, uint64_t aTimeout = UINT64_MAX) const;
+
+    VkSemaphore getSemaphore() const {return(_mSemaphore);}
+    const QueueClosure& getClosure() const {return(_mClosure);}
+    const TimelineSemaphoreDispatch& getDispatch() const {return(_mDispatch);}
+
+ private:
+    QueueClosure _mClosure;
+    TimelineSemaphoreDispatch _mDispatch;
+    VkSemaphore _mSemaphore = VK_NULL_HANDLE;
+
+    std::mutex _mSubmitMutex;
+    std::atomic<uint64_t> _mLastSubmitted = {0};
+};
@@ -0,0 +1,204 @@
+#include "vkutils.h"
+#include "VmaHost.h"
+
+namespace vkutils{
+
+VkResult ReadbackFuture::wait(uint64_t aTimeout) const{
+    if(_mSlot == nullptr) return(VK_SUCCESS);
+    return(_mSlot->mFuture.wait(aTimeout));
+}
+
+ReadbackSpan ReadbackFuture::span() const{
+    if(_mSlot == nullptr || _mSlot->mFuture.wait() != VK_SUCCESS) return(ReadbackSpan());
+
+    if(!_mSlot->mCoherent){
+        // Every copy of the future shares the slot, so only the first span() needs to invalidate
+        std::lock_guard<std::mutex> lock(_mSlot->mInvalidateMutex);
+        if(!_mSlot->mInvalidated){
+            vmaInvalidateAllocation(_mSlot->mAllocator, _mSlot->mAllocation, 0, _mSlot->mSize);
+            _mSlot->mInvalidated = true;
+        }
+    }
+
+    ReadbackSpan span;
+    span.mData = _mSlot->mMapped;
+    span.mSize = _mSlot->mSize;
+    return(span);
+}
+
+ReadbackStream::ReadbackStream(const QueueClosure& aClosure, VkDeviceSize aSlotSize, uint32_t aSlotCount)
+: _mClosure(aClosure), _mAllocator(VmaHost::getAllocator(aClosure.getDevicePair())), _mSlotSize(std::max<VkDeviceSize>(aSlotSize, 1))
+{
+    for(uint32_t i = 0; i < std::max(aSlotCount, 1u); ++i){
+        _mSlots.emplace_back(new ReadbackSlot());
+        _createSlot(*_mSlots.back(), _mSlotSize);
+    }
+}
+
+ReadbackStream::~ReadbackStream(){
+    for(std::unique_ptr<ReadbackSlot>& slot : _mSlots){
+        if(slot->mLeased){
+            std::cerr << "Warning: ReadbackStream destroyed while a ReadbackFuture still refers to it!" << std::endl;
+        }
+        slot->mFuture.wait();
+        _destroySlot(*slot);
+    }
+}
+
+ReadbackFuture ReadbackStream::readBuffer(
+    VkBuffer aBuffer, VkDeviceSize aOffset, VkDeviceSize aSize,
+    const std::vector<VkSemaphore>& aWaitSemaphores
+){
+    auto recordCopy = [&](VkCommandBuffer aCmdBuffer, VkBuffer aSlotBuffer){
+        VkBufferCopy region = {aOffset, 0, aSize};
+        vkCmdCopyBuffer(aCmdBuffer, aBuffer, aSlotBuffer, 1, &region);
+    };
+    return(_read(aSize, aWaitSemaphores, recordCopy));
+}
+
+ReadbackFuture ReadbackStream::readImage(
+    VkImage aImage, VkImageLayout aLayout, const VkImageSubresourceLayers& aSubresource,
+    const VkOffset3D& aOffset, const VkExtent3D& aExtent, uint32_t aTexelSize,
+    const std::vector<VkSemaphore>& aWaitSemaphores
+){
+    VkDeviceSize size = VkDeviceSize(aTexelSize) * aExtent.width * aExtent.height * aExtent.depth * aSubresource.layerCount;
+    auto recordCopy = [&](VkCommandBuffer aCmdBuffer, VkBuffer aSlotBuffer){
+        VkBufferImageCopy region = {};
+        {
+            region.bufferOffset = 0;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource = aSubresource;
+            region.imageOffset = aOffset;
+            region.imageExtent = aExtent;
+        }
+        vkCmdCopyImageToBuffer(aCmdBuffer, aImage, aLayout, aSlotBuffer, 1, &region);
+    };
+    return(_read(size, aWaitSemaphores, recordCopy));
+}
+
+ReadbackStats ReadbackStream::stats() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_mStats);
+}
+
+ReadbackFuture ReadbackStream::_read(VkDeviceSize aSize, const std::vector<VkSemaphore>& aWaitSemaphores, const RecordFunc& aRecordCopy){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    std::shared_ptr<ReadbackSlot> slot = _leaseSlotLocked(aSize);
+
+    VkCommandBuffer cmdBuffer = _mClosure.beginOneSubmitCommands();
+
+    VkMemoryBarrier barrier = {};
+    {
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    aRecordCopy(cmdBuffer, slot->mBuffer);
+
+    // Make the copy visible to the host once the fence signals
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    slot->mFuture = _mClosure.finishOneSubmitCommandsAsync(cmdBuffer, aWaitSemaphores);
+    VkResult result = slot->mFuture.submitResult();
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to submit readback! (" + std::string(vk_result_str(result)) + ")");
+    }
+
+    ++_mStats.mReadbacks;
+    _mStats.mBytesRead += aSize;
+    return(ReadbackFuture(slot));
+}
+
+std::shared_ptr<ReadbackSlot> ReadbackStream::_leaseSlotLocked(VkDeviceSize aSize){
+    // Least recently used first: an idle slot, else one still being copied into, else a new one
+    std::deque<std::unique_ptr<ReadbackSlot>>::iterator chosen = _mSlots.end();
+    std::deque<std::unique_ptr<ReadbackSlot>>::iterator busy = _mSlots.end();
+    for(auto iter = _mSlots.begin(); iter != _mSlots.end(); ++iter){
+        if((*iter)->mLeased) continue;
+        if((*iter)->mFuture.poll()){
+            chosen = iter;
+            break;
+        }
+        if(busy == _mSlots.end()) busy = iter;
+    }
+
+    if(chosen == _mSlots.end() && busy != _mSlots.end()){
+        ++_mStats.mStalls;
+        (*busy)->mFuture.wait();
+        chosen = busy;
+    }
+
+    std::unique_ptr<ReadbackSlot> slot;
+    if(chosen != _mSlots.end()){
+        slot = std::move(*chosen);
+        _mSlots.erase(chosen);
+        if(slot->mCapacity < aSize){
+            _destroySlot(*slot);
+            _createSlot(*slot, aSize);
+        }
+    }else{
+        slot.reset(new ReadbackSlot());
+        _createSlot(*slot, std::max(aSize, _mSlotSize));
+    }
+
+    slot->mSize = aSize;
+    slot->mFuture = SubmissionFuture();
+    slot->mInvalidated = false;
+    slot->mLeased = true;
+
+    // The lease only marks the slot free again; the stream keeps ownership
+    std::shared_ptr<ReadbackSlot> lease(slot.get(), [](ReadbackSlot* aSlot){aSlot->mLeased = false;});
+    _mSlots.push_back(std::move(slot));
+    return(lease);
+}
+
+void ReadbackStream::_createSlot(ReadbackSlot& aSlot, VkDeviceSize aSize){
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = nullptr;
+        bufferInfo.flags = 0;
+        bufferInfo.size = aSize;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    {
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        // Uncached host reads are very slow; prefer cached memory even if it needs invalidating
+        allocInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    }
+
+    VmaAllocationInfo allocation = {};
+    VkResult result = vmaCreateBuffer(_mAllocator, &bufferInfo, &allocInfo, &aSlot.mBuffer, &aSlot.mAllocation, &allocation);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create readback buffer! (" + std::string(vk_result_str(result)) + ")");
+    }
+
+    VkMemoryPropertyFlags memoryFlags = 0;
+    vmaGetMemoryTypeProperties(_mAllocator, allocation.memoryType, &memoryFlags);
+
+    aSlot.mAllocator = _mAllocator;
+    aSlot.mMapped = static_cast<const uint8_t*>(allocation.pMappedData);
+    aSlot.mCapacity = aSize;
+    aSlot.mCoherent = (memoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    ++_mStats.mSlotsCreated;
+}
+
+void ReadbackStream::_destroySlot(ReadbackSlot& aSlot){
+    vmaDestroyBuffer(_mAllocator, aSlot.mBuffer, aSlot.mAllocation);
+    aSlot.mBuffer = VK_NULL_HANDLE;
+    aSlot.mAllocation = nullptr;
+    aSlot.mMapped = nullptr;
+    aSlot.mCapacity = 0;
+}
+
+} // end namespace vkutils
@@ -0,0 +1,136 @@
+#include <vulkan/vulkan.h>
+
+/// Read-only view of data copied back from the device
+struct ReadbackSpan
+{
+    const void* mData = nullptr;
+    VkDeviceSize mSize = 0;
+
+    bool empty() const {return(mData == nullptr || mSize == 0);}
+
+    template<typename T>
+    const T* as() const {return(static_cast<const T*>(mData));}
+};
+
+/// Host-visible buffer a ReadbackStream copies into. Guarded by the owning stream's mutex while unleased.
+struct ReadbackSlot
+{
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    VmaAllocator mAllocator = nullptr;
+    VmaAllocation mAllocation = nullptr;
+    const uint8_t* mMapped = nullptr;
+    VkDeviceSize mCapacity = 0;
+    bool mCoherent = false;
+
+    // Readback currently using the slot
+    VkDeviceSize mSize = 0;
+    SubmissionFuture mFuture;
+
+    // Set while a ReadbackFuture refers to the slot
+    std::atomic<bool> mLeased = {false};
+
+    std::mutex mInvalidateMutex;
+    bool mInvalidated = false;
+};
+
+/// Handle to data being copied back from the device.
+///
+/// Futures are cheap to copy. The slot holding the data stays reserved until every copy of the
+/// future is destroyed or released, after which spans obtained from it must no longer be read.
+/// The ReadbackStream that created a future must outlive it.
+class ReadbackFuture
+{
+ public:
+    ReadbackFuture() = default;
+
+    bool valid() const {return(_mSlot != nullptr);}
+
+    /// Returns true once the copy has finished executing. Never blocks.
+    bool poll() const {return(_mSlot == nullptr || _mSlot->mFuture.poll());}
+
+    /// Blocks until the copy finishes executing or `aTimeout` nanoseconds pass
+    VkResult wait(uint64_t aTimeout = UINT64_MAX) const;
+
+    /// Blocks until the copy finishes, then returns the mapped data, invalidated if the memory is
+    /// not host coherent. Returns an empty span if the readback failed.
+    ReadbackSpan span() const;
+
+    /// Gives up this future's hold on the slot
+    void release() {_mSlot.reset();}
+
+ protected:
+    friend class ReadbackStream;
+    explicit ReadbackFuture(std::shared_ptr<ReadbackSlot> aSlot) : _mSlot(std::move(aSlot)) {}
+
+ private:
+    std::shared_ptr<ReadbackSlot> _mSlot;
+};
+
+/// Counters for a ReadbackStream
+struct ReadbackStats
+{
+    uint64_t mReadbacks = 0;
+    uint64_t mBytesRead = 0;
+    uint64_t mStalls = 0;       ///< Readbacks that had to wait for a slot's previous copy to finish
+    uint64_t mSlotsCreated = 0; ///< Slots allocated, including those grown beyond the initial count
+};
+
+/// Streams data from the device back to the host through N-buffered, host-cached allocations.
+///
+/// Each readback records a copy into a free slot, submits it through the QueueClosure and
+/// returns immediately with a ReadbackFuture. Slots cycle in least-recently-used order, so as
+/// long as results are consumed and released within `aSlotCount` readbacks, a steady stream of
+/// readbacks never blocks. When every slot is still held by a future another one is allocated.
+///
+/// Copies are preceded by a barrier against prior writes on the same queue; work on other queues
+/// must be ordered with `aWaitSemaphores`.
+class ReadbackStream
+{
+ public:
+    /// \param aSlotSize Initial size of each slot. Slots grow when a larger readback needs them.
+    /// \throw std::runtime_error If a slot can't be allocated
+    ReadbackStream(const QueueClosure& aClosure, VkDeviceSize aSlotSize, uint32_t aSlotCount = 3);
+
+    /// Waits for every in-flight copy, then frees the slots
+    ~ReadbackStream();
+
+    ReadbackStream(const ReadbackStream&) = delete;
+    ReadbackStream& operator=(const ReadbackStream&) = delete;
+
+    /// Copies `aSize` bytes of `aBuffer` starting at `aOffset` back to the host
+    /// \throw std::runtime_error If a slot can't be allocated or the submission fails
+    ReadbackFuture readBuffer(
+        VkBuffer aBuffer, VkDeviceSize aOffset, VkDeviceSize aSize,
+        const std::vector<VkSemaphore>& aWaitSemaphores = {}
+    );
+
+    /// Copies a region of `aImage` back to the host as tightly packed texels, laid out as in ImageUploadRequest.
+    /// \param aLayout Layout the image is in; must be TRANSFER_SRC_OPTIMAL or GENERAL
+    /// \param aTexelSize Bytes per texel of the image's format
+    /// \throw std::runtime_error If a slot can't be allocated or the submission fails
+    ReadbackFuture readImage(
+        VkImage aImage, VkImageLayout aLayout, const VkImageSubresourceLayers& aSubresource,
+        const VkOffset3D& aOffset, const VkExtent3D& aExtent, uint32_t aTexelSize,
+        const std::vector<VkSemaphore>& aWaitSemaphores = {}
+    );
+
+    ReadbackStats stats() const;
+
+ protected:
+    std::shared_ptr<ReadbackSlot> _leaseSlotLocked(VkDeviceSize aSize);
+    void _createSlot(ReadbackSlot& aSlot, VkDeviceSize aSize);
+    void _destroySlot(ReadbackSlot& aSlot);
+
+    using RecordFunc = std::function<void(VkCommandBuffer, VkBuffer)>;
+    ReadbackFuture _read(VkDeviceSize aSize, const std::vector<VkSemaphore>& aWaitSemaphores, const RecordFunc& aRecordCopy);
+
+ private:
+    QueueClosure _mClosure;
+    VmaAllocator _mAllocator = nullptr;
+    VkDeviceSize _mSlotSize;
+
+    mutable std::mutex _mMutex;
+    // Least recently used first
+    std::deque<std::unique_ptr<ReadbackSlot>> _mSlots;
+    ReadbackStats _mStats;
+};
@@ -0,0 +1,110 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+CachedShaderModule::~CachedShaderModule(){
+    if(std::shared_ptr<ShaderModuleCache> cache = mCache.lock()){
+        cache->_forget(ShaderModuleCache::Key(mHash, mCodeSize));
+    }
+    vkDestroyShaderModule(mDevice, mModule, nullptr);
+}
+
+std::shared_ptr<ShaderModuleCache> ShaderModuleCache::forDevice(VkDevice aDevice){
+    static std::mutex sRegistryMutex;
+    static std::unordered_map<VkDevice, std::weak_ptr<ShaderModuleCache>> sRegistry;
+
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    // Prunes caches that have been released, including those of destroyed devices
+    for(auto iter = sRegistry.begin(); iter != sRegistry.end();){
+        if(iter->second.expired() && iter->first != aDevice) iter = sRegistry.erase(iter);
+        else ++iter;
+    }
+
+    std::shared_ptr<ShaderModuleCache> cache = sRegistry[aDevice].lock();
+    if(cache == nullptr){
+        cache = std::make_shared<ShaderModuleCache>(aDevice);
+        sRegistry[aDevice] = cache;
+    }
+    return(cache);
+}
+
+ShaderModuleRef ShaderModuleCache::get(const void* aCode, size_t aSize){
+    const Key key(hash_bytes(aCode, aSize), aSize);
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        _mStats.mBytesHashed += aSize;
+        auto finder = _mEntries.find(key);
+        if(finder != _mEntries.end()){
+            std::shared_ptr<CachedShaderModule> entry = finder->second.lock();
+            if(entry != nullptr && _matches(*entry, aCode, aSize)){
+                ++_mStats.mHits;
+                return(ShaderModuleRef(entry));
+            }
+        }
+    }
+
+    // Create outside the lock so misses on other threads aren't serialized behind the driver
+    VkShaderModule module = create_shader_module(_mDevice, aCode, aSize, true);
+    if(module == VK_NULL_HANDLE) throw std::runtime_error("Failed to create cached shader module!");
+
+    std::shared_ptr<CachedShaderModule> entry = std::make_shared<CachedShaderModule>();
+    try{
+        entry->mReflection = ShaderReflection::reflect(aCode, aSize);
+    }catch(const std::runtime_error& aError){
+        std::cerr << "Warning: Unable to reflect cached shader module: " << aError.what() << std::endl;
+    }
+    {
+        entry->mDevice = _mDevice;
+        entry->mModule = module;
+        entry->mHash = key.first;
+        entry->mCodeSize = aSize;
+        entry->mCode.assign(static_cast<const uint8_t*>(aCode), static_cast<const uint8_t*>(aCode) + aSize);
+        entry->mCache = weak_from_this();
+    }
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    std::weak_ptr<CachedShaderModule>& slot = _mEntries[key];
+    if(std::shared_ptr<CachedShaderModule> existing = slot.lock()){
+        entry->mCache.reset();
+        if(!_matches(*existing, aCode, aSize)){
+            // Different code with the same key. The live entry keeps the slot and ours goes uncached.
+            ++_mStats.mMisses;
+            return(ShaderModuleRef(entry));
+        }
+        // Another thread created the same module first. Ours is destroyed on return.
+        ++_mStats.mHits;
+        return(ShaderModuleRef(existing));
+    }
+    slot = entry;
+    ++_mStats.mMisses;
+    return(ShaderModuleRef(entry));
+}
+
+ShaderModuleRef ShaderModuleCache::load(const std::string& aPath){
+    MappedFile file(aPath);
+    return(get(file.data(), file.size()));
+}
+
+ShaderCacheStats ShaderModuleCache::stats() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    ShaderCacheStats stats = _mStats;
+    stats.mLiveModules = 0;
+    for(const auto& entry : _mEntries){
+        if(!entry.second.expired()) ++stats.mLiveModules;
+    }
+    return(stats);
+}
+
+bool ShaderModuleCache::_matches(const CachedShaderModule& aEntry, const void* aCode, size_t aSize){
+    return(aEntry.mCode.size() == aSize && (aSize == 0 || std::memcmp(aEntry.mCode.data(), aCode, aSize) == 0));
+}
+
+void ShaderModuleCache::_forget(const Key& aKey){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    auto finder = _mEntries.find(aKey);
+    if(finder != _mEntries.end() && finder->second.expired()){
+        _mEntries.erase(finder);
+    }
+}
+
+} // end namespace vkutils
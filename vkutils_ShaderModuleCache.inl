@@ -0,0 +1,103 @@
+#include <vulkan/vulkan.h>
+
+class ShaderModuleCache;
+
+/// Shader module owned by a ShaderModuleCache, destroyed once the last ShaderModuleRef to it is gone
+struct CachedShaderModule
+{
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkShaderModule mModule = VK_NULL_HANDLE;
+    uint64_t mHash = 0;
+    size_t mCodeSize = 0;
+    std::vector<uint8_t> mCode;     ///< Compared on every hit, so a hash collision can't return the wrong module
+    ShaderReflection mReflection;
+    std::weak_ptr<ShaderModuleCache> mCache;
+
+    ~CachedShaderModule();
+};
+
+/// Reference counted handle to a cached shader module
+class ShaderModuleRef
+{
+ public:
+    ShaderModuleRef() = default;
+
+    bool isValid() const {return(_mEntry != nullptr);}
+    VkShaderModule get() const {return(_mEntry ? _mEntry->mModule : VK_NULL_HANDLE);}
+    uint64_t getHash() const {return(_mEntry ? _mEntry->mHash : 0);}
+
+    /// Interface of the module's first entry point, reflected when the module was created
+    const ShaderReflection& getReflection() const {assert(isValid()); return(_mEntry->mReflection);}
+
+    operator VkShaderModule() const {return(get());}
+
+ protected:
+    friend class ShaderModuleCache;
+    explicit ShaderModuleRef(std::shared_ptr<CachedShaderModule> aEntry) : _mEntry(std::move(aEntry)) {}
+
+ private:
+    std::shared_ptr<CachedShaderModule> _mEntry;
+};
+
+/// Lookup counters for a ShaderModuleCache
+struct ShaderCacheStats
+{
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+    uint64_t mBytesHashed = 0;
+    size_t mLiveModules = 0;
+};
+
+/// Per-device cache of shader modules keyed by a hash of their SPIR-V.
+///
+/// Loading the same code any number of times, from any file, creates one VkShaderModule. Modules
+/// are reference counted through ShaderModuleRef and destroyed as soon as the last reference is
+/// released, so the cache never holds on to unused modules. Entries are keyed by the 64-bit content
+/// hash together with the code size, and a hit is only returned once the stored code matches. Code
+/// that collides with a live entry gets a module of its own that isn't cached. Each module is
+/// reflected once, when it is created. Safe to use from any thread.
+class ShaderModuleCache : public std::enable_shared_from_this<ShaderModuleCache>
+{
+ public:
+    explicit ShaderModuleCache(VkDevice aDevice) : _mDevice(aDevice) {}
+
+    ShaderModuleCache(const ShaderModuleCache&) = delete;
+    ShaderModuleCache& operator=(const ShaderModuleCache&) = delete;
+
+    /// Returns the cache shared by all users of `aDevice`, creating it if no cache for the device is alive
+    static std::shared_ptr<ShaderModuleCache> forDevice(VkDevice aDevice);
+
+    /// Returns the module for the given SPIR-V, creating it on a miss.
+    /// \param aCode SPIR-V words. Only read during the call.
+    /// \throw std::runtime_error If the module must be created and creation fails
+    ShaderModuleRef get(const void* aCode, size_t aSize);
+    ShaderModuleRef get(const std::vector<uint8_t>& aByteCode) {return(get(aByteCode.data(), aByteCode.size()));}
+
+    /// Maps the file at `aPath` and returns the module for its contents
+    /// \throw std::runtime_error If the file can't be mapped or the module can't be created
+    ShaderModuleRef load(const std::string& aPath);
+
+    ShaderCacheStats stats() const;
+
+ protected:
+    friend struct CachedShaderModule;
+
+    using Key = std::pair<uint64_t, size_t>;
+    struct KeyHash
+    {
+        size_t operator()(const Key& aKey) const noexcept {return(static_cast<size_t>(aKey.first ^ aKey.second));}
+    };
+
+    /// Whether `aEntry` was created from exactly `aCode`
+    static bool _matches(const CachedShaderModule& aEntry, const void* aCode, size_t aSize);
+
+    /// Drops the entry for `aKey` if it has expired
+    void _forget(const Key& aKey);
+
+ private:
+    VkDevice _mDevice = VK_NULL_HANDLE;
+
+    mutable std::mutex _mMutex;
+    std::unordered_map<Key, std::weak_ptr<CachedShaderModule>, KeyHash> _mEntries;
+    ShaderCacheStats _mStats;
+};
@@ -0,0 +1,557 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+namespace{
+
+constexpr uint32_t kSpirvMagic = 0x07230203;
+constexpr uint32_t kSpirvHeaderWords = 5;
+constexpr uint32_t kUnset = UINT32_MAX;
+// Universal limit on the id bound from the SPIR-V specification
+constexpr uint32_t kSpirvMaxIdBound = 0x3FFFFF;
+
+// Subset of the SPIR-V grammar the reflection needs
+enum SpirvOp : uint32_t
+{
+    OpEntryPoint = 15,
+    OpExecutionMode = 16,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeImage = 25,
+    OpTypeSampler = 26,
+    OpTypeSampledImage = 27,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpConstantComposite = 44,
+    OpSpecConstant = 50,
+    OpSpecConstantComposite = 51,
+    OpFunction = 54,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+    OpExecutionModeId = 331,
+    OpTypeAccelerationStructureKHR = 5341
+};
+
+enum SpirvDecoration : uint32_t
+{
+    DecorationSpecId = 1,
+    DecorationBlock = 2,
+    DecorationBufferBlock = 3,
+    DecorationArrayStride = 6,
+    DecorationMatrixStride = 7,
+    DecorationBuiltIn = 11,
+    DecorationBinding = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset = 35
+};
+
+enum SpirvStorageClass : uint32_t
+{
+    StorageClassUniformConstant = 0,
+    StorageClassUniform = 2,
+    StorageClassPushConstant = 9,
+    StorageClassStorageBuffer = 12
+};
+
+constexpr uint32_t kBuiltInWorkgroupSize = 25;
+constexpr uint32_t kExecutionModeLocalSize = 17;
+constexpr uint32_t kExecutionModeLocalSizeId = 38;
+constexpr uint32_t kDimBuffer = 5;
+constexpr uint32_t kDimSubpassData = 6;
+
+/// What the parser knows about one result id
+struct SpirvIdInfo
+{
+    uint32_t mOpcode = 0;
+    uint32_t mWordOffset = 0;
+    uint32_t mSet = kUnset;
+    uint32_t mBinding = kUnset;
+    uint32_t mSpecId = ShaderReflection::kNoSpecId;
+    uint32_t mArrayStride = 0;
+    uint32_t mBuiltIn = kUnset;
+    bool mBlock = false;
+    bool mBufferBlock = false;
+};
+
+struct SpirvMemberDecoration
+{
+    uint32_t mStruct;
+    uint32_t mMember;
+    uint32_t mDecoration;
+    uint32_t mValue;
+};
+
+struct SpirvEntryPoint
+{
+    uint32_t mModel;
+    uint32_t mFunction;
+    std::string mName;
+    bool mHasLocalSize = false;
+    bool mLocalSizeIsIds = false;
+    uint32_t mLocalSize[3] = {1, 1, 1};
+};
+
+class SpirvModule
+{
+ public:
+    SpirvModule(const void* aCode, size_t aSize){
+        if(aCode == nullptr || aSize % sizeof(uint32_t) != 0 || aSize < kSpirvHeaderWords * sizeof(uint32_t)){
+            throw std::runtime_error("SPIR-V code size is invalid!");
+        }
+        _mWords = static_cast<const uint32_t*>(aCode);
+        _mWordCount = aSize / sizeof(uint32_t);
+        if(_mWords[0] != kSpirvMagic) throw std::runtime_error("SPIR-V code has a bad magic number!");
+        if(_mWords[3] > kSpirvMaxIdBound) throw std::runtime_error("SPIR-V id bound exceeds the universal limit!");
+        mIds.resize(_mWords[3]);
+        _parse();
+    }
+
+    const uint32_t* instruction(uint32_t aId) const{
+        if(opcode(aId) == 0) throw std::runtime_error("SPIR-V refers to an undefined id!");
+        return(_mWords + mIds[aId].mWordOffset);
+    }
+    uint32_t opcode(uint32_t aId) const {return(aId < mIds.size() ? mIds[aId].mOpcode : 0);}
+
+    /// Value of a 32-bit scalar constant, or the default of a specialization constant
+    /// \param aWhat What the constant is used for, named in the error if it isn't a scalar constant
+    uint32_t constantValue(uint32_t aId, const char* aWhat) const{
+        uint32_t op = opcode(aId);
+        if(op != OpConstant && op != OpSpecConstant){
+            throw std::runtime_error("SPIR-V " + std::string(aWhat) + " is not a scalar constant!");
+        }
+        return(instruction(aId)[3]);
+    }
+
+    uint32_t memberDecoration(uint32_t aStruct, uint32_t aMember, uint32_t aDecoration) const{
+        for(const SpirvMemberDecoration& decoration : mMemberDecorations){
+            if(decoration.mStruct == aStruct && decoration.mMember == aMember && decoration.mDecoration == aDecoration){
+                return(decoration.mValue);
+            }
+        }
+        return(kUnset);
+    }
+
+    /// Size in bytes of a type laid out with explicit offsets and strides
+    uint32_t typeSize(uint32_t aType, uint32_t aMatrixStride = 0) const{
+        const uint32_t* inst = instruction(aType);
+        switch(opcode(aType)){
+            case OpTypeBool: return(4);
+            case OpTypeInt:
+            case OpTypeFloat: return(inst[2] / 8);
+            case OpTypeVector: return(inst[3] * typeSize(inst[2]));
+            case OpTypeMatrix: return(inst[3] * (aMatrixStride != 0 ? aMatrixStride : typeSize(inst[2])));
+            case OpTypeArray:{
+                uint32_t stride = mIds[aType].mArrayStride != 0 ? mIds[aType].mArrayStride : typeSize(inst[2], aMatrixStride);
+                return(constantValue(inst[3], "array length") * stride);
+            }
+            case OpTypeRuntimeArray: return(0);
+            case OpTypePointer: return(8);
+            case OpTypeStruct:{
+                uint32_t size = 0;
+                const uint32_t memberCount = (inst[0] >> 16) - 2;
+                for(uint32_t member = 0; member < memberCount; ++member){
+                    uint32_t offset = memberDecoration(aType, member, DecorationOffset);
+                    uint32_t matrixStride = memberDecoration(aType, member, DecorationMatrixStride);
+                    if(offset == kUnset) offset = size;
+                    size = std::max(size, offset + typeSize(inst[2 + member], matrixStride == kUnset ? 0 : matrixStride));
+                }
+                return(size);
+            }
+            default: throw std::runtime_error("SPIR-V block contains a type with no defined size!");
+        }
+    }
+
+    std::vector<SpirvIdInfo> mIds;
+    std::vector<SpirvMemberDecoration> mMemberDecorations;
+    std::vector<SpirvEntryPoint> mEntryPoints;
+    std::vector<uint32_t> mVariables;
+
+ private:
+    void _parse(){
+        for(size_t offset = kSpirvHeaderWords; offset < _mWordCount;){
+            const uint32_t* inst = _mWords + offset;
+            const uint32_t wordCount = inst[0] >> 16;
+            const uint32_t op = inst[0] & 0xFFFF;
+            if(wordCount == 0 || offset + wordCount > _mWordCount) throw std::runtime_error("SPIR-V instruction stream is truncated!");
+            if(wordCount < _minWordCount(op)) throw std::runtime_error("SPIR-V instruction has too few operands!");
+
+            // Everything reflection needs is declared before the first function
+            if(op == OpFunction) break;
+
+            switch(op){
+                case OpEntryPoint:{
+                    SpirvEntryPoint entry;
+                    entry.mModel = inst[1];
+                    entry.mFunction = inst[2];
+                    entry.mName = _string(inst + 3, wordCount - 3);
+                    mEntryPoints.push_back(entry);
+                } break;
+                case OpExecutionMode:
+                case OpExecutionModeId:{
+                    if(wordCount < 6 || (inst[2] != kExecutionModeLocalSize && inst[2] != kExecutionModeLocalSizeId)) break;
+                    for(SpirvEntryPoint& entry : mEntryPoints){
+                        if(entry.mFunction != inst[1]) continue;
+                        entry.mHasLocalSize = true;
+                        entry.mLocalSizeIsIds = inst[2] == kExecutionModeLocalSizeId;
+                        std::copy(inst + 3, inst + 6, entry.mLocalSize);
+                    }
+                } break;
+                case OpDecorate:{
+                    SpirvIdInfo& info = _info(inst[1]);
+                    // Every decoration recorded here but Block and BufferBlock carries a literal
+                    if(wordCount < 4 && inst[2] != DecorationBlock && inst[2] != DecorationBufferBlock) break;
+                    switch(inst[2]){
+                        case DecorationSpecId: info.mSpecId = inst[3]; break;
+                        case DecorationBlock: info.mBlock = true; break;
+                        case DecorationBufferBlock: info.mBufferBlock = true; break;
+                        case DecorationArrayStride: info.mArrayStride = inst[3]; break;
+                        case DecorationBuiltIn: info.mBuiltIn = inst[3]; break;
+                        case DecorationBinding: info.mBinding = inst[3]; break;
+                        case DecorationDescriptorSet: info.mSet = inst[3]; break;
+                        default: break;
+                    }
+                } break;
+                case OpMemberDecorate:{
+                    if(wordCount >= 5 && (inst[3] == DecorationOffset || inst[3] == DecorationMatrixStride)){
+                        mMemberDecorations.push_back({inst[1], inst[2], inst[3], inst[4]});
+                    }
+                } break;
+                case OpTypeBool:
+                case OpTypeInt:
+                case OpTypeFloat:
+                case OpTypeVector:
+                case OpTypeMatrix:
+                case OpTypeImage:
+                case OpTypeSampler:
+                case OpTypeSampledImage:
+                case OpTypeArray:
+                case OpTypeRuntimeArray:
+                case OpTypeStruct:
+                case OpTypePointer:
+                case OpTypeAccelerationStructureKHR:
+                    _define(inst[1], op, offset);
+                    break;
+                case OpConstant:
+                case OpConstantComposite:
+                case OpSpecConstant:
+                case OpSpecConstantComposite:
+                    _define(inst[2], op, offset);
+                    break;
+                case OpVariable:
+                    _define(inst[2], op, offset);
+                    mVariables.push_back(inst[2]);
+                    break;
+                default: break;
+            }
+            offset += wordCount;
+        }
+    }
+
+    /// Fewest words an instruction needs for the operands reflection reads from it
+    static uint32_t _minWordCount(uint32_t aOpcode){
+        switch(aOpcode){
+            case OpTypeBool:
+            case OpTypeSampler:
+            case OpTypeStruct:
+            case OpTypeAccelerationStructureKHR:
+                return(2);
+            case OpDecorate:
+            case OpTypeFloat:
+            case OpTypeSampledImage:
+            case OpTypeRuntimeArray:
+            case OpConstantComposite:
+            case OpSpecConstantComposite:
+                return(3);
+            case OpEntryPoint:
+            case OpMemberDecorate:
+            case OpTypeInt:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeArray:
+            case OpTypePointer:
+            case OpConstant:
+            case OpSpecConstant:
+            case OpVariable:
+                return(4);
+            case OpTypeImage: return(9);
+            default: return(1);
+        }
+    }
+
+    SpirvIdInfo& _info(uint32_t aId){
+        if(aId >= mIds.size()) throw std::runtime_error("SPIR-V id is out of bounds!");
+        return(mIds[aId]);
+    }
+
+    void _define(uint32_t aId, uint32_t aOpcode, size_t aOffset){
+        SpirvIdInfo& info = _info(aId);
+        info.mOpcode = aOpcode;
+        info.mWordOffset = static_cast<uint32_t>(aOffset);
+    }
+
+    static std::string _string(const uint32_t* aWords, uint32_t aWordCount){
+        const char* chars = reinterpret_cast<const char*>(aWords);
+        return(std::string(chars, strnlen(chars, aWordCount * sizeof(uint32_t))));
+    }
+
+    const uint32_t* _mWords = nullptr;
+    size_t _mWordCount = 0;
+};
+
+VkShaderStageFlagBits stage_for_model(uint32_t aExecutionModel){
+    switch(aExecutionModel){
+        case 0: return(VK_SHADER_STAGE_VERTEX_BIT);
+        case 1: return(VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT);
+        case 2: return(VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT);
+        case 3: return(VK_SHADER_STAGE_GEOMETRY_BIT);
+        case 4: return(VK_SHADER_STAGE_FRAGMENT_BIT);
+        case 5: return(VK_SHADER_STAGE_COMPUTE_BIT);
+        case 5267: case 5364: return(VK_SHADER_STAGE_TASK_BIT_NV);
+        case 5268: case 5365: return(VK_SHADER_STAGE_MESH_BIT_NV);
+        case 5313: return(VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        case 5314: return(VK_SHADER_STAGE_INTERSECTION_BIT_KHR);
+        case 5315: return(VK_SHADER_STAGE_ANY_HIT_BIT_KHR);
+        case 5316: return(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+        case 5317: return(VK_SHADER_STAGE_MISS_BIT_KHR);
+        case 5318: return(VK_SHADER_STAGE_CALLABLE_BIT_KHR);
+        default: return(VK_SHADER_STAGE_ALL);
+    }
+}
+
+/// Descriptor type of a resource variable's (array-stripped) type, or VK_DESCRIPTOR_TYPE_MAX_ENUM if it isn't one
+VkDescriptorType descriptor_type(const SpirvModule& aModule, uint32_t aType, uint32_t aStorageClass){
+    const uint32_t* inst = aModule.instruction(aType);
+    switch(aModule.opcode(aType)){
+        case OpTypeSampler: return(VK_DESCRIPTOR_TYPE_SAMPLER);
+        case OpTypeSampledImage: return(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        case OpTypeAccelerationStructureKHR: return(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR);
+        case OpTypeImage:{
+            const uint32_t dim = inst[3];
+            const uint32_t sampled = inst[7];
+            if(dim == kDimSubpassData) return(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT);
+            if(dim == kDimBuffer) return(sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER);
+            return(sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+        }
+        case OpTypeStruct:{
+            if(aStorageClass == StorageClassStorageBuffer) return(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+            if(aStorageClass == StorageClassUniform){
+                return(aModule.mIds[aType].mBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+            }
+            return(VK_DESCRIPTOR_TYPE_MAX_ENUM);
+        }
+        default: return(VK_DESCRIPTOR_TYPE_MAX_ENUM);
+    }
+}
+
+// Resolves one workgroup size component given as a constant id
+void local_size_from_id(const SpirvModule& aModule, uint32_t aId, uint32_t& aSizeOut, uint32_t& aSpecIdOut){
+    aSizeOut = aModule.constantValue(aId, "workgroup size component");
+    aSpecIdOut = aModule.mIds[aId].mSpecId;
+}
+
+bool binding_equal(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b){
+    if(a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags){
+        return(false);
+    }
+    if(a.pImmutableSamplers == nullptr || b.pImmutableSamplers == nullptr) return(a.pImmutableSamplers == b.pImmutableSamplers);
+    return(std::equal(a.pImmutableSamplers, a.pImmutableSamplers + a.descriptorCount, b.pImmutableSamplers));
+}
+
+} // end anonymous namespace
+
+ShaderReflection ShaderReflection::reflect(const void* aCode, size_t aSize, const char* aEntryPoint){
+    SpirvModule module(aCode, aSize);
+
+    auto entry = module.mEntryPoints.begin();
+    if(aEntryPoint != nullptr){
+        entry = std::find_if(module.mEntryPoints.begin(), module.mEntryPoints.end(), [aEntryPoint](const SpirvEntryPoint& aEntry){
+            return(aEntry.mName == aEntryPoint);
+        });
+    }
+    if(entry == module.mEntryPoints.end()){
+        throw std::runtime_error("SPIR-V module has no entry point named '" + std::string(aEntryPoint ? aEntryPoint : "") + "'!");
+    }
+
+    ShaderReflection reflection;
+    reflection.mStage = stage_for_model(entry->mModel);
+    reflection.mEntryPoint = entry->mName;
+
+    if(entry->mHasLocalSize){
+        for(int i = 0; i < 3; ++i){
+            if(entry->mLocalSizeIsIds){
+                local_size_from_id(module, entry->mLocalSize[i], reflection.mLocalSize[i], reflection.mLocalSizeSpecIds[i]);
+            }else{
+                reflection.mLocalSize[i] = entry->mLocalSize[i];
+            }
+        }
+    }
+
+    for(uint32_t id = 0; id < module.mIds.size(); ++id){
+        const SpirvIdInfo& info = module.mIds[id];
+        if(info.mSpecId != kNoSpecId){
+            reflection.mSpecializationConstantIds.push_back(info.mSpecId);
+        }
+        // The WorkgroupSize built-in overrides any execution mode
+        if(info.mBuiltIn == kBuiltInWorkgroupSize && (info.mOpcode == OpConstantComposite || info.mOpcode == OpSpecConstantComposite)){
+            const uint32_t* inst = module.instruction(id);
+            if((inst[0] >> 16) < 6) throw std::runtime_error("SPIR-V WorkgroupSize built-in does not have three components!");
+            for(int i = 0; i < 3; ++i){
+                local_size_from_id(module, inst[3 + i], reflection.mLocalSize[i], reflection.mLocalSizeSpecIds[i]);
+            }
+        }
+    }
+    std::sort(reflection.mSpecializationConstantIds.begin(), reflection.mSpecializationConstantIds.end());
+    reflection.mSpecializationConstantIds.erase(
+        std::unique(reflection.mSpecializationConstantIds.begin(), reflection.mSpecializationConstantIds.end()),
+        reflection.mSpecializationConstantIds.end()
+    );
+
+    for(uint32_t variable : module.mVariables){
+        const uint32_t* inst = module.instruction(variable);
+        const uint32_t storageClass = inst[3];
+        if(module.opcode(inst[1]) != OpTypePointer) continue;
+        uint32_t type = module.instruction(inst[1])[3];
+
+        if(storageClass == StorageClassPushConstant){
+            uint32_t minOffset = 0;
+            if(module.opcode(type) == OpTypeStruct){
+                const uint32_t memberCount = (module.instruction(type)[0] >> 16) - 2;
+                minOffset = UINT32_MAX;
+                for(uint32_t member = 0; member < memberCount; ++member){
+                    minOffset = std::min(minOffset, module.memberDecoration(type, member, DecorationOffset));
+                }
+                if(minOffset == kUnset) minOffset = 0;
+            }
+            const uint32_t end = (module.typeSize(type) + 3) & ~3u;
+            reflection.mPushConstants = {static_cast<VkShaderStageFlags>(reflection.mStage), minOffset, end - minOffset};
+            continue;
+        }
+
+        if(storageClass != StorageClassUniformConstant && storageClass != StorageClassUniform && storageClass != StorageClassStorageBuffer) continue;
+        const SpirvIdInfo& info = module.mIds[variable];
+        if(info.mSet == kUnset || info.mBinding == kUnset) continue;
+
+        ReflectedDescriptorBinding binding;
+        binding.mSet = info.mSet;
+        binding.mBinding = info.mBinding;
+        while(module.opcode(type) == OpTypeArray || module.opcode(type) == OpTypeRuntimeArray){
+            const uint32_t* arrayInst = module.instruction(type);
+            binding.mCount *= module.opcode(type) == OpTypeArray ? module.constantValue(arrayInst[3], "array length") : 0;
+            type = arrayInst[2];
+        }
+        binding.mType = descriptor_type(module, type, storageClass);
+        if(binding.mType != VK_DESCRIPTOR_TYPE_MAX_ENUM){
+            reflection.mBindings.push_back(binding);
+        }
+    }
+
+    return(reflection);
+}
+
+bool DescriptorSetLayoutDescription::operator==(const DescriptorSetLayoutDescription& aOther) const{
+    if(mSet != aOther.mSet || mFlags != aOther.mFlags) return(false);
+    if(!std::equal(mBindings.begin(), mBindings.end(), aOther.mBindings.begin(), aOther.mBindings.end(), binding_equal)) return(false);
+    for(size_t i = 0; i < mBindings.size(); ++i){
+        if(getBindingFlags(i) != aOther.getBindingFlags(i)) return(false);
+    }
+    return(true);
+}
+
+bool PipelineLayoutDescription::operator==(const PipelineLayoutDescription& aOther) const{
+    auto rangeEq = [](const VkPushConstantRange& lhs, const VkPushConstantRange& rhs){
+        return(lhs.stageFlags == rhs.stageFlags && lhs.offset == rhs.offset && lhs.size == rhs.size);
+    };
+    return(
+        mSetLayouts == aOther.mSetLayouts &&
+        std::equal(mPushConstantRanges.begin(), mPushConstantRanges.end(), aOther.mPushConstantRanges.begin(), aOther.mPushConstantRanges.end(), rangeEq)
+    );
+}
+
+void PipelineLayoutDescription::merge(const ShaderReflection& aReflection, uint32_t aUnsizedArrayCount){
+    const VkShaderStageFlags stage = aReflection.mStage;
+    for(const ReflectedDescriptorBinding& reflected : aReflection.mBindings){
+        while(mSetLayouts.size() <= reflected.mSet){
+            mSetLayouts.emplace_back();
+            mSetLayouts.back().mSet = static_cast<uint32_t>(mSetLayouts.size() - 1);
+        }
+
+        DescriptorSetLayoutDescription& setLayout = mSetLayouts[reflected.mSet];
+        std::vector<VkDescriptorSetLayoutBinding>& bindings = setLayout.mBindings;
+        auto finder = std::lower_bound(bindings.begin(), bindings.end(), reflected.mBinding, [](const VkDescriptorSetLayoutBinding& aBinding, uint32_t aNumber){
+            return(aBinding.binding < aNumber);
+        });
+        const uint32_t count = reflected.mCount != 0 ? reflected.mCount : aUnsizedArrayCount;
+
+        if(finder != bindings.end() && finder->binding == reflected.mBinding){
+            if(finder->descriptorType != reflected.mType){
+                throw std::runtime_error(
+                    "Descriptor set " + std::to_string(reflected.mSet) + " binding " + std::to_string(reflected.mBinding) +
+                    " is declared with different types by different shader stages!"
+                );
+            }
+            finder->stageFlags |= stage;
+            finder->descriptorCount = std::max(finder->descriptorCount, count);
+        }else{
+            VkDescriptorSetLayoutBinding binding;
+            {
+                binding.binding = reflected.mBinding;
+                binding.descriptorType = reflected.mType;
+                binding.descriptorCount = count;
+                binding.stageFlags = stage;
+                binding.pImmutableSamplers = nullptr;
+            }
+            if(!setLayout.mBindingFlags.empty()){
+                setLayout.mBindingFlags.insert(setLayout.mBindingFlags.begin() + (finder - bindings.begin()), 0);
+            }
+            bindings.insert(finder, binding);
+        }
+    }
+
+    if(aReflection.hasPushConstants()){
+        const VkPushConstantRange& block = aReflection.mPushConstants;
+        auto finder = std::find_if(mPushConstantRanges.begin(), mPushConstantRanges.end(), [&block](const VkPushConstantRange& aRange){
+            return(aRange.offset == block.offset && aRange.size == block.size);
+        });
+        if(finder != mPushConstantRanges.end()){
+            finder->stageFlags |= stage;
+        }else{
+            mPushConstantRanges.push_back({stage, block.offset, block.size});
+        }
+    }
+}
+
+void PipelineLayoutDescription::replaceSet(uint32_t aSet, const DescriptorSetLayoutDescription& aSetLayout){
+    while(mSetLayouts.size() <= aSet){
+        mSetLayouts.emplace_back();
+        mSetLayouts.back().mSet = static_cast<uint32_t>(mSetLayouts.size() - 1);
+    }
+    mSetLayouts[aSet] = aSetLayout;
+    mSetLayouts[aSet].mSet = aSet;
+}
+
+PipelineLayoutDescription PipelineLayoutDescription::withPushDescriptorSet(uint32_t aSet) const{
+    PipelineLayoutDescription description = *this;
+    if(aSet == kNoPushDescriptorSet) return(description);
+    if(aSet >= mSetLayouts.size()){
+        throw std::runtime_error("Push descriptor set " + std::to_string(aSet) + " is not part of the pipeline layout description");
+    }
+    description.mSetLayouts[aSet].mFlags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+    return(description);
+}
+
+PipelineLayoutDescription PipelineLayoutDescription::fromReflection(const std::vector<ShaderReflection>& aStages, uint32_t aUnsizedArrayCount){
+    PipelineLayoutDescription description;
+    for(const ShaderReflection& stage : aStages){
+        description.merge(stage, aUnsizedArrayCount);
+    }
+    return(description);
+}
+
+} // end namespace vkutils
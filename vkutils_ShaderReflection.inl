@@ -0,0 +1,93 @@
+#include <vulkan/vulkan.h>
+
+/// A descriptor declared by a shader module
+struct ReflectedDescriptorBinding
+{
+    uint32_t mSet = 0;
+    uint32_t mBinding = 0;
+    VkDescriptorType mType = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    uint32_t mCount = 1; ///< Array size. Zero for runtime sized arrays.
+};
+
+/// Resource interface of one entry point of a SPIR-V module, extracted by a single pass over the code.
+///
+/// Descriptors and push constants are collected from every variable in the module rather than only
+/// those the entry point statically uses, so the result is a superset for modules with several entry points.
+struct ShaderReflection
+{
+    static constexpr uint32_t kNoSpecId = UINT32_MAX;
+
+    VkShaderStageFlagBits mStage = VK_SHADER_STAGE_ALL;
+    std::string mEntryPoint;
+
+    std::vector<ReflectedDescriptorBinding> mBindings;
+
+    /// Push constant block of the module. Size is zero if there is none.
+    VkPushConstantRange mPushConstants = {0, 0, 0};
+
+    /// Every SpecId declared in the module, in ascending order
+    std::vector<uint32_t> mSpecializationConstantIds;
+
+    /// Workgroup size of compute, task and mesh shaders. For dimensions that are specialization
+    /// constants, the default value is given here and the constant's id in mLocalSizeSpecIds.
+    uint32_t mLocalSize[3] = {1, 1, 1};
+    uint32_t mLocalSizeSpecIds[3] = {kNoSpecId, kNoSpecId, kNoSpecId};
+
+    bool hasPushConstants() const {return(mPushConstants.size != 0);}
+
+    /// Parses the SPIR-V in `aCode`.
+    /// \param aEntryPoint Name of the entry point to describe. The first one is used if null.
+    /// \throw std::runtime_error If the code is not valid SPIR-V or the entry point doesn't exist
+    static ShaderReflection reflect(const void* aCode, size_t aSize, const char* aEntryPoint = nullptr);
+    static ShaderReflection reflect(const std::vector<uint8_t>& aByteCode, const char* aEntryPoint = nullptr){
+        return(reflect(aByteCode.data(), aByteCode.size(), aEntryPoint));
+    }
+};
+
+/// Contents of a descriptor set layout, independent of any device
+struct DescriptorSetLayoutDescription
+{
+    uint32_t mSet = 0;
+    VkDescriptorSetLayoutCreateFlags mFlags = 0;
+    std::vector<VkDescriptorSetLayoutBinding> mBindings; ///< Sorted by binding number
+
+    /// Flags for each entry of mBindings, such as VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT. May be
+    /// empty when no binding has flags.
+    std::vector<VkDescriptorBindingFlags> mBindingFlags;
+
+    VkDescriptorBindingFlags getBindingFlags(size_t aIndex) const {return(aIndex < mBindingFlags.size() ? mBindingFlags[aIndex] : 0);}
+
+    bool operator==(const DescriptorSetLayoutDescription& aOther) const;
+    bool operator!=(const DescriptorSetLayoutDescription& aOther) const {return(!(*this == aOther));}
+};
+
+/// Contents of a pipeline layout, independent of any device
+struct PipelineLayoutDescription
+{
+    static constexpr uint32_t kNoPushDescriptorSet = UINT32_MAX;
+
+    /// One entry per set number, so mSetLayouts[i].mSet == i. Sets no shader uses are left empty.
+    std::vector<DescriptorSetLayoutDescription> mSetLayouts;
+    std::vector<VkPushConstantRange> mPushConstantRanges;
+
+    bool empty() const {return(mSetLayouts.empty() && mPushConstantRanges.empty());}
+
+    /// Adds the resources of one shader stage. Bindings used by several stages are merged, taking the
+    /// largest array size.
+    /// \param aUnsizedArrayCount Descriptor count given to runtime sized arrays
+    /// \throw std::runtime_error If a binding is declared with different descriptor types by different stages
+    void merge(const ShaderReflection& aReflection, uint32_t aUnsizedArrayCount = 1);
+
+    /// Makes `aSetLayout` set number `aSet`, replacing whatever that set held and adding empty sets before it as needed
+    void replaceSet(uint32_t aSet, const DescriptorSetLayoutDescription& aSetLayout);
+
+    /// Copy of the description with set `aSet` flagged VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR.
+    /// An unmodified copy for kNoPushDescriptorSet.
+    /// \throw std::runtime_error If `aSet` is not part of the description
+    PipelineLayoutDescription withPushDescriptorSet(uint32_t aSet) const;
+
+    static PipelineLayoutDescription fromReflection(const std::vector<ShaderReflection>& aStages, uint32_t aUnsizedArrayCount = 1);
+
+    bool operator==(const PipelineLayoutDescription& aOther) const;
+    bool operator!=(const PipelineLayoutDescription& aOther) const {return(!(*this == aOther));}
+};
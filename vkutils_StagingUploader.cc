@@ -0,0 +1,287 @@
+#include "vkutils.h"
+#include "VmaHost.h"
+
+namespace vkutils{
+
+bool UploadTicket::poll() const{
+    if(_mTimeline != nullptr) return(_mTimeline->reached(_mValue));
+    return(_mFuture.poll());
+}
+
+VkResult UploadTicket::wait(uint64_t aTimeout) const{
+    if(_mTimeline != nullptr) return(_mTimeline->wait(_mValue, aTimeout));
+    return(_mFuture.wait(aTimeout));
+}
+
+double StagingUploadStats::throughputMegabytesPerSecond() const{
+    double seconds = std::chrono::duration<double>(mElapsed).count();
+    if(seconds <= 0.0) return(0.0);
+    return(static_cast<double>(mBytesUploaded) / (1024.0 * 1024.0) / seconds);
+}
+
+StagingUploader::StagingUploader(const QueueClosure& aClosure, VkDeviceSize aCapacity)
+: _mClosure(aClosure) {
+    _createRing(aCapacity);
+}
+
+StagingUploader::StagingUploader(QueueTimeline& aTimeline, VkDeviceSize aCapacity)
+: _mClosure(aTimeline.getClosure()), _mTimeline(&aTimeline) {
+    _createRing(aCapacity);
+}
+
+StagingUploader::~StagingUploader(){
+    for(const InFlightBatch& batch : _mInFlight){
+        batch.mTicket.wait();
+    }
+    _mInFlight.clear();
+    vmaDestroyBuffer(_mAllocator, _mBuffer, _mAllocation);
+}
+
+void StagingUploader::_createRing(VkDeviceSize aCapacity){
+    if(aCapacity == 0) throw std::runtime_error("Attempted to create a staging ring with no capacity!");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_mClosure.getDevicePair().physicalDevice, &properties);
+    _mCopyAlignment = std::max<VkDeviceSize>(properties.limits.optimalBufferCopyOffsetAlignment, 1);
+
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = nullptr;
+        bufferInfo.flags = 0;
+        bufferInfo.size = aCapacity;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    {
+        allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    }
+
+    _mAllocator = VmaHost::getAllocator(_mClosure.getDevicePair());
+    VmaAllocationInfo allocation = {};
+    VkResult result = vmaCreateBuffer(_mAllocator, &bufferInfo, &allocInfo, &_mBuffer, &_mAllocation, &allocation);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create staging ring buffer! (" + std::string(vk_result_str(result)) + ")");
+    }
+    _mMapped = static_cast<uint8_t*>(allocation.pMappedData);
+    _mCapacity = aCapacity;
+}
+
+UploadTicket StagingUploader::upload(
+    const std::vector<BufferUploadRequest>& aBufferRequests,
+    const std::vector<ImageUploadRequest>& aImageRequests,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<VkSemaphore>& aSignalSemaphores
+){
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Checked before a command buffer is begun, so a rejected batch doesn't leave one behind
+    bool empty = true;
+    for(const BufferUploadRequest& request : aBufferRequests){
+        if(request.mSize != 0) empty = false;
+    }
+    for(const ImageUploadRequest& request : aImageRequests){
+        if(request.rowSize() > _mCapacity){
+            throw std::runtime_error("Upload of " + std::to_string(request.rowSize()) + " contiguous bytes does not fit in the staging ring!");
+        }
+        if(request.size() != 0) empty = false;
+    }
+    if(empty && aWaitSemaphores.empty() && aSignalSemaphores.empty()) return(UploadTicket());
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _reclaimLocked();
+
+    VkCommandBuffer cmdBuffer = _mClosure.beginOneSubmitCommands();
+    bool recorded = false;
+    std::vector<VkSemaphore> pendingWaits = aWaitSemaphores;
+    VkDeviceSize offset = 0;
+
+    for(const BufferUploadRequest& request : aBufferRequests){
+        const uint8_t* source = static_cast<const uint8_t*>(request.mData);
+        VkDeviceSize done = 0;
+        while(done < request.mSize){
+            VkDeviceSize remaining = request.mSize - done;
+            // Don't split into pieces much smaller than the ring just because the head is near its end
+            VkDeviceSize minChunk = std::min(remaining, std::max<VkDeviceSize>(_mCapacity / 8, 1));
+            VkDeviceSize chunk = _allocateOrStallLocked(minChunk, remaining, 1, _mCopyAlignment, offset, cmdBuffer, recorded, pendingWaits);
+
+            std::memcpy(_mMapped + offset, source + done, chunk);
+            vmaFlushAllocation(_mAllocator, _mAllocation, offset, chunk);
+
+            VkBufferCopy region = {offset, request.mDstOffset + done, chunk};
+            vkCmdCopyBuffer(cmdBuffer, _mBuffer, request.mDstBuffer, 1, &region);
+            recorded = true;
+            done += chunk;
+        }
+        _mStats.mBytesUploaded += request.mSize;
+        ++_mStats.mRequests;
+    }
+
+    for(const ImageUploadRequest& request : aImageRequests){
+        const uint8_t* source = static_cast<const uint8_t*>(request.mData);
+        const VkDeviceSize rowSize = request.rowSize();
+        const uint32_t height = request.mExtent.height;
+        const uint32_t depth = request.mExtent.depth;
+        const uint64_t totalRows = uint64_t(height) * depth * request.mSubresource.layerCount;
+        // Offsets into the buffer must be multiples of both 4 and the texel size
+        const VkDeviceSize alignment = std::lcm(_mCopyAlignment, std::lcm<VkDeviceSize>(4, std::max(request.mTexelSize, 1u)));
+
+        uint64_t row = 0;
+        while(rowSize != 0 && row < totalRows){
+            // Each copy stays within a single slice of a single layer
+            const uint64_t slice = row / height;
+            const uint32_t y = static_cast<uint32_t>(row % height);
+            VkDeviceSize chunk = _allocateOrStallLocked(rowSize, (height - y) * rowSize, rowSize, alignment, offset, cmdBuffer, recorded, pendingWaits);
+            const uint32_t rows = static_cast<uint32_t>(chunk / rowSize);
+
+            std::memcpy(_mMapped + offset, source + row * rowSize, chunk);
+            vmaFlushAllocation(_mAllocator, _mAllocation, offset, chunk);
+
+            VkBufferImageCopy region = {};
+            {
+                region.bufferOffset = offset;
+                region.bufferRowLength = 0;
+                region.bufferImageHeight = 0;
+                region.imageSubresource = request.mSubresource;
+                region.imageSubresource.baseArrayLayer += static_cast<uint32_t>(slice / depth);
+                region.imageSubresource.layerCount = 1;
+                region.imageOffset = {request.mOffset.x, request.mOffset.y + int32_t(y), request.mOffset.z + int32_t(slice % depth)};
+                region.imageExtent = {request.mExtent.width, rows, 1};
+            }
+            vkCmdCopyBufferToImage(cmdBuffer, _mBuffer, request.mDstImage, request.mDstLayout, 1, &region);
+            recorded = true;
+            row += rows;
+        }
+        _mStats.mBytesUploaded += request.size();
+        ++_mStats.mRequests;
+    }
+
+    UploadTicket ticket = _submitLocked(cmdBuffer, pendingWaits, aSignalSemaphores);
+    _mStats.mElapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return(ticket);
+}
+
+void StagingUploader::reclaim(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _reclaimLocked();
+}
+
+VkDeviceSize StagingUploader::getBytesInFlight() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_mHead - _mTail);
+}
+
+StagingUploadStats StagingUploader::stats() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_mStats);
+}
+
+VkDeviceSize StagingUploader::_allocateLocked(
+    VkDeviceSize aMinBytes, VkDeviceSize aWantBytes, VkDeviceSize aGranularity, VkDeviceSize aAlignment, VkDeviceSize& aOffsetOut
+){
+    const VkDeviceSize limit = _mTail + _mCapacity;
+    const VkDeviceSize headOffset = _mHead % _mCapacity;
+    const VkDeviceSize alignedOffset = (headOffset + aAlignment - 1) / aAlignment * aAlignment;
+    VkDeviceSize position = _mHead + (alignedOffset - headOffset);
+
+    VkDeviceSize contiguous = 0;
+    if(alignedOffset < _mCapacity && position < limit){
+        contiguous = std::min(_mCapacity - alignedOffset, limit - position);
+    }
+    contiguous -= contiguous % aGranularity;
+
+    if(contiguous < aMinBytes){
+        // Skip what's left of this lap and start over at the beginning of the ring, which is always aligned
+        position = _mHead - headOffset + _mCapacity;
+        if(position >= limit) return(0);
+        contiguous = limit - position;
+        contiguous -= contiguous % aGranularity;
+        if(contiguous < aMinBytes) return(0);
+        ++_mStats.mWraps;
+    }
+
+    VkDeviceSize allocated = std::min(aWantBytes, contiguous);
+    _mHead = position + allocated;
+    aOffsetOut = position % _mCapacity;
+    return(allocated);
+}
+
+VkDeviceSize StagingUploader::_allocateOrStallLocked(
+    VkDeviceSize aMinBytes, VkDeviceSize aWantBytes, VkDeviceSize aGranularity, VkDeviceSize aAlignment, VkDeviceSize& aOffsetOut,
+    VkCommandBuffer& aCmdBuffer, bool& aRecorded, std::vector<VkSemaphore>& aPendingWaits
+){
+    while(true){
+        VkDeviceSize allocated = _allocateLocked(aMinBytes, aWantBytes, aGranularity, aAlignment, aOffsetOut);
+        if(allocated != 0) return(allocated);
+
+        if(aRecorded){
+            // Space only frees up once copies already staged are executing, so hand them to the queue first
+            _submitLocked(aCmdBuffer, aPendingWaits, {});
+            aPendingWaits.clear();
+            aCmdBuffer = _mClosure.beginOneSubmitCommands();
+            aRecorded = false;
+        }
+
+        _reclaimLocked();
+        if(_mInFlight.empty()){
+            // Nothing is in flight, so restart at the beginning of the next lap to make the whole ring contiguous
+            if(_mHead % _mCapacity != 0){
+                _mHead += _mCapacity - _mHead % _mCapacity;
+                ++_mStats.mWraps;
+            }
+            _mTail = _mHead;
+            allocated = _allocateLocked(aMinBytes, aWantBytes, aGranularity, aAlignment, aOffsetOut);
+            if(allocated != 0) return(allocated);
+
+            // Hand the begun command buffer back before giving up; it has nothing recorded in it
+            _mClosure.finishOneSubmitCommandsAsync(aCmdBuffer, aPendingWaits);
+            aPendingWaits.clear();
+            aCmdBuffer = VK_NULL_HANDLE;
+            throw std::runtime_error("Upload of " + std::to_string(aMinBytes) + " contiguous bytes does not fit in the staging ring!");
+        }
+
+        ++_mStats.mStalls;
+        _mInFlight.front().mTicket.wait();
+        _reclaimLocked();
+    }
+}
+
+UploadTicket StagingUploader::_submitLocked(VkCommandBuffer aCmdBuffer, const std::vector<VkSemaphore>& aWaits, const std::vector<VkSemaphore>& aSignals){
+    VkMemoryBarrier barrier = {};
+    {
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    }
+    vkCmdPipelineBarrier(aCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    UploadTicket ticket;
+    if(_mTimeline != nullptr){
+        TimelinePoint point = _mTimeline->submit(aCmdBuffer, {}, aWaits, aSignals);
+        ticket = UploadTicket(_mTimeline, point.mValue);
+    }else{
+        SubmissionFuture future = _mClosure.finishOneSubmitCommandsAsync(aCmdBuffer, aWaits, aSignals);
+        if(future.submitResult() != VK_SUCCESS){
+            throw std::runtime_error("Failed to submit staged uploads! (" + std::string(vk_result_str(future.submitResult())) + ")");
+        }
+        ticket = UploadTicket(future);
+    }
+
+    // Batches retire front to back, so everything staged before this point is free once this one is
+    _mInFlight.push_back(InFlightBatch{ticket, _mHead});
+    ++_mStats.mSubmissions;
+    return(ticket);
+}
+
+void StagingUploader::_reclaimLocked(){
+    while(!_mInFlight.empty() && _mInFlight.front().mTicket.poll()){
+        _mTail = _mInFlight.front().mRingEnd;
+        _mInFlight.pop_front();
+    }
+}
+
+} // end namespace vkutils
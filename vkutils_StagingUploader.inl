@@ -0,0 +1,164 @@
+#include <vulkan/vulkan.h>
+
+/// Copy of host data into a range of a buffer
+struct BufferUploadRequest
+{
+    const void* mData = nullptr;
+    VkDeviceSize mSize = 0;
+    VkBuffer mDstBuffer = VK_NULL_HANDLE;
+    VkDeviceSize mDstOffset = 0;
+};
+
+/// Copy of tightly packed host texels into a region of an image.
+///
+/// Texels are laid out row by row, then slice by slice, then layer by layer. The image must already be
+/// in `mDstLayout`. Only uncompressed formats are supported, since uploads are split on row boundaries.
+struct ImageUploadRequest
+{
+    const void* mData = nullptr;
+    VkImage mDstImage = VK_NULL_HANDLE;
+    VkImageLayout mDstLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    VkImageSubresourceLayers mSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    VkOffset3D mOffset = {0, 0, 0};
+    VkExtent3D mExtent = {0, 0, 1};
+    uint32_t mTexelSize = 4; ///< Bytes per texel of the image's format
+
+    VkDeviceSize rowSize() const {return(VkDeviceSize(mTexelSize) * mExtent.width);}
+    VkDeviceSize size() const {return(rowSize() * mExtent.height * mExtent.depth * mSubresource.layerCount);}
+};
+
+/// Completion of a batch of uploads, tracked by either a fence or a timeline point
+class UploadTicket
+{
+ public:
+    /// A default constructed ticket refers to no work and is already complete
+    UploadTicket() = default;
+    explicit UploadTicket(const SubmissionFuture& aFuture) : _mFuture(aFuture) {}
+    UploadTicket(const QueueTimeline* aTimeline, uint64_t aValue) : _mTimeline(aTimeline), _mValue(aValue) {}
+
+    /// Returns true once every copy in the batch has finished executing. Never blocks.
+    bool poll() const;
+
+    /// Blocks until every copy in the batch finishes executing or `aTimeout` nanoseconds pass
+    VkResult wait(uint64_t aTimeout = UINT64_MAX) const;
+
+    const SubmissionFuture& getFuture() const {return(_mFuture);}
+
+    /// Timeline point reached once the batch completes. Invalid for fence-tracked batches.
+    TimelinePoint getTimelinePoint() const {return(_mTimeline ? _mTimeline->point(_mValue) : TimelinePoint());}
+
+ private:
+    SubmissionFuture _mFuture;
+    const QueueTimeline* _mTimeline = nullptr;
+    uint64_t _mValue = 0;
+};
+
+/// Throughput counters for a StagingUploader
+struct StagingUploadStats
+{
+    uint64_t mBytesUploaded = 0;
+    uint64_t mRequests = 0;
+    uint64_t mSubmissions = 0;  ///< Command buffers submitted; more than one per batch when the ring wrapped onto busy space
+    uint64_t mWraps = 0;        ///< Times allocation skipped the tail of the ring to restart at its beginning
+    uint64_t mStalls = 0;       ///< Times upload() blocked waiting for ring space to retire
+    std::chrono::nanoseconds mElapsed = std::chrono::nanoseconds(0); ///< Time spent inside upload()
+
+    /// Bytes staged per second spent in upload(), in MB/s
+    double throughputMegabytesPerSecond() const;
+};
+
+/// Uploads host data to buffers and images through a persistently mapped staging ring buffer.
+///
+/// Each call to upload() copies its requests into space sub-allocated from the ring and records
+/// every copy into one command buffer from the QueueClosure. Ring space is reclaimed once the
+/// fence or timeline value guarding its submission retires. Requests larger than the free space
+/// are split into several copies; if the ring fills, the work recorded so far is submitted and
+/// upload() blocks until the oldest in-flight batch retires.
+///
+/// Every command buffer ends with a barrier making the transfer writes visible to later commands
+/// on the same queue. Consumers on other queues must synchronize with a semaphore or timeline point.
+class StagingUploader
+{
+ public:
+    /// Tracks completion with fences through `aClosure`
+    /// \throw std::runtime_error If the ring buffer can't be allocated
+    explicit StagingUploader(const QueueClosure& aClosure, VkDeviceSize aCapacity = 64ull << 20);
+
+    /// Submits through `aTimeline` and tracks completion with its points. The timeline must outlive the uploader.
+    /// \throw std::runtime_error If the ring buffer can't be allocated
+    explicit StagingUploader(QueueTimeline& aTimeline, VkDeviceSize aCapacity = 64ull << 20);
+
+    /// Waits for every in-flight upload, then frees the ring
+    ~StagingUploader();
+
+    StagingUploader(const StagingUploader&) = delete;
+    StagingUploader& operator=(const StagingUploader&) = delete;
+
+    /// Stages and submits a batch of copies. Host data may be freed as soon as this returns.
+    /// \param aWaitSemaphores Semaphores the first submission of the batch waits on
+    /// \param aSignalSemaphores Semaphores the last submission of the batch signals
+    /// \returns A ticket that completes once every copy in the batch has executed. Already complete if
+    ///          there is nothing to copy and no semaphores, in which case nothing is submitted.
+    /// \throw std::runtime_error If a submission fails or an image row is larger than the whole ring. Rows
+    ///                            are checked before anything is staged.
+    UploadTicket upload(
+        const std::vector<BufferUploadRequest>& aBufferRequests,
+        const std::vector<ImageUploadRequest>& aImageRequests = {},
+        const std::vector<VkSemaphore>& aWaitSemaphores = {},
+        const std::vector<VkSemaphore>& aSignalSemaphores = {}
+    );
+
+    /// Reclaims ring space from batches that have completed. Never blocks.
+    void reclaim();
+
+    VkDeviceSize getCapacity() const {return(_mCapacity);}
+
+    /// Bytes of the ring currently holding data for in-flight copies
+    VkDeviceSize getBytesInFlight() const;
+
+    StagingUploadStats stats() const;
+
+ protected:
+    struct InFlightBatch
+    {
+        UploadTicket mTicket;
+        VkDeviceSize mRingEnd = 0; ///< Ring position everything before which is freed when the ticket completes
+    };
+
+    void _createRing(VkDeviceSize aCapacity);
+
+    /// Sub-allocates between `aMinBytes` and `aWantBytes` contiguous bytes aligned to `aAlignment`,
+    /// in a multiple of `aGranularity` bytes.
+    /// \returns The number of bytes allocated, or 0 if fewer than `aMinBytes` are free
+    VkDeviceSize _allocateLocked(
+        VkDeviceSize aMinBytes, VkDeviceSize aWantBytes, VkDeviceSize aGranularity, VkDeviceSize aAlignment, VkDeviceSize& aOffsetOut
+    );
+
+    /// Like _allocateLocked(), but submits `aCmdBuffer` and waits for space when the ring is full
+    VkDeviceSize _allocateOrStallLocked(
+        VkDeviceSize aMinBytes, VkDeviceSize aWantBytes, VkDeviceSize aGranularity, VkDeviceSize aAlignment, VkDeviceSize& aOffsetOut,
+        VkCommandBuffer& aCmdBuffer, bool& aRecorded, std::vector<VkSemaphore>& aPendingWaits
+    );
+
+    UploadTicket _submitLocked(VkCommandBuffer aCmdBuffer, const std::vector<VkSemaphore>& aWaits, const std::vector<VkSemaphore>& aSignals);
+    void _reclaimLocked();
+
+ private:
+    QueueClosure _mClosure;
+    QueueTimeline* _mTimeline = nullptr;
+
+    VmaAllocator _mAllocator = nullptr;
+    VkBuffer _mBuffer = VK_NULL_HANDLE;
+    VmaAllocation _mAllocation = nullptr;
+    uint8_t* _mMapped = nullptr;
+    VkDeviceSize _mCapacity = 0;
+    VkDeviceSize _mCopyAlignment = 1;
+
+    // Positions grow monotonically; the ring offset of a position is `position % _mCapacity`
+    VkDeviceSize _mHead = 0;
+    VkDeviceSize _mTail = 0;
+    std::deque<InFlightBatch> _mInFlight;
+
+    mutable std::mutex _mMutex;
+    StagingUploadStats _mStats;
+};
@@ -0,0 +1,116 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+SubmitBatcher::~SubmitBatcher(){
+    flush();
+    std::lock_guard<std::mutex> lock(_mFlushHandle->mMutex);
+    _mFlushHandle->mBatcher = nullptr;
+}
+
+SubmissionFuture SubmitBatcher::enqueue(
+    const VkCommandBuffer& aCmdBuffer,
+    const std::vector<VkSemaphore>& aWaitSemaphores,
+    const std::vector<VkSemaphore>& aSignalSemaphores,
+    VkDeviceSize aPayloadBytes
+){
+    ASSERT_VK_SUCCESS(vkEndCommandBuffer(aCmdBuffer));
+
+    PendingSubmission pending;
+    {
+        pending.mCmdBuffer = aCmdBuffer;
+        pending.mWaitSemaphores = aWaitSemaphores;
+        pending.mWaitStages.assign(aWaitSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        pending.mSignalSemaphores = aSignalSemaphores;
+    }
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    if(_mPending.empty()){
+        _mBatchState = _mRecycler->createState();
+        _mBatchState->mFlush = [handle = std::weak_ptr<FlushHandle>(_mFlushHandle), state = _mBatchState.get()](){
+            std::shared_ptr<FlushHandle> locked = handle.lock();
+            if(locked == nullptr) return;
+            std::lock_guard<std::mutex> lock(locked->mMutex);
+            if(locked->mBatcher != nullptr) locked->mBatcher->_flushState(state);
+        };
+        _mBatchStart = std::chrono::steady_clock::now();
+    }
+    _mPending.push_back(std::move(pending));
+    _mPendingBytes += aPayloadBytes;
+
+    SubmissionFuture future(_mBatchState);
+    if(_limitReachedLocked()) _flushLocked();
+    return(future);
+}
+
+VkResult SubmitBatcher::flush(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_flushLocked());
+}
+
+VkResult SubmitBatcher::flushIfDue(){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    if(!_limitReachedLocked()) return(VK_SUCCESS);
+    return(_flushLocked());
+}
+
+void SubmitBatcher::_flushState(const SubmissionState* aState){
+    std::lock_guard<std::mutex> lock(_mMutex);
+    if(_mBatchState.get() == aState) _flushLocked();
+}
+
+size_t SubmitBatcher::pendingCount() const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_mPending.size());
+}
+
+bool SubmitBatcher::_limitReachedLocked() const{
+    if(_mPending.empty()) return(false);
+    if(_mLimits.mMaxSubmissions != 0 && _mPending.size() >= _mLimits.mMaxSubmissions) return(true);
+    if(_mLimits.mMaxBytes != 0 && _mPendingBytes >= _mLimits.mMaxBytes) return(true);
+    if(_mLimits.mMaxLatency.count() != 0 && std::chrono::steady_clock::now() - _mBatchStart >= _mLimits.mMaxLatency) return(true);
+    return(false);
+}
+
+VkResult SubmitBatcher::_flushLocked(){
+    if(_mPending.empty()) return(VK_SUCCESS);
+
+    std::vector<VkSubmitInfo> submissions(_mPending.size(), sSingleSubmitTemplate);
+    std::vector<VkCommandBuffer> cmdBuffers;
+    std::vector<VkSemaphore> allWaits;
+    cmdBuffers.reserve(_mPending.size());
+    for(size_t i = 0; i < _mPending.size(); ++i){
+        const PendingSubmission& pending = _mPending[i];
+        submissions[i].commandBufferCount = 1;
+        submissions[i].pCommandBuffers = &pending.mCmdBuffer;
+        submissions[i].waitSemaphoreCount = static_cast<uint32_t>(pending.mWaitSemaphores.size());
+        submissions[i].pWaitSemaphores = pending.mWaitSemaphores.data();
+        submissions[i].pWaitDstStageMask = pending.mWaitStages.data();
+        submissions[i].signalSemaphoreCount = static_cast<uint32_t>(pending.mSignalSemaphores.size());
+        submissions[i].pSignalSemaphores = pending.mSignalSemaphores.data();
+
+        cmdBuffers.push_back(pending.mCmdBuffer);
+        allWaits.insert(allWaits.end(), pending.mWaitSemaphores.begin(), pending.mWaitSemaphores.end());
+    }
+
+    VkFence fence = _mRecycler->acquireFence();
+    VkResult result = vkQueueSubmit(_mQueue, static_cast<uint32_t>(submissions.size()), submissions.data(), fence);
+    if(result == VK_SUCCESS){
+        _mRecycler->track(cmdBuffers, fence, allWaits, {_mBatchState});
+        _mSubmittedCount += submissions.size();
+        ++_mFlushCount;
+    }else{
+        _mRecycler->releaseFence(fence);
+        for(VkCommandBuffer cmdBuffer : cmdBuffers){
+            _mRecycler->retire(cmdBuffer);
+        }
+        _mRecycler->abandon(_mBatchState, result);
+    }
+
+    _mPending.clear();
+    _mPendingBytes = 0;
+    _mBatchState.reset();
+    return(result);
+}
+
+} // end namespace vkutils
@@ -0,0 +1,87 @@
+#include <vulkan/vulkan.h>
+
+/// Thresholds at which a SubmitBatcher flushes automatically. A value of zero disables that threshold.
+struct SubmitBatchLimits
+{
+    uint32_t mMaxSubmissions = 32;
+    VkDeviceSize mMaxBytes = 0;
+    std::chrono::microseconds mMaxLatency = std::chrono::microseconds(0);
+};
+
+/// Coalesces many one-shot submissions to a QueueClosure's queue into a single vkQueueSubmit.
+///
+/// Each enqueued command buffer keeps its own VkSubmitInfo, so wait and signal semaphores are
+/// preserved per entry and entries execute in the order they were enqueued. A batch is flushed
+/// explicitly, once it reaches `mMaxSubmissions` entries or `mMaxBytes` of declared payload, or
+/// once its oldest entry is older than `mMaxLatency`. Latency is only checked on enqueue() and
+/// flushIfDue(), so a producer that goes idle should call flushIfDue() periodically.
+///
+/// All entries of a batch share one fence and complete together. Waiting on the future of an entry
+/// that hasn't been flushed yet flushes its batch, so a wait never stalls on held back work.
+class SubmitBatcher
+{
+ public:
+    SubmitBatcher(const QueueClosure& aClosure, const SubmitBatchLimits& aLimits = SubmitBatchLimits())
+    : _mQueue(aClosure.getQueue()), _mRecycler(aClosure._mRecycler), _mLimits(aLimits),
+      _mFlushHandle(std::make_shared<FlushHandle>()) {_mFlushHandle->mBatcher = this;}
+    ~SubmitBatcher();
+
+    SubmitBatcher(const SubmitBatcher&) = delete;
+    SubmitBatcher& operator=(const SubmitBatcher&) = delete;
+
+    /// Ends `aCmdBuffer` and queues it for the next flush.
+    /// \param aPayloadBytes Size of the data the commands move, counted against `mMaxBytes`.
+    SubmissionFuture enqueue(
+        const VkCommandBuffer& aCmdBuffer,
+        const std::vector<VkSemaphore>& aWaitSemaphores = {},
+        const std::vector<VkSemaphore>& aSignalSemaphores = {},
+        VkDeviceSize aPayloadBytes = 0
+    );
+
+    /// Submits every queued entry with a single vkQueueSubmit
+    VkResult flush();
+
+    /// Flushes only if the pending batch has exceeded its latency limit
+    VkResult flushIfDue();
+
+    size_t pendingCount() const;
+    uint64_t getSubmittedCount() const {return(_mSubmittedCount);}
+    uint64_t getFlushCount() const {return(_mFlushCount);}
+
+ protected:
+    struct PendingSubmission
+    {
+        VkCommandBuffer mCmdBuffer;
+        std::vector<VkSemaphore> mWaitSemaphores;
+        std::vector<VkPipelineStageFlags> mWaitStages;
+        std::vector<VkSemaphore> mSignalSemaphores;
+    };
+
+    /// Lets futures flush the batch they belong to for as long as the batcher lives
+    struct FlushHandle
+    {
+        std::mutex mMutex;
+        SubmitBatcher* mBatcher = nullptr;
+    };
+
+    bool _limitReachedLocked() const;
+    VkResult _flushLocked();
+
+    /// Flushes the pending batch if its state is `aState`
+    void _flushState(const SubmissionState* aState);
+
+ private:
+    VkQueue _mQueue = VK_NULL_HANDLE;
+    std::shared_ptr<CommandBufferRecycler> _mRecycler;
+    SubmitBatchLimits _mLimits;
+
+    mutable std::mutex _mMutex;
+    std::vector<PendingSubmission> _mPending;
+    std::shared_ptr<SubmissionState> _mBatchState;
+    VkDeviceSize _mPendingBytes = 0;
+    std::chrono::steady_clock::time_point _mBatchStart;
+    std::shared_ptr<FlushHandle> _mFlushHandle;
+
+    std::atomic<uint64_t> _mSubmittedCount = {0};
+    std::atomic<uint64_t> _mFlushCount = {0};
+};
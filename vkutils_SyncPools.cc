@@ -0,0 +1,227 @@
+#include "vkutils.h"
+
+namespace vkutils{
+
+namespace{
+
+// Pools are shared per device while at least one user holds them. Expired entries, including
+// those of destroyed devices, are pruned on every lookup.
+template<typename PoolType>
+std::shared_ptr<PoolType> shared_pool_for_device(VkDevice aDevice){
+    static std::mutex sRegistryMutex;
+    static std::unordered_map<VkDevice, std::weak_ptr<PoolType>> sRegistry;
+
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    for(auto iter = sRegistry.begin(); iter != sRegistry.end();){
+        if(iter->second.expired() && iter->first != aDevice) iter = sRegistry.erase(iter);
+        else ++iter;
+    }
+
+    std::shared_ptr<PoolType> pool = sRegistry[aDevice].lock();
+    if(pool == nullptr){
+        pool = std::make_shared<PoolType>(aDevice);
+        sRegistry[aDevice] = pool;
+    }
+    return(pool);
+}
+
+template<typename FunctionType>
+FunctionType load_device_function(VkDevice aDevice, const char* aCoreName, const char* aExtensionName){
+    return(reinterpret_cast<FunctionType>(get_device_func(aDevice, VK_API_VERSION_1_2, aCoreName, aExtensionName)));
+}
+
+} // end anonymous namespace
+
+TimelineSemaphoreDispatch TimelineSemaphoreDispatch::load(VkDevice aDevice){
+    TimelineSemaphoreDispatch dispatch;
+    dispatch.mGetSemaphoreCounterValue = load_device_function<PFN_vkGetSemaphoreCounterValue>(aDevice, "vkGetSemaphoreCounterValue", "vkGetSemaphoreCounterValueKHR");
+    dispatch.mWaitSemaphores = load_device_function<PFN_vkWaitSemaphores>(aDevice, "vkWaitSemaphores", "vkWaitSemaphoresKHR");
+    dispatch.mSignalSemaphore = load_device_function<PFN_vkSignalSemaphore>(aDevice, "vkSignalSemaphore", "vkSignalSemaphoreKHR");
+    return(dispatch);
+}
+
+uint64_t TimelineSemaphoreDispatch::counterValue(VkDevice aDevice, VkSemaphore aSemaphore) const{
+    uint64_t value = 0;
+    mGetSemaphoreCounterValue(aDevice, aSemaphore, &value);
+    return(value);
+}
+
+VkResult TimelineSemaphoreDispatch::wait(VkDevice aDevice, const TimelinePoint& aPoint, uint64_t aTimeout) const{
+    VkSemaphoreWaitInfo waitInfo = {};
+    {
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.pNext = nullptr;
+        waitInfo.flags = 0;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &aPoint.mSemaphore;
+        waitInfo.pValues = &aPoint.mValue;
+    }
+    return(mWaitSemaphores(aDevice, &waitInfo, aTimeout));
+}
+
+FencePool::~FencePool(){
+    if(_mFree.size() != _mOwned.size()){
+        std::cerr << "Warning: FencePool destroyed with " << (_mOwned.size() - _mFree.size()) << " fences still in use" << std::endl;
+    }
+    for(VkFence fence : _mFree){
+        vkDestroyFence(_mDevice, fence, nullptr);
+    }
+}
+
+std::shared_ptr<FencePool> FencePool::forDevice(VkDevice aDevice){
+    return(shared_pool_for_device<FencePool>(aDevice));
+}
+
+VkFence FencePool::acquire(){
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        if(!_mFree.empty()){
+            VkFence fence = _mFree.back();
+            _mFree.pop_back();
+            ++_mHits;
+            return(fence);
+        }
+    }
+    ++_mMisses;
+    return(_create());
+}
+
+void FencePool::release(VkFence aFence){
+    if(aFence == VK_NULL_HANDLE) return;
+    vkResetFences(_mDevice, 1, &aFence);
+    std::lock_guard<std::mutex> lock(_mMutex);
+    assert(_mOwned.count(aFence) > 0);
+    _mFree.push_back(aFence);
+}
+
+bool FencePool::owns(VkFence aFence) const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_mOwned.count(aFence) > 0);
+}
+
+void FencePool::reserve(size_t aCount){
+    std::vector<VkFence> created;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        if(_mFree.size() >= aCount) return;
+        created.reserve(aCount - _mFree.size());
+        while(_mFree.size() + created.size() < aCount) created.push_back(VK_NULL_HANDLE);
+    }
+    for(VkFence& fence : created){
+        fence = _create();
+    }
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mFree.insert(_mFree.end(), created.begin(), created.end());
+}
+
+SyncPoolStats FencePool::stats() const{
+    SyncPoolStats stats;
+    std::lock_guard<std::mutex> lock(_mMutex);
+    stats.mHits = _mHits;
+    stats.mMisses = _mMisses;
+    stats.mAvailable = _mFree.size();
+    stats.mCreated = _mOwned.size();
+    return(stats);
+}
+
+VkFence FencePool::_create(){
+    VkFenceCreateInfo fenceInfo = {};
+    {
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = 0;
+    }
+
+    VkFence fence = VK_NULL_HANDLE;
+    VkResult result = vkCreateFence(_mDevice, &fenceInfo, nullptr, &fence);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pooled fence! (" + std::string(vk_result_str(result)) + ")");
+    }
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mOwned.insert(fence);
+    return(fence);
+}
+
+SemaphorePool::~SemaphorePool(){
+    if(_mFree.size() != _mOwned.size()){
+        std::cerr << "Warning: SemaphorePool destroyed with " << (_mOwned.size() - _mFree.size()) << " semaphores still in use" << std::endl;
+    }
+    for(VkSemaphore semaphore : _mFree){
+        vkDestroySemaphore(_mDevice, semaphore, nullptr);
+    }
+}
+
+std::shared_ptr<SemaphorePool> SemaphorePool::forDevice(VkDevice aDevice){
+    return(shared_pool_for_device<SemaphorePool>(aDevice));
+}
+
+VkSemaphore SemaphorePool::acquire(){
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        if(!_mFree.empty()){
+            VkSemaphore semaphore = _mFree.back();
+            _mFree.pop_back();
+            ++_mHits;
+            return(semaphore);
+        }
+    }
+    ++_mMisses;
+    return(_create());
+}
+
+void SemaphorePool::release(VkSemaphore aSemaphore){
+    if(aSemaphore == VK_NULL_HANDLE) return;
+    std::lock_guard<std::mutex> lock(_mMutex);
+    assert(_mOwned.count(aSemaphore) > 0);
+    _mFree.push_back(aSemaphore);
+}
+
+bool SemaphorePool::owns(VkSemaphore aSemaphore) const{
+    std::lock_guard<std::mutex> lock(_mMutex);
+    return(_mOwned.count(aSemaphore) > 0);
+}
+
+void SemaphorePool::reserve(size_t aCount){
+    std::vector<VkSemaphore> created;
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        if(_mFree.size() >= aCount) return;
+        created.reserve(aCount - _mFree.size());
+        while(_mFree.size() + created.size() < aCount) created.push_back(VK_NULL_HANDLE);
+    }
+    for(VkSemaphore& semaphore : created){
+        semaphore = _create();
+    }
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mFree.insert(_mFree.end(), created.begin(), created.end());
+}
+
+SyncPoolStats SemaphorePool::stats() const{
+    SyncPoolStats stats;
+    std::lock_guard<std::mutex> lock(_mMutex);
+    stats.mHits = _mHits;
+    stats.mMisses = _mMisses;
+    stats.mAvailable = _mFree.size();
+    stats.mCreated = _mOwned.size();
+    return(stats);
+}
+
+VkSemaphore SemaphorePool::_create(){
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    {
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.flags = 0;
+    }
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    VkResult result = vkCreateSemaphore(_mDevice, &semaphoreInfo, nullptr, &semaphore);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pooled semaphore! (" + std::string(vk_result_str(result)) + ")");
+    }
+
+    std::lock_guard<std::mutex> lock(_mMutex);
+    _mOwned.insert(semaphore);
+    return(semaphore);
+}
+
+} // end namespace vkutils
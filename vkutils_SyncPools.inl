@@ -0,0 +1,115 @@
+#include <vulkan/vulkan.h>
+
+/// A value on a timeline semaphore. Reaching a point means all work that signaled values up to it has completed.
+struct TimelinePoint
+{
+    VkSemaphore mSemaphore = VK_NULL_HANDLE;
+    uint64_t mValue = 0;
+
+    bool isValid() const {return(mSemaphore != VK_NULL_HANDLE);}
+};
+
+/// Timeline semaphore entry points, resolved through vkGetDeviceProcAddr so that devices exposing the
+/// feature through VK_KHR_timeline_semaphore work as well as Vulkan 1.2 devices.
+struct TimelineSemaphoreDispatch
+{
+    PFN_vkGetSemaphoreCounterValue mGetSemaphoreCounterValue = nullptr;
+    PFN_vkWaitSemaphores mWaitSemaphores = nullptr;
+    PFN_vkSignalSemaphore mSignalSemaphore = nullptr;
+
+    bool isValid() const {return(mGetSemaphoreCounterValue && mWaitSemaphores && mSignalSemaphore);}
+
+    /// Returns an invalid dispatch if neither the core nor the KHR entry points are available
+    static TimelineSemaphoreDispatch load(VkDevice aDevice);
+
+    uint64_t counterValue(VkDevice aDevice, VkSemaphore aSemaphore) const;
+    VkResult wait(VkDevice aDevice, const TimelinePoint& aPoint, uint64_t aTimeout) const;
+};
+
+/// Usage counters for FencePool and SemaphorePool, used to size the pools.
+struct SyncPoolStats
+{
+    uint64_t mHits = 0;     ///< Acquisitions served from a recycled object
+    uint64_t mMisses = 0;   ///< Acquisitions that had to create a new object
+    size_t mAvailable = 0;  ///< Objects currently idle in the pool
+    size_t mCreated = 0;    ///< Objects owned by the pool, idle or in use
+};
+
+/// Recycles fences for a single device.
+///
+/// Fences are handed out unsignaled. A fence may be released signaled or unsignaled, but
+/// must not be associated with a pending submission. All fences owned by the pool are
+/// destroyed with it, so the pool must not outlive its device.
+class FencePool
+{
+ public:
+    explicit FencePool(VkDevice aDevice) : _mDevice(aDevice) {}
+    ~FencePool();
+
+    FencePool(const FencePool&) = delete;
+    FencePool& operator=(const FencePool&) = delete;
+
+    /// Returns the pool shared by all users of `aDevice`, creating it if no pool for the device is alive
+    static std::shared_ptr<FencePool> forDevice(VkDevice aDevice);
+
+    /// \throw std::runtime_error If a new fence is needed and creating it fails
+    VkFence acquire();
+    void release(VkFence aFence);
+
+    /// True if `aFence` was created by this pool
+    bool owns(VkFence aFence) const;
+
+    /// Creates fences up front until at least `aCount` are idle in the pool
+    void reserve(size_t aCount);
+
+    SyncPoolStats stats() const;
+
+ private:
+    VkFence _create();
+
+    VkDevice _mDevice = VK_NULL_HANDLE;
+    mutable std::mutex _mMutex;
+    std::vector<VkFence> _mFree;
+    std::unordered_set<VkFence> _mOwned;
+    std::atomic<uint64_t> _mHits = {0};
+    std::atomic<uint64_t> _mMisses = {0};
+};
+
+/// Recycles binary semaphores for a single device.
+///
+/// A semaphore may only be released once both its signal and wait operations have completed.
+/// QueueClosure does this automatically for pooled semaphores passed as wait semaphores.
+class SemaphorePool
+{
+ public:
+    explicit SemaphorePool(VkDevice aDevice) : _mDevice(aDevice) {}
+    ~SemaphorePool();
+
+    SemaphorePool(const SemaphorePool&) = delete;
+    SemaphorePool& operator=(const SemaphorePool&) = delete;
+
+    /// Returns the pool shared by all users of `aDevice`, creating it if no pool for the device is alive
+    static std::shared_ptr<SemaphorePool> forDevice(VkDevice aDevice);
+
+    /// \throw std::runtime_error If a new semaphore is needed and creating it fails
+    VkSemaphore acquire();
+    void release(VkSemaphore aSemaphore);
+
+    /// True if `aSemaphore` was created by this pool
+    bool owns(VkSemaphore aSemaphore) const;
+
+    /// Creates semaphores up front until at least `aCount` are idle in the pool
+    void reserve(size_t aCount);
+
+    SyncPoolStats stats() const;
+
+ private:
+    VkSemaphore _create();
+
+    VkDevice _mDevice = VK_NULL_HANDLE;
+    mutable std::mutex _mMutex;
+    std::vector<VkSemaphore> _mFree;
+    std::unordered_set<VkSemaphore> _mOwned;
+    std::atomic<uint64_t> _mHits = {0};
+    std::atomic<uint64_t> _mMisses = {0};
+};
@@ -0,0 +1,146 @@
+#include "vkutils.h"
+#include "VmaHost.h"
+
+namespace vkutils{
+
+TransientArena::TransientArena(
+    const VulkanDeviceHandlePair& aDevicePair,
+    VkDeviceSize aFrameSize,
+    VkBufferUsageFlags aUsage,
+    VmaMemoryUsage aMemoryUsage,
+    uint32_t aFrameCount
+)
+:   _mDevice(aDevicePair.device),
+    _mAllocator(VmaHost::getAllocator(aDevicePair)),
+    _mFrameSize(aFrameSize),
+    _mUsage(aUsage)
+{
+    if(aFrameSize == 0 || aFrameCount == 0) throw std::runtime_error("Attempted to create a transient arena with no capacity!");
+
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = nullptr;
+        bufferInfo.flags = 0;
+        bufferInfo.size = aFrameSize;
+        bufferInfo.usage = aUsage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    // One preallocated block per frame, so allocations never reach for new device memory
+    VmaPoolCreateInfo poolInfo = VmaHost::bufferPoolInfo(aDevicePair, bufferInfo, aMemoryUsage, aFrameSize, VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT);
+    poolInfo.minBlockCount = 1;
+    poolInfo.maxBlockCount = 1;
+
+    // GPU_ONLY may still land in host visible memory, and other usages may not
+    VkMemoryPropertyFlags memoryFlags = 0;
+    vmaGetMemoryTypeProperties(_mAllocator, poolInfo.memoryTypeIndex, &memoryFlags);
+    _mMapped = (memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+    _mFrames.resize(aFrameCount);
+    for(Frame& frame : _mFrames){
+        VkResult result = vmaCreatePool(_mAllocator, &poolInfo, &frame.mPool);
+        if(result != VK_SUCCESS){
+            for(Frame& created : _mFrames){
+                if(created.mPool != nullptr) vmaDestroyPool(_mAllocator, created.mPool);
+            }
+            throw std::runtime_error("Failed to create transient arena pool! (" + std::string(vk_result_str(result)) + ")");
+        }
+    }
+}
+
+TransientArena::~TransientArena(){
+    for(uint32_t i = 0; i < _mFrames.size(); ++i){
+        VkFence fence = _mFrames[i].mFence;
+        if(fence != VK_NULL_HANDLE){
+            VkResult result = vkWaitForFences(_mDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+            if(result != VK_SUCCESS){
+                std::cerr << "Warning: Failed to wait on transient arena frame fence! (" << vk_result_str(result) << ")" << std::endl;
+            }
+        }
+        reset(i);
+        vmaDestroyPool(_mAllocator, _mFrames[i].mPool);
+    }
+}
+
+TransientBuffer TransientArena::createBuffer(VkDeviceSize aSize, VkBufferUsageFlags aUsage){
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = nullptr;
+        bufferInfo.flags = 0;
+        bufferInfo.size = std::max<VkDeviceSize>(aSize, 1);
+        bufferInfo.usage = aUsage != 0 ? aUsage : _mUsage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    Frame& frame = _mFrames[_mFrame];
+    VmaAllocationCreateInfo allocInfo = {};
+    {
+        allocInfo.pool = frame.mPool;
+        if(_mMapped) allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    }
+
+    TransientBuffer buffer;
+    VmaAllocation allocation = nullptr;
+    VmaAllocationInfo allocationInfo = {};
+    if(vmaCreateBuffer(_mAllocator, &bufferInfo, &allocInfo, &buffer.mBuffer, &allocation, &allocationInfo) != VK_SUCCESS){
+        _mFailedBuffers.fetch_add(1, std::memory_order_relaxed);
+        return(TransientBuffer());
+    }
+    buffer.mSize = aSize;
+    buffer.mMapped = allocationInfo.pMappedData;
+
+    {
+        std::lock_guard<std::mutex> lock(_mMutex);
+        frame.mBuffers.push_back({buffer.mBuffer, allocation});
+    }
+    _mBuffers.fetch_add(1, std::memory_order_relaxed);
+    return(buffer);
+}
+
+void TransientArena::setFrameFence(VkFence aFence){
+    _mFrames[_mFrame].mFence = aFence;
+}
+
+uint32_t TransientArena::nextFrame(){
+    _mPeakFrameBytes = std::max(_mPeakFrameBytes, _frameBytes(_mFrames[_mFrame]));
+    _mFrame = (_mFrame + 1) % static_cast<uint32_t>(_mFrames.size());
+
+    Frame& frame = _mFrames[_mFrame];
+    if(frame.mFence != VK_NULL_HANDLE){
+        VkResult result = vkWaitForFences(_mDevice, 1, &frame.mFence, VK_TRUE, UINT64_MAX);
+        if(result != VK_SUCCESS){
+            throw std::runtime_error("Failed to wait on transient arena frame fence! (" + std::string(vk_result_str(result)) + ")");
+        }
+    }
+    reset(_mFrame);
+    return(_mFrame);
+}
+
+void TransientArena::reset(uint32_t aFrame){
+    Frame& frame = _mFrames[aFrame];
+    // Freeing from the back unwinds the linear allocator in order
+    for(auto iter = frame.mBuffers.rbegin(); iter != frame.mBuffers.rend(); ++iter){
+        vmaDestroyBuffer(_mAllocator, iter->first, iter->second);
+    }
+    frame.mBuffers.clear();
+    frame.mFence = VK_NULL_HANDLE;
+}
+
+VkDeviceSize TransientArena::_frameBytes(const Frame& aFrame) const{
+    VmaStatistics poolStats = {};
+    vmaGetPoolStatistics(_mAllocator, aFrame.mPool, &poolStats);
+    return(poolStats.allocationBytes);
+}
+
+TransientArenaStats TransientArena::stats() const{
+    TransientArenaStats stats;
+    stats.mBuffers = _mBuffers.load(std::memory_order_relaxed);
+    stats.mFailedBuffers = _mFailedBuffers.load(std::memory_order_relaxed);
+    stats.mFrameBytes = _frameBytes(_mFrames[_mFrame]);
+    stats.mPeakFrameBytes = std::max(_mPeakFrameBytes, stats.mFrameBytes);
+    return(stats);
+}
+
+} // end namespace vkutils
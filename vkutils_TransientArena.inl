@@ -0,0 +1,104 @@
+#include <vulkan/vulkan.h>
+
+/// Buffer created by a TransientArena. Owned by the arena and destroyed when its frame is reset.
+struct TransientBuffer
+{
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    VkDeviceSize mSize = 0;
+    void* mMapped = nullptr;    ///< Host pointer for host visible arenas, otherwise null
+
+    bool isValid() const {return(mBuffer != VK_NULL_HANDLE);}
+};
+
+/// Counters for a TransientArena
+struct TransientArenaStats
+{
+    uint64_t mBuffers = 0;
+    uint64_t mFailedBuffers = 0;        ///< Buffers that didn't fit in what was left of their frame
+    VkDeviceSize mFrameBytes = 0;       ///< Bytes used by the current frame
+    VkDeviceSize mPeakFrameBytes = 0;   ///< Most bytes used by a single frame so far
+};
+
+/// Per-frame arenas for buffers that live no longer than one frame in flight.
+///
+/// Each frame owns a VMA pool using VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT with a single block of
+/// memory, allocated up front. Creating a buffer still creates a VkBuffer and binds it, but its memory
+/// comes from bumping the end of the frame's block rather than from a new device allocation or a
+/// free-list search. Once the frame's fence signals every buffer it held is released at once, leaving
+/// the block empty for reuse.
+///
+/// createBuffer() may be called from any thread. setFrameFence(), nextFrame() and reset() must not
+/// run concurrently with it. The pools aren't registered with VmaHost, so the arena must be destroyed
+/// before its device's allocator.
+class TransientArena
+{
+ public:
+    /// \param aFrameSize Bytes of memory reserved for each frame
+    /// \param aUsage Usage of the pool's example buffer. Buffers created from the arena may use any subset of it.
+    /// \param aMemoryUsage Where the arenas live. Buffers are mapped persistently if the chosen memory type is host visible.
+    /// \param aFrameCount Frames in flight, each with its own arena
+    /// \throw std::runtime_error If a pool can't be created
+    TransientArena(
+        const VulkanDeviceHandlePair& aDevicePair,
+        VkDeviceSize aFrameSize,
+        VkBufferUsageFlags aUsage,
+        VmaMemoryUsage aMemoryUsage = VMA_MEMORY_USAGE_GPU_ONLY,
+        uint32_t aFrameCount = 2
+    );
+    /// Waits on every frame's fence before releasing its buffers
+    ~TransientArena();
+
+    TransientArena(const TransientArena&) = delete;
+    TransientArena& operator=(const TransientArena&) = delete;
+
+    /// Creates a buffer in the current frame's arena
+    /// \param aUsage Usage of the buffer, or 0 for the arena's usage
+    /// \returns An invalid buffer if the frame's arena is full
+    TransientBuffer createBuffer(VkDeviceSize aSize, VkBufferUsageFlags aUsage = 0);
+
+    /// Sets the fence signaled by the last submission that uses the current frame's buffers. The fence
+    /// is not owned by the arena and must stay alive until the frame is reset.
+    void setFrameFence(VkFence aFence);
+
+    /// Moves to the next frame, waiting on that frame's fence (if one was set) and then releasing every
+    /// buffer it held.
+    /// \returns The new frame index
+    /// \throw std::runtime_error If waiting on the fence fails
+    uint32_t nextFrame();
+
+    /// Releases every buffer of `aFrame` without waiting. The GPU must be done with them.
+    void reset(uint32_t aFrame);
+
+    uint32_t getFrameIndex() const {return(_mFrame);}
+    uint32_t getFrameCount() const {return(static_cast<uint32_t>(_mFrames.size()));}
+    VkDeviceSize getFrameSize() const {return(_mFrameSize);}
+
+    TransientArenaStats stats() const;
+
+ protected:
+    struct Frame
+    {
+        VmaPool mPool = nullptr;
+        VkFence mFence = VK_NULL_HANDLE;
+        std::vector<std::pair<VkBuffer, VmaAllocation>> mBuffers;
+    };
+
+    /// Bytes allocated from `aFrame`'s pool
+    VkDeviceSize _frameBytes(const Frame& aFrame) const;
+
+ private:
+    VkDevice _mDevice = VK_NULL_HANDLE;
+    VmaAllocator _mAllocator = nullptr;
+    VkDeviceSize _mFrameSize = 0;
+    VkBufferUsageFlags _mUsage = 0;
+    bool _mMapped = false;
+
+    std::vector<Frame> _mFrames;
+    uint32_t _mFrame = 0;
+
+    // Guards the current frame's buffer list
+    mutable std::mutex _mMutex;
+    std::atomic<uint64_t> _mBuffers = {0};
+    std::atomic<uint64_t> _mFailedBuffers = {0};
+    VkDeviceSize _mPeakFrameBytes = 0;
+};
@@ -0,0 +1,113 @@
+#include "vkutils.h"
+#include "VmaHost.h"
+
+namespace vkutils{
+
+UniformRing::UniformRing(const VulkanDeviceHandlePair& aDevicePair, VkDeviceSize aFrameSize, VkDeviceSize aRange, uint32_t aFrameCount, VkBufferUsageFlags aUsage){
+    if(aFrameSize == 0 || aRange == 0 || aFrameCount == 0) throw std::runtime_error("Attempted to create a uniform ring with no capacity!");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(aDevicePair.physicalDevice, &properties);
+    if(aUsage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT){
+        _mAlignment = std::max(_mAlignment, properties.limits.minUniformBufferOffsetAlignment);
+        if(aRange > properties.limits.maxUniformBufferRange){
+            throw std::runtime_error("Attempted to create a uniform ring with a range larger than maxUniformBufferRange!");
+        }
+    }
+    if(aUsage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT){
+        _mAlignment = std::max(_mAlignment, properties.limits.minStorageBufferOffsetAlignment);
+        if(aRange > properties.limits.maxStorageBufferRange){
+            throw std::runtime_error("Attempted to create a uniform ring with a range larger than maxStorageBufferRange!");
+        }
+    }
+
+    // Offset alignments are powers of two
+    _mFrameSize = (aFrameSize + _mAlignment - 1) & ~(_mAlignment - 1);
+    _mFrameCount = aFrameCount;
+    _mRange = aRange;
+    const VkDeviceSize capacity = _mFrameSize * aFrameCount;
+    if(capacity > UINT32_MAX){
+        throw std::runtime_error("Attempted to create a uniform ring larger than dynamic offsets can address!");
+    }
+
+    VkBufferCreateInfo bufferInfo = {};
+    {
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.pNext = nullptr;
+        bufferInfo.flags = 0;
+        // The last allocation's range may extend past the final frame
+        bufferInfo.size = capacity + aRange;
+        bufferInfo.usage = aUsage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    {
+        allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+    }
+
+    _mAllocator = VmaHost::getAllocator(aDevicePair);
+    VmaAllocationInfo allocation = {};
+    VkResult result = vmaCreateBuffer(_mAllocator, &bufferInfo, &allocInfo, &_mBuffer, &_mAllocation, &allocation);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create uniform ring buffer! (" + std::string(vk_result_str(result)) + ")");
+    }
+    _mMapped = static_cast<uint8_t*>(allocation.pMappedData);
+}
+
+UniformRing::~UniformRing(){
+    vmaDestroyBuffer(_mAllocator, _mBuffer, _mAllocation);
+}
+
+UniformAllocation UniformRing::allocate(VkDeviceSize aSize){
+    const VkDeviceSize alignedSize = (std::max<VkDeviceSize>(aSize, 1) + _mAlignment - 1) & ~(_mAlignment - 1);
+    const VkDeviceSize offset = _mHead.fetch_add(alignedSize, std::memory_order_relaxed);
+
+    UniformAllocation allocation;
+    if(offset + aSize > _mFrameSize){
+        _mFailedAllocations.fetch_add(1, std::memory_order_relaxed);
+        return(allocation);
+    }
+
+    const VkDeviceSize bufferOffset = VkDeviceSize(_mFrame) * _mFrameSize + offset;
+    allocation.mBuffer = _mBuffer;
+    allocation.mDynamicOffset = static_cast<uint32_t>(bufferOffset);
+    allocation.mSize = aSize;
+    allocation.mMapped = _mMapped + bufferOffset;
+    _mAllocations.fetch_add(1, std::memory_order_relaxed);
+    return(allocation);
+}
+
+UniformAllocation UniformRing::push(const void* aData, VkDeviceSize aSize){
+    UniformAllocation allocation = allocate(aSize);
+    if(allocation.isValid()) std::memcpy(allocation.mMapped, aData, aSize);
+    return(allocation);
+}
+
+void UniformRing::flush(){
+    const VkDeviceSize used = getFrameUsage();
+    if(used != 0) vmaFlushAllocation(_mAllocator, _mAllocation, VkDeviceSize(_mFrame) * _mFrameSize, used);
+}
+
+uint32_t UniformRing::nextFrame(){
+    const VkDeviceSize used = getFrameUsage();
+    _mBytesAllocated += used;
+    _mPeakFrameBytes = std::max(_mPeakFrameBytes, used);
+
+    _mFrame = (_mFrame + 1) % _mFrameCount;
+    _mHead.store(0, std::memory_order_relaxed);
+    return(_mFrame);
+}
+
+UniformRingStats UniformRing::stats() const{
+    const VkDeviceSize used = getFrameUsage();
+    UniformRingStats stats;
+    stats.mAllocations = _mAllocations.load(std::memory_order_relaxed);
+    stats.mFailedAllocations = _mFailedAllocations.load(std::memory_order_relaxed);
+    stats.mBytesAllocated = _mBytesAllocated + used;
+    stats.mPeakFrameBytes = std::max(_mPeakFrameBytes, used);
+    return(stats);
+}
+
+} // end namespace vkutils
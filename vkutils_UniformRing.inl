@@ -0,0 +1,114 @@
+#include <vulkan/vulkan.h>
+
+/// Space handed out by a UniformRing for one draw or dispatch
+struct UniformAllocation
+{
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    uint32_t mDynamicOffset = 0;    ///< Offset to pass in pDynamicOffsets when binding the ring's descriptor
+    VkDeviceSize mSize = 0;
+    void* mMapped = nullptr;        ///< Where the host writes the data
+
+    bool isValid() const {return(mMapped != nullptr);}
+
+    template<typename DataType>
+    DataType* as() const {return(static_cast<DataType*>(mMapped));}
+};
+
+/// Counters for a UniformRing
+struct UniformRingStats
+{
+    uint64_t mAllocations = 0;
+    uint64_t mFailedAllocations = 0;    ///< Allocations that didn't fit in what was left of their frame
+    uint64_t mBytesAllocated = 0;       ///< Including alignment padding
+    VkDeviceSize mPeakFrameBytes = 0;   ///< Most bytes used by a single frame so far
+};
+
+/// Persistently mapped buffer that hands out per-draw constants through dynamic offsets.
+///
+/// The buffer is split into one region per frame in flight. Each allocation bumps the current
+/// frame's head by its size rounded up to minUniformBufferOffsetAlignment (and
+/// minStorageBufferOffsetAlignment for storage usage), so writing constants costs an atomic add and a
+/// memcpy. No buffer is created and no descriptor is updated. A single VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+/// (or STORAGE_BUFFER_DYNAMIC) descriptor written from descriptorInfo() serves every allocation.
+///
+/// The descriptor exposes a fixed range from every dynamic offset. The buffer is padded by that range
+/// past the last frame, so an offset near the end of the buffer still leaves the whole range in bounds.
+///
+/// allocate() and push() may be called from any thread. nextFrame() and flush() must not run
+/// concurrently with them.
+class UniformRing
+{
+ public:
+    /// \param aFrameSize Bytes available to each frame, rounded up to the offset alignment
+    /// \param aRange Bytes each dynamic offset exposes, at least the largest allocation bound through the descriptor
+    /// \param aFrameCount Frames in flight, each with its own region of the buffer
+    /// \param aUsage VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT or both
+    /// \throw std::runtime_error If the buffer can't be created, is too large for 32 bit dynamic offsets, or
+    ///                            `aRange` exceeds the device's buffer range limit
+    UniformRing(
+        const VulkanDeviceHandlePair& aDevicePair,
+        VkDeviceSize aFrameSize,
+        VkDeviceSize aRange,
+        uint32_t aFrameCount = 2,
+        VkBufferUsageFlags aUsage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+    );
+    ~UniformRing();
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    /// Reserves `aSize` bytes of the current frame
+    /// \returns An invalid allocation if the frame's region is full
+    UniformAllocation allocate(VkDeviceSize aSize);
+
+    /// Allocates and copies `aSize` bytes from `aData`
+    UniformAllocation push(const void* aData, VkDeviceSize aSize);
+
+    template<typename DataType>
+    UniformAllocation push(const DataType& aData){
+        static_assert(std::is_trivially_copyable<DataType>::value, "Uniform data must be trivially copyable");
+        return(push(&aData, sizeof(DataType)));
+    }
+
+    /// Moves to the next frame's region, discarding what it held. The GPU must be done with that
+    /// frame, e.g. by waiting on its fence first.
+    /// \returns The new frame index
+    uint32_t nextFrame();
+
+    /// Makes the current frame's writes visible to the device. Call before submitting work that reads them.
+    void flush();
+
+    /// Buffer info for the ring's dynamic descriptor
+    VkDescriptorBufferInfo descriptorInfo() const {return(VkDescriptorBufferInfo{_mBuffer, 0, _mRange});}
+
+    VkBuffer getBuffer() const {return(_mBuffer);}
+    VkDeviceSize getAlignment() const {return(_mAlignment);}
+    VkDeviceSize getFrameSize() const {return(_mFrameSize);}
+    VkDeviceSize getRange() const {return(_mRange);}
+    uint32_t getFrameIndex() const {return(_mFrame);}
+
+    /// Bytes used so far by the current frame, including padding
+    VkDeviceSize getFrameUsage() const {return(std::min(_mHead.load(std::memory_order_relaxed), _mFrameSize));}
+
+    UniformRingStats stats() const;
+
+ private:
+    VmaAllocator _mAllocator = nullptr;
+    VmaAllocation _mAllocation = nullptr;
+    VkBuffer _mBuffer = VK_NULL_HANDLE;
+    uint8_t* _mMapped = nullptr;
+
+    VkDeviceSize _mAlignment = 1;
+    VkDeviceSize _mFrameSize = 0;
+    VkDeviceSize _mRange = 0;
+    uint32_t _mFrameCount = 0;
+    uint32_t _mFrame = 0;
+
+    // Offset of the next allocation within the current frame. May run past the frame's end when full.
+    std::atomic<VkDeviceSize> _mHead = {0};
+
+    std::atomic<uint64_t> _mAllocations = {0};
+    std::atomic<uint64_t> _mFailedAllocations = {0};
+    uint64_t _mBytesAllocated = 0;  // Totals of completed frames; the current frame's head is added in stats()
+    VkDeviceSize _mPeakFrameBytes = 0;
+};
@@ -1,30 +1,47 @@
 #include "vkutils.h"
+#include "PipelineCacheHost.h"
 #include <iostream>
 
 namespace vkutils{
 
-VulkanComputePipeline VulkanComputePipelineBuilder::build(VkDevice aLogicalDevice){
-    if(vkCreatePipelineLayout(aLogicalDevice, &mCtorSet.mLayoutInfo, nullptr, &mLayout) != VK_SUCCESS){
+VulkanComputePipeline VulkanComputePipelineBuilder::build(VkDevice aLogicalDevice, VkPipelineCache aPipelineCache){
+    std::shared_ptr<PipelineLayoutCache> layoutCache = PipelineLayoutCache::forDevice(aLogicalDevice);
+    if(mCtorSet.mLayoutDescription.empty() && mCtorSet.mPushDescriptorSet != PipelineLayoutDescription::kNoPushDescriptorSet){
+        throw std::runtime_error("Push descriptor set " + std::to_string(mCtorSet.mPushDescriptorSet) + " requires a pipeline layout description");
+    }
+    VkResult layoutResult = mCtorSet.mLayoutDescription.empty()
+        ? layoutCache->getPipelineLayout(mCtorSet.mLayoutInfo, mLayoutRef)
+        : layoutCache->getPipelineLayout(mCtorSet.mLayoutDescription.withPushDescriptorSet(mCtorSet.mPushDescriptorSet), mLayoutRef);
+    if(layoutResult != VK_SUCCESS){
         throw std::runtime_error("Failed when creating compute pipeline layout!");
     }
+    mLayout = mLayoutRef.get();
 
     mCtorSet.mComputePipelineInfo.layout = mLayout;
 
-    if(vkCreateComputePipelines(aLogicalDevice, VK_NULL_HANDLE, 1, &mCtorSet.mComputePipelineInfo, nullptr, &mPipeline) != VK_SUCCESS){
+    if(vkCreateComputePipelines(aLogicalDevice, aPipelineCache, 1, &mCtorSet.mComputePipelineInfo, nullptr, &mPipeline) != VK_SUCCESS){
         throw std::runtime_error("Failed when creating compute pipeline!");
     }
 
     return(*this);
 }
 
+VulkanComputePipeline VulkanComputePipelineBuilder::build(const VulkanDeviceHandlePair& aDevicePair){
+    return(build(aDevicePair.device, PipelineCacheHost::getCache(aDevicePair)));
+}
+
 void VulkanComputePipeline::destroy(VkDevice aLogicalDevice){
     if(!_isValid()){
         std::cerr << "Warning! Cannot destroy VulkanComputePipeline because it hasn't been built" << std::endl;
         return;
     }
 
-    vkDestroyPipelineLayout(aLogicalDevice, mLayout, nullptr);
+    // Cached layouts are shared, and destroyed by the cache once no pipeline refers to them
+    if(!mLayoutRef.isValid()){
+        vkDestroyPipelineLayout(aLogicalDevice, mLayout, nullptr);
+    }
     mLayout = VK_NULL_HANDLE;
+    mLayoutRef.reset();
 
     vkDestroyPipeline(aLogicalDevice, mPipeline, nullptr);
     mPipeline = VK_NULL_HANDLE;
@@ -61,4 +78,17 @@ void VulkanComputePipelineBuilder::prepareWithStage(ComputePipelineConstructionS
     aCtorSet.mComputePipelineInfo.stage = aComputeStage;
 }
 
+void VulkanComputePipelineBuilder::prepareReflected(ComputePipelineConstructionSet& aCtorSet, const ShaderModuleRef& aComputeModule){
+    VulkanComputePipelineBuilder::prepareUnspecialized(aCtorSet, aComputeModule.get());
+    VulkanComputePipelineBuilder::reflectLayout(aCtorSet, aComputeModule.getReflection());
+}
+
+void VulkanComputePipelineBuilder::reflectLayout(ComputePipelineConstructionSet& aCtorSet, const ShaderReflection& aReflection, uint32_t aUnsizedArrayCount){
+    aCtorSet.mLayoutDescription = PipelineLayoutDescription::fromReflection({aReflection}, aUnsizedArrayCount);
+}
+
+void VulkanComputePipelineBuilder::useBindlessTable(ComputePipelineConstructionSet& aCtorSet, const BindlessTable& aTable, uint32_t aSet){
+    aCtorSet.mLayoutDescription.replaceSet(aSet, aTable.getLayoutDescription());
+}
+
 }
\ No newline at end of file
@@ -5,10 +5,14 @@ class VulkanComputePipeline
  public:
     VulkanComputePipeline(){}
     VulkanComputePipeline(VkPipelineLayout aLayout, VkPipeline aPipeline) : mPipeline(aPipeline), mLayout(aLayout) {}
+    VulkanComputePipeline(const PipelineLayoutRef& aLayout, VkPipeline aPipeline) : mPipeline(aPipeline), mLayout(aLayout.get()), mLayoutRef(aLayout) {}
 
     VkPipeline handle() const {return(mPipeline);}
     VkPipelineLayout getLayout() const {return(mLayout);}
 
+    /// Shared reference to the layout. Invalid if the pipeline was constructed from a raw layout handle.
+    const PipelineLayoutRef& getLayoutRef() const {return(mLayoutRef);}
+
     bool isValid() const {return(_isValid());}
 
     void destroy(VkDevice aLogicalDevice); 
@@ -18,6 +22,9 @@ class VulkanComputePipeline
 
     VkPipeline mPipeline = VK_NULL_HANDLE;
     VkPipelineLayout mLayout = VK_NULL_HANDLE;
+
+    // Keeps mLayout alive when it came from a PipelineLayoutCache
+    PipelineLayoutRef mLayoutRef;
 };
 
 struct ComputePipelineConstructionSet
@@ -25,6 +32,14 @@ struct ComputePipelineConstructionSet
     VkPipelineShaderStageCreateInfo mShaderStage = {};
     VkPipelineLayoutCreateInfo mLayoutInfo = {};
     VkComputePipelineCreateInfo mComputePipelineInfo = {}; 
+
+    // When not empty, the layout is built from this description and mLayoutInfo is ignored.
+    // Either way the layout is shared through the device's PipelineLayoutCache.
+    PipelineLayoutDescription mLayoutDescription;
+
+    // Set of mLayoutDescription created as a VK_KHR_push_descriptor layout, written with PushDescriptorRecorder
+    // instead of allocated descriptor sets
+    uint32_t mPushDescriptorSet = PipelineLayoutDescription::kNoPushDescriptorSet;
 };
 
 class VulkanComputePipelineBuilder : public VulkanComputePipeline
@@ -44,7 +59,24 @@ class VulkanComputePipelineBuilder : public VulkanComputePipeline
     static void prepareUnspecialized(ComputePipelineConstructionSet& aCtorSet, VkShaderModule aComputeModule);
     static void prepareWithStage(ComputePipelineConstructionSet& aCtorSet, const VkPipelineShaderStageCreateInfo& aComputeStage);
 
-    VulkanComputePipeline build(VkDevice aLogicalDevice);
+    /// Prepare an unspecialized stage for a cached module, deriving the pipeline layout from its reflection.
+    /// `aComputeModule` must be kept alive until the pipeline is built.
+    static void prepareReflected(ComputePipelineConstructionSet& aCtorSet, const ShaderModuleRef& aComputeModule);
+
+    /// Replace the construction set's layout description with the one `aReflection` declares
+    /// \param aUnsizedArrayCount Descriptor count given to runtime sized arrays
+    static void reflectLayout(ComputePipelineConstructionSet& aCtorSet, const ShaderReflection& aReflection, uint32_t aUnsizedArrayCount = 1);
+
+    /// Make `aTable`'s set number `aSet` of the construction set's layout description, replacing what reflection
+    /// put there. Call after reflectLayout(), and declare the set's arrays as runtime sized in the shader.
+    static void useBindlessTable(ComputePipelineConstructionSet& aCtorSet, const BindlessTable& aTable, uint32_t aSet = 0);
+
+    /// Create the pipeline, optionally through `aPipelineCache`. The layout is looked up in the
+    /// device's PipelineLayoutCache, so it is shared with every structurally identical pipeline.
+    VulkanComputePipeline build(VkDevice aLogicalDevice, VkPipelineCache aPipelineCache = VK_NULL_HANDLE);
+
+    /// Create the pipeline through the device's shared cache in PipelineCacheHost
+    VulkanComputePipeline build(const VulkanDeviceHandlePair& aDevicePair);
 
  protected:
     ComputePipelineConstructionSet mCtorSet;
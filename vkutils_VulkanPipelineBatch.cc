@@ -0,0 +1,221 @@
+#include "vkutils.h"
+#include "PipelineCacheHost.h"
+#include <thread>
+#include <atomic>
+
+namespace vkutils{
+
+namespace{
+
+/// Throws the same errors as the single pipeline builders for a push descriptor set the construction
+/// set's layout description doesn't have. Checked for every set before any Vulkan object is created.
+template<typename CtorSetType>
+void check_push_descriptor_sets(const std::vector<CtorSetType>& aCtorSets){
+    for(const CtorSetType& ctorSet : aCtorSets){
+        if(ctorSet.mPushDescriptorSet == PipelineLayoutDescription::kNoPushDescriptorSet) continue;
+        if(ctorSet.mLayoutDescription.empty()){
+            throw std::runtime_error("Push descriptor set " + std::to_string(ctorSet.mPushDescriptorSet) + " requires a pipeline layout description");
+        }
+        if(ctorSet.mPushDescriptorSet >= ctorSet.mLayoutDescription.mSetLayouts.size()){
+            throw std::runtime_error("Push descriptor set " + std::to_string(ctorSet.mPushDescriptorSet) + " is not part of the pipeline layout description");
+        }
+    }
+}
+
+/// Finds or creates the shared layout for a construction set, built from its layout description unless that is empty
+template<typename CtorSetType>
+inline VkResult get_layout(
+    PipelineLayoutCache& aCache,
+    const CtorSetType& aCtorSet,
+    const VkPipelineLayoutCreateInfo& aCreateInfo,
+    PipelineLayoutRef& aLayoutOut
+){
+    if(aCtorSet.mLayoutDescription.empty()) return(aCache.getPipelineLayout(aCreateInfo, aLayoutOut));
+    return(aCache.getPipelineLayout(aCtorSet.mLayoutDescription.withPushDescriptorSet(aCtorSet.mPushDescriptorSet), aLayoutOut));
+}
+
+/// Calls `aChunkFunc(begin, end)` for consecutive chunks of [0, aCount), spreading chunks over up to `aThreadCount` threads
+void run_chunked(size_t aCount, uint32_t aThreadCount, uint32_t aChunkSize, const std::function<void(size_t, size_t)>& aChunkFunc){
+    const size_t chunkSize = std::max<size_t>(aChunkSize, 1);
+    const size_t chunkCount = (aCount + chunkSize - 1) / chunkSize;
+    if(chunkCount == 0) return;
+
+    size_t threadCount = aThreadCount != 0 ? aThreadCount : std::max(std::thread::hardware_concurrency(), 1U);
+    threadCount = std::min(threadCount, chunkCount);
+
+    std::atomic<size_t> nextChunk(0);
+    auto worker = [&](){
+        for(size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++){
+            size_t begin = chunk * chunkSize;
+            aChunkFunc(begin, std::min(begin + chunkSize, aCount));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for(size_t i = 1; i < threadCount; ++i){
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(std::thread& thread : threads){
+        thread.join();
+    }
+}
+
+// vkCreate*Pipelines sets failed entries to VK_NULL_HANDLE but only returns a single result for the call
+inline VkResult pipeline_result(VkPipeline aPipeline, VkResult aCallResult){
+    if(aPipeline != VK_NULL_HANDLE) return(VK_SUCCESS);
+    return(aCallResult != VK_SUCCESS ? aCallResult : VK_ERROR_UNKNOWN);
+}
+
+} // end anonymous namespace
+
+size_t ComputePipelineBatch::failureCount() const{
+    return(std::count_if(mResults.begin(), mResults.end(), [](const auto& result){return(!result.succeeded());}));
+}
+
+void ComputePipelineBatch::destroy(VkDevice aLogicalDevice){
+    for(PipelineBuildResult<VulkanComputePipeline>& result : mResults){
+        if(result.mPipeline.handle() != VK_NULL_HANDLE){
+            vkDestroyPipeline(aLogicalDevice, result.mPipeline.handle(), nullptr);
+        }
+    }
+    // Layouts are released along with the pipelines' references to them
+    mResults.clear();
+}
+
+size_t GraphicsPipelineBatch::failureCount() const{
+    return(std::count_if(mResults.begin(), mResults.end(), [](const auto& result){return(!result.succeeded());}));
+}
+
+void GraphicsPipelineBatch::destroy(VkDevice aLogicalDevice){
+    for(PipelineBuildResult<VulkanRenderPipeline>& result : mResults){
+        if(result.mPipeline.handle() != VK_NULL_HANDLE){
+            vkDestroyPipeline(aLogicalDevice, result.mPipeline.handle(), nullptr);
+        }
+        if(result.mPipeline.getRenderpass() != VK_NULL_HANDLE){
+            vkDestroyRenderPass(aLogicalDevice, result.mPipeline.getRenderpass(), nullptr);
+        }
+    }
+    // Layouts are released along with the pipelines' references to them
+    mResults.clear();
+}
+
+ComputePipelineBatch VulkanPipelineBatchBuilder::buildCompute(
+    const VulkanDeviceHandlePair& aDevicePair,
+    const std::vector<ComputePipelineConstructionSet>& aCtorSets,
+    uint32_t aThreadCount,
+    uint32_t aChunkSize
+){
+    check_push_descriptor_sets(aCtorSets);
+
+    ComputePipelineBatch batch;
+    batch.mResults.resize(aCtorSets.size());
+
+    std::shared_ptr<PipelineLayoutCache> layoutCache = PipelineLayoutCache::forDevice(aDevicePair.device);
+    std::vector<PipelineLayoutRef> layouts(aCtorSets.size());
+
+    // Gather create infos for every pipeline whose layout exists, remembering where each one came from
+    std::vector<VkComputePipelineCreateInfo> createInfos;
+    std::vector<size_t> sourceIndices;
+    createInfos.reserve(aCtorSets.size());
+    sourceIndices.reserve(aCtorSets.size());
+    for(size_t i = 0; i < aCtorSets.size(); ++i){
+        VkResult layoutResult = get_layout(*layoutCache, aCtorSets[i], aCtorSets[i].mLayoutInfo, layouts[i]);
+        if(layoutResult != VK_SUCCESS){
+            batch.mResults[i].mResult = layoutResult;
+            continue;
+        }
+        createInfos.push_back(aCtorSets[i].mComputePipelineInfo);
+        createInfos.back().layout = layouts[i].get();
+        sourceIndices.push_back(i);
+    }
+
+    VkPipelineCache pipelineCache = PipelineCacheHost::getCache(aDevicePair);
+    std::vector<VkPipeline> pipelines(createInfos.size(), VK_NULL_HANDLE);
+    run_chunked(createInfos.size(), aThreadCount, aChunkSize, [&](size_t aBegin, size_t aEnd){
+        VkResult callResult = vkCreateComputePipelines(
+            aDevicePair.device, pipelineCache, static_cast<uint32_t>(aEnd - aBegin),
+            &createInfos[aBegin], nullptr, &pipelines[aBegin]
+        );
+        for(size_t k = aBegin; k < aEnd; ++k){
+            PipelineBuildResult<VulkanComputePipeline>& result = batch.mResults[sourceIndices[k]];
+            result.mResult = pipeline_result(pipelines[k], callResult);
+            if(result.succeeded()){
+                result.mPipeline = VulkanComputePipeline(layouts[sourceIndices[k]], pipelines[k]);
+            }
+        }
+    });
+
+    return(batch);
+}
+
+GraphicsPipelineBatch VulkanPipelineBatchBuilder::buildGraphics(
+    const std::vector<GraphicsPipelineConstructionSet>& aCtorSets,
+    uint32_t aThreadCount,
+    uint32_t aChunkSize
+){
+    GraphicsPipelineBatch batch;
+    if(aCtorSets.empty()) return(batch);
+
+    const VulkanDeviceHandlePair devicePair = aCtorSets.front().mDevicePair;
+    for(const GraphicsPipelineConstructionSet& ctorSet : aCtorSets){
+        if(ctorSet.mDevicePair != devicePair){
+            throw std::runtime_error("All construction sets in a graphics pipeline batch must use the same device!");
+        }
+    }
+    check_push_descriptor_sets(aCtorSets);
+
+    batch.mResults.resize(aCtorSets.size());
+
+    std::shared_ptr<PipelineLayoutCache> layoutCache = PipelineLayoutCache::forDevice(devicePair.device);
+    std::vector<PipelineLayoutRef> layouts(aCtorSets.size());
+
+    // Create states hold pointers to themselves, so they are sized once up front and filled in place
+    std::vector<GraphicsPipelineCreateState> createStates(aCtorSets.size());
+    std::vector<VkGraphicsPipelineCreateInfo> createInfos;
+    std::vector<size_t> sourceIndices;
+    createInfos.reserve(aCtorSets.size());
+    sourceIndices.reserve(aCtorSets.size());
+    for(size_t i = 0; i < aCtorSets.size(); ++i){
+        PipelineBuildResult<VulkanRenderPipeline>& result = batch.mResults[i];
+        result.mResult = get_layout(*layoutCache, aCtorSets[i], aCtorSets[i].mPipelineLayoutInfo, layouts[i]);
+        if(result.mResult != VK_SUCCESS) continue;
+
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        result.mResult = VulkanBasicRasterPipelineBuilder::createRenderPass(aCtorSets[i], renderPass);
+        if(result.mResult != VK_SUCCESS) continue;
+
+        createStates[i].fill(aCtorSets[i], layouts[i].get(), renderPass);
+        createInfos.push_back(createStates[i].mPipelineInfo);
+        sourceIndices.push_back(i);
+    }
+
+    VkPipelineCache pipelineCache = PipelineCacheHost::getCache(devicePair);
+    std::vector<VkPipeline> pipelines(createInfos.size(), VK_NULL_HANDLE);
+    run_chunked(createInfos.size(), aThreadCount, aChunkSize, [&](size_t aBegin, size_t aEnd){
+        VkResult callResult = vkCreateGraphicsPipelines(
+            devicePair.device, pipelineCache, static_cast<uint32_t>(aEnd - aBegin),
+            &createInfos[aBegin], nullptr, &pipelines[aBegin]
+        );
+        for(size_t k = aBegin; k < aEnd; ++k){
+            const size_t source = sourceIndices[k];
+            PipelineBuildResult<VulkanRenderPipeline>& result = batch.mResults[source];
+            result.mResult = pipeline_result(pipelines[k], callResult);
+            if(result.succeeded()){
+                result.mPipeline.mGraphicsPipeline = pipelines[k];
+                result.mPipeline.mGraphicsPipeLayout = createInfos[k].layout;
+                result.mPipeline.mRenderPass = createInfos[k].renderPass;
+                result.mPipeline.mViewport = aCtorSets[source].mViewport;
+                result.mPipeline._mLogicalDevice = devicePair.device;
+                result.mPipeline._mLayoutRef = layouts[source];
+            }else{
+                vkDestroyRenderPass(devicePair.device, createInfos[k].renderPass, nullptr);
+            }
+        }
+    });
+
+    return(batch);
+}
+
+} // end namespace vkutils
@@ -0,0 +1,62 @@
+#include <vulkan/vulkan.h>
+
+/// Outcome of creating a single pipeline as part of a batch
+template<typename PipelineType>
+struct PipelineBuildResult
+{
+    PipelineType mPipeline;
+    VkResult mResult = VK_NOT_READY;
+
+    bool succeeded() const {return(mResult == VK_SUCCESS);}
+};
+
+/// Compute pipelines created together by VulkanPipelineBatchBuilder. Results are in the same order
+/// as the construction sets they were created from. Pipeline layouts come from the device's
+/// PipelineLayoutCache and are shared with every structurally identical pipeline.
+class ComputePipelineBatch
+{
+ public:
+    std::vector<PipelineBuildResult<VulkanComputePipeline>> mResults;
+
+    size_t failureCount() const;
+
+    void destroy(VkDevice aLogicalDevice);
+};
+
+/// Graphics pipelines created together by VulkanPipelineBatchBuilder. The same layout sharing
+/// as ComputePipelineBatch applies.
+class GraphicsPipelineBatch
+{
+ public:
+    std::vector<PipelineBuildResult<VulkanRenderPipeline>> mResults;
+
+    size_t failureCount() const;
+
+    void destroy(VkDevice aLogicalDevice);
+};
+
+/// Creates many pipelines at once. Identical pipeline layouts are created once, and pipelines are
+/// created in chunks through batched vkCreate*Pipelines calls spread over a set of worker threads
+/// that all share the device's cache from PipelineCacheHost.
+class VulkanPipelineBatchBuilder
+{
+ public:
+    /// \param aThreadCount Number of worker threads to use. Zero selects the hardware concurrency.
+    /// \param aChunkSize Maximum number of pipelines passed to a single vkCreate*Pipelines call.
+    /// \throw std::runtime_error If a construction set names a push descriptor set its layout description lacks
+    static ComputePipelineBatch buildCompute(
+        const VulkanDeviceHandlePair& aDevicePair,
+        const std::vector<ComputePipelineConstructionSet>& aCtorSets,
+        uint32_t aThreadCount = 0,
+        uint32_t aChunkSize = 16
+    );
+
+    /// All construction sets must refer to the same device.
+    /// \throw std::runtime_error If the construction sets refer to different devices, or one names a push
+    /// descriptor set its layout description lacks
+    static GraphicsPipelineBatch buildGraphics(
+        const std::vector<GraphicsPipelineConstructionSet>& aCtorSets,
+        uint32_t aThreadCount = 0,
+        uint32_t aChunkSize = 16
+    );
+};
@@ -1,5 +1,6 @@
 #include "vkutils.h"
 #include "VmaHost.h"
+#include "PipelineCacheHost.h"
 #include <cassert>
 #include <array>
 
@@ -17,8 +18,9 @@ void VulkanRenderPipeline::destroy(){
     mGraphicsPipeline = VK_NULL_HANDLE;
     vkDestroyRenderPass(_mLogicalDevice, mRenderPass, nullptr);
     mRenderPass = VK_NULL_HANDLE;
-    vkDestroyPipelineLayout(_mLogicalDevice, mGraphicsPipeLayout, nullptr);
+    // The layout is shared, and destroyed by its cache once no pipeline refers to it
     mGraphicsPipeLayout = VK_NULL_HANDLE;
+    _mLayoutRef.reset();
 }
 
 GraphicsPipelineConstructionSet& VulkanBasicRasterPipelineBuilder::setupConstructionSet(const VulkanDeviceHandlePair& aDevicePair, const VulkanSwapchainBundle* aChainBundle){
@@ -33,20 +35,36 @@ void VulkanBasicRasterPipelineBuilder::build(const GraphicsPipelineConstructionS
     }
     _mConstructionSet = aFinalCtorSet;
     
-    // Create pipeline layout object
-    vkCreatePipelineLayout(aFinalCtorSet.mDevicePair.device, &aFinalCtorSet.mPipelineLayoutInfo, nullptr, &mGraphicsPipeLayout);
-
-    VkPipelineDynamicStateCreateInfo dynamicStateInfo;{
-        dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicStateInfo.pNext = nullptr;
-        dynamicStateInfo.flags = 0;
-        dynamicStateInfo.dynamicStateCount = aFinalCtorSet.mDynamicStates.size();
-        dynamicStateInfo.pDynamicStates = aFinalCtorSet.mDynamicStates.data();
+    // Find or create the pipeline layout, shared with any structurally identical pipeline
+    std::shared_ptr<PipelineLayoutCache> layoutCache = PipelineLayoutCache::forDevice(aFinalCtorSet.mDevicePair.device);
+    if(aFinalCtorSet.mLayoutDescription.empty() && aFinalCtorSet.mPushDescriptorSet != PipelineLayoutDescription::kNoPushDescriptorSet){
+        throw std::runtime_error("Push descriptor set " + std::to_string(aFinalCtorSet.mPushDescriptorSet) + " requires a pipeline layout description");
     }
+    VkResult layoutResult = aFinalCtorSet.mLayoutDescription.empty()
+        ? layoutCache->getPipelineLayout(aFinalCtorSet.mPipelineLayoutInfo, _mLayoutRef)
+        : layoutCache->getPipelineLayout(aFinalCtorSet.mLayoutDescription.withPushDescriptorSet(aFinalCtorSet.mPushDescriptorSet), _mLayoutRef);
+    if(layoutResult != VK_SUCCESS){
+        throw std::runtime_error("Unable to create pipeline layout!");
+    }
+    mGraphicsPipeLayout = _mLayoutRef.get();
+
+    if(createRenderPass(aFinalCtorSet, mRenderPass) != VK_SUCCESS){
+        throw std::runtime_error("Unable to create render pass!");
+    }
+
+    GraphicsPipelineCreateState createState;
+    createState.fill(aFinalCtorSet, mGraphicsPipeLayout, mRenderPass);
 
+    VkPipelineCache pipelineCache = PipelineCacheHost::getCache(aFinalCtorSet.mDevicePair);
+    if(vkCreateGraphicsPipelines(aFinalCtorSet.mDevicePair.device, pipelineCache, 1, &createState.mPipelineInfo, nullptr, &mGraphicsPipeline) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create graphics pipeline!");
+    }
+}
+
+VkResult VulkanBasicRasterPipelineBuilder::createRenderPass(const GraphicsPipelineConstructionSet& aCtorSet, VkRenderPass& aRenderPassOut){
     std::array<VkAttachmentDescription, 2> standardAttachments = {
-        aFinalCtorSet.mRenderpassCtorSet.mColorAttachment,
-        aFinalCtorSet.mRenderpassCtorSet.mDepthAttachment
+        aCtorSet.mRenderpassCtorSet.mColorAttachment,
+        aCtorSet.mRenderpassCtorSet.mDepthAttachment
     };
 
     VkRenderPassCreateInfo renderPassInfo;{
@@ -56,49 +74,53 @@ void VulkanBasicRasterPipelineBuilder::build(const GraphicsPipelineConstructionS
         renderPassInfo.attachmentCount = standardAttachments.size();
         renderPassInfo.pAttachments = standardAttachments.data();
         renderPassInfo.subpassCount = 1;
-        renderPassInfo.pSubpasses = &aFinalCtorSet.mRenderpassCtorSet.mSubpass;
+        renderPassInfo.pSubpasses = &aCtorSet.mRenderpassCtorSet.mSubpass;
         renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &aFinalCtorSet.mRenderpassCtorSet.mDependency;
+        renderPassInfo.pDependencies = &aCtorSet.mRenderpassCtorSet.mDependency;
     }
 
-    if(vkCreateRenderPass(aFinalCtorSet.mDevicePair.device, &renderPassInfo, nullptr, &mRenderPass) != VK_SUCCESS){
-        throw std::runtime_error("Unable to create render pass!");
-    }
+    return(vkCreateRenderPass(aCtorSet.mDevicePair.device, &renderPassInfo, nullptr, &aRenderPassOut));
+}
 
-    VkPipelineViewportStateCreateInfo viewportInfo;{
-        viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportInfo.pNext = nullptr;
-        viewportInfo.flags = 0;
-        viewportInfo.viewportCount = 1;
-        viewportInfo.pViewports = &aFinalCtorSet.mViewport;
-        viewportInfo.scissorCount = 1;
-        viewportInfo.pScissors = &aFinalCtorSet.mScissor;
+void GraphicsPipelineCreateState::fill(const GraphicsPipelineConstructionSet& aCtorSet, VkPipelineLayout aLayout, VkRenderPass aRenderPass){
+    {
+        mDynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        mDynamicStateInfo.pNext = nullptr;
+        mDynamicStateInfo.flags = 0;
+        mDynamicStateInfo.dynamicStateCount = aCtorSet.mDynamicStates.size();
+        mDynamicStateInfo.pDynamicStates = aCtorSet.mDynamicStates.data();
     }
 
-    VkGraphicsPipelineCreateInfo pipelineInfo;{
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.pNext = nullptr;
-        pipelineInfo.flags = 0;
-        pipelineInfo.stageCount = aFinalCtorSet.mProgrammableStages.size();
-        pipelineInfo.pStages = aFinalCtorSet.mProgrammableStages.data();
-        pipelineInfo.pVertexInputState = &aFinalCtorSet.mVtxInputInfo;
-        pipelineInfo.pInputAssemblyState = &aFinalCtorSet.mInputAsmInfo;
-        pipelineInfo.pTessellationState = nullptr;
-        pipelineInfo.pViewportState = &viewportInfo;
-        pipelineInfo.pRasterizationState = &aFinalCtorSet.mRasterInfo;
-        pipelineInfo.pMultisampleState = &aFinalCtorSet.mMultisampleInfo;
-        pipelineInfo.pDepthStencilState = &aFinalCtorSet.mDepthStencilInfo;
-        pipelineInfo.pColorBlendState = &aFinalCtorSet.mColorBlendInfo;
-        pipelineInfo.pDynamicState = aFinalCtorSet.mDynamicStates.empty() ? nullptr : &dynamicStateInfo;
-        pipelineInfo.layout = mGraphicsPipeLayout;
-        pipelineInfo.renderPass = mRenderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-        pipelineInfo.basePipelineIndex = -1;
+    {
+        mViewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        mViewportInfo.pNext = nullptr;
+        mViewportInfo.flags = 0;
+        mViewportInfo.viewportCount = 1;
+        mViewportInfo.pViewports = &aCtorSet.mViewport;
+        mViewportInfo.scissorCount = 1;
+        mViewportInfo.pScissors = &aCtorSet.mScissor;
     }
 
-    if(vkCreateGraphicsPipelines(aFinalCtorSet.mDevicePair.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mGraphicsPipeline) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create graphics pipeline!");
+    {
+        mPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        mPipelineInfo.pNext = nullptr;
+        mPipelineInfo.flags = 0;
+        mPipelineInfo.stageCount = aCtorSet.mProgrammableStages.size();
+        mPipelineInfo.pStages = aCtorSet.mProgrammableStages.data();
+        mPipelineInfo.pVertexInputState = &aCtorSet.mVtxInputInfo;
+        mPipelineInfo.pInputAssemblyState = &aCtorSet.mInputAsmInfo;
+        mPipelineInfo.pTessellationState = nullptr;
+        mPipelineInfo.pViewportState = &mViewportInfo;
+        mPipelineInfo.pRasterizationState = &aCtorSet.mRasterInfo;
+        mPipelineInfo.pMultisampleState = &aCtorSet.mMultisampleInfo;
+        mPipelineInfo.pDepthStencilState = &aCtorSet.mDepthStencilInfo;
+        mPipelineInfo.pColorBlendState = &aCtorSet.mColorBlendInfo;
+        mPipelineInfo.pDynamicState = aCtorSet.mDynamicStates.empty() ? nullptr : &mDynamicStateInfo;
+        mPipelineInfo.layout = aLayout;
+        mPipelineInfo.renderPass = aRenderPass;
+        mPipelineInfo.subpass = 0;
+        mPipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        mPipelineInfo.basePipelineIndex = -1;
     }
 }
 
@@ -271,6 +293,14 @@ void VulkanBasicRasterPipelineBuilder::prepareRenderPass(GraphicsPipelineConstru
     }
 }
 
+void VulkanBasicRasterPipelineBuilder::reflectLayout(GraphicsPipelineConstructionSet& aCtorSetInOut, const std::vector<ShaderReflection>& aStages, uint32_t aUnsizedArrayCount){
+    aCtorSetInOut.mLayoutDescription = PipelineLayoutDescription::fromReflection(aStages, aUnsizedArrayCount);
+}
+
+void VulkanBasicRasterPipelineBuilder::useBindlessTable(GraphicsPipelineConstructionSet& aCtorSetInOut, const BindlessTable& aTable, uint32_t aSet){
+    aCtorSetInOut.mLayoutDescription.replaceSet(aSet, aTable.getLayoutDescription());
+}
+
 VulkanDepthBundle VulkanBasicRasterPipelineBuilder::autoCreateDepthBuffer(const GraphicsPipelineConstructionSet& aCtorSet){
     VulkanDepthBundle bundle;
     if(aCtorSet.mSwapchainBundle == nullptr){
@@ -298,7 +328,8 @@ VulkanDepthBundle VulkanBasicRasterPipelineBuilder::autoCreateDepthBuffer(const
     {
         allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
         allocInfo.requiredFlags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
-
+        // Falls back to the default pools when no depth pool is registered
+        allocInfo.pool = VmaHost::getPool(aCtorSet.mDevicePair, VmaHost::kDepthBufferPool);
     }
 
     VmaAllocator allocator = VmaHost::getAllocator({aCtorSet.mDevicePair.device, aCtorSet.mDevicePair.physicalDevice});
@@ -39,6 +39,7 @@ class VulkanRenderPipeline
 
     const VkPipeline& handle() const { return(mGraphicsPipeline); }
     const VkPipelineLayout& getLayout() const { return(mGraphicsPipeLayout); }
+    const PipelineLayoutRef& getLayoutRef() const { return(_mLayoutRef); }
     const VkRenderPass& getRenderpass() const { return(mRenderPass); }
     const VkViewport& getViewport() const { return(mViewport); }
 
@@ -50,6 +51,11 @@ class VulkanRenderPipeline
     VkViewport mViewport;
 
     VkDevice _mLogicalDevice = VK_NULL_HANDLE;
+
+    // Keeps mGraphicsPipeLayout alive; the layout is shared through the device's PipelineLayoutCache
+    PipelineLayoutRef _mLayoutRef;
+
+    friend class VulkanPipelineBatchBuilder;
 };
 
 class RenderPassConstructionSet
@@ -112,6 +118,14 @@ class GraphicsPipelineConstructionSet
     VkPipelineDepthStencilStateCreateInfo mDepthStencilInfo;
     std::vector<VkDynamicState> mDynamicStates;
 
+    // When not empty, the layout is built from this description and mPipelineLayoutInfo is ignored.
+    // Either way the layout is shared through the device's PipelineLayoutCache.
+    PipelineLayoutDescription mLayoutDescription;
+
+    // Set of mLayoutDescription created as a VK_KHR_push_descriptor layout, written with PushDescriptorRecorder
+    // instead of allocated descriptor sets
+    uint32_t mPushDescriptorSet = PipelineLayoutDescription::kNoPushDescriptorSet;
+
  protected:
     friend class VulkanBasicRasterPipelineBuilder;
     GraphicsPipelineConstructionSet(){}
@@ -120,6 +134,17 @@ class GraphicsPipelineConstructionSet
 
 };
 
+/// Create info structures derived from a GraphicsPipelineConstructionSet. Holds pointers into both
+/// itself and the construction set, so it must not be copied or moved once filled.
+struct GraphicsPipelineCreateState
+{
+    VkPipelineDynamicStateCreateInfo mDynamicStateInfo;
+    VkPipelineViewportStateCreateInfo mViewportInfo;
+    VkGraphicsPipelineCreateInfo mPipelineInfo;
+
+    void fill(const GraphicsPipelineConstructionSet& aCtorSet, VkPipelineLayout aLayout, VkRenderPass aRenderPass);
+};
+
 class VulkanBasicRasterPipelineBuilder : public VulkanRenderPipeline
 {
  public:
@@ -138,8 +163,21 @@ class VulkanBasicRasterPipelineBuilder : public VulkanRenderPipeline
     static void prepareViewport(GraphicsPipelineConstructionSet& aCtorSetInOut);
     static void prepareRenderPass(GraphicsPipelineConstructionSet& aCtorSetInOut);
 
+    /// Replace the construction set's layout description with the union of what `aStages` declare
+    /// \param aUnsizedArrayCount Descriptor count given to runtime sized arrays
+    /// \throw std::runtime_error If stages declare conflicting descriptor types for the same binding
+    static void reflectLayout(GraphicsPipelineConstructionSet& aCtorSetInOut, const std::vector<ShaderReflection>& aStages, uint32_t aUnsizedArrayCount = 1);
+
+    /// Make `aTable`'s set number `aSet` of the construction set's layout description, replacing what reflection
+    /// put there. Call after reflectLayout(), and declare the set's arrays as runtime sized in the shaders.
+    static void useBindlessTable(GraphicsPipelineConstructionSet& aCtorSetInOut, const BindlessTable& aTable, uint32_t aSet = 0);
+
+    /// Create the render pass described by the construction set's render pass sub-construction set.
+    static VkResult createRenderPass(const GraphicsPipelineConstructionSet& aCtorSet, VkRenderPass& aRenderPassOut);
+
     /// Automatically select an appropriate depth buffer configuration based on aCtorSet and return the created depth buffer
     /// NOTE: An swapchain bundle must be bound to the construction set. 
+    /// The image is allocated from the VmaHost::kDepthBufferPool pool if one is registered for the device.
     static VulkanDepthBundle autoCreateDepthBuffer(const GraphicsPipelineConstructionSet& aCtorSet);
     
     /// Automatically select an appropriate depth buffer configuration based on the internal construction set and return the created depth buffer
@@ -148,7 +186,8 @@ class VulkanBasicRasterPipelineBuilder : public VulkanRenderPipeline
 
     /// Submit aFinalCtorSet as the construction set for this pipeline. The pipeline
     /// is then created fresh using the given construction set. The success of this
-    /// function will make the object valid and usable. 
+    /// function will make the object valid and usable. Creation goes through the
+    /// device's shared cache in PipelineCacheHost.
     void build(const GraphicsPipelineConstructionSet& aFinalCtorSet);
 
     /// Create pipeline using internal construction set. The success of this